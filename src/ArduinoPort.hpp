@@ -17,6 +17,8 @@ protected:
     virtual void _open();
     virtual void _close();
     virtual int _read(bool &nothing_to_read, bool &error);
+    virtual int _read_block(char* buf, int len, bool &nothing_to_read, bool &error);
+    virtual int _write(const char* data, int len, bool &error);
 	virtual bool _is_open();
 
 private:
@@ -69,6 +71,31 @@ template <typename T> int ArduinoPort<T>::_read(bool &nothing_to_read, bool &err
     }
 }
 
+template <typename T> int ArduinoPort<T>::_read_block(char* buf, int len, bool &nothing_to_read, bool &error)
+{
+    error = false;
+    int available = serial.available();
+    if (available <= 0)
+    {
+        nothing_to_read = true;
+        return 0;
+    }
+    // only what is already buffered, so readBytes never waits for its timeout
+    int n = available < len ? available : len;
+    nothing_to_read = n < len;
+    return serial.readBytes(buf, n);
+}
+
+template <typename T> int ArduinoPort<T>::_write(const char* data, int len, bool &error)
+{
+    error = false;
+    // only what fits in the TX buffer, so write never blocks
+    int room = serial.availableForWrite();
+    if (room <= 0) return 0;
+    int n = room < len ? room : len;
+    return serial.write((const uint8_t*)data, n);
+}
+
 template <typename T> bool ArduinoPort<T>::_is_open()
 {
     return open;
@@ -2,6 +2,7 @@
 #include "Log.h"
 #include "Utils.h"
 #include "LinuxPort.h"
+#include "LinuxPortBaud.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <unistd.h>
@@ -9,8 +10,14 @@
 #include <termios.h>
 #include <string.h>
 #include <errno.h>
+#include <poll.h>
 
-LinuxPort::LinuxPort(const char* p_name): Port(p_name), tty_fd(0)
+static const unsigned int DEFAULT_AUTOBAUD_RATES[] = {4800, 9600, 38400, 115200, 230400, 460800, 921600};
+
+#define LINUX_PORT_POLL_MS 100 // reader thread: how often the stop and reopen requests are checked
+
+LinuxPort::LinuxPort(const char* p_name): Port(p_name), tty_fd(0), writable(false), fd_writable(false), reader_run(false), reopen_requested(false), reader_speed(0),
+    overflows(0), reader_overruns(0), opens(0), reader_bytes(0)
 {
 	// bounded copy
 	strncpy(port_name, p_name, sizeof(port_name) - 1);
@@ -19,6 +26,14 @@ LinuxPort::LinuxPort(const char* p_name): Port(p_name), tty_fd(0)
 
 LinuxPort::~LinuxPort()
 {
+    if (reader)
+    {
+        reader_run = false;
+        reader->join();
+        delete reader;
+        reader = nullptr;
+    }
+    delete queue;
     if (tty_fd) ::close(tty_fd);
 }
 
@@ -29,6 +44,38 @@ void LinuxPort::set_port_name(const char* pname)
 	port_name[sizeof(port_name) - 1] = '\0';
 }
 
+static bool standard_speed(unsigned int rate, speed_t &bps)
+{
+    switch (rate)
+    {
+        case 4800: bps = B4800; return true;
+        case 9600: bps = B9600; return true;
+        case 19200: bps = B19200; return true;
+        case 38400: bps = B38400; return true;
+        case 57600: bps = B57600; return true;
+        case 115200: bps = B115200; return true;
+#ifdef B230400
+        case 230400: bps = B230400; return true;
+#endif
+#ifdef B460800
+        case 460800: bps = B460800; return true;
+#endif
+#ifdef B500000
+        case 500000: bps = B500000; return true;
+#endif
+#ifdef B576000
+        case 576000: bps = B576000; return true;
+#endif
+#ifdef B921600
+        case 921600: bps = B921600; return true;
+#endif
+#ifdef B1000000
+        case 1000000: bps = B1000000; return true;
+#endif
+        default: return false;
+    }
+}
+
 int fd_set_blocking(int fd, int blocking)
 {
     // Save the current flags
@@ -44,6 +91,13 @@ int fd_set_blocking(int fd, int blocking)
 }
 
 void LinuxPort::_open()
+{
+    // the reader thread owns the device and opens it on its own
+    if (reader) return;
+    open_fd();
+}
+
+void LinuxPort::open_fd()
 {
     if (tty_fd==0)
 	{
@@ -57,24 +111,20 @@ void LinuxPort::_open()
 		tio.c_cc[VMIN] = 1;
 		tio.c_cc[VTIME] = 5;
 
-		Log::trace("[GPS] Opening port {%s} at {%d} BPS\n", port_name, speed);
+		// with the reader thread, speed belongs to the main thread
+		unsigned int open_speed = reader_run ? reader_speed.load() : speed;
+		Log::trace("[GPS] Opening port {%s} at {%d} BPS\n", port_name, open_speed);
 
-		tty_fd = ::open(port_name, O_RDONLY | O_NONBLOCK); // O_NONBLOCK might override VMIN and VTIME, so read() may return immediately.
-		Log::trace("Err opening port {%d} {%s} {%d} {%s}\n", tty_fd, port_name, errno, strerror(errno));
+		bool rw = writable;
+		int fd = ::open(port_name, (rw ? O_RDWR : O_RDONLY) | O_NONBLOCK); // O_NONBLOCK might override VMIN and VTIME, so read() may return immediately.
+		tty_fd = fd > 0 ? fd : 0; // 0 is closed, a failed open must not look open
+		fd_writable = rw && tty_fd > 0;
+		Log::trace("Err opening port {%d} {%s} {%d} {%s}\n", (int)tty_fd, port_name, errno, strerror(errno));
 		if (tty_fd > 0)
 		{
 			speed_t bps;
-			switch (speed)
-			{
-				case 4800: bps = B4800; break;
-				case 9600: bps = B9600; break;
-				case 19200: bps = B19200; break;
-				case 38400: bps = B38400; break;
-				case 57600: bps = B57600; break;
-				case 115200: bps = B115200; break;
-				default:
-				bps = B38400;
-			}
+			bool standard = standard_speed(open_speed, bps);
+			if (!standard) bps = B38400; // replaced below
 			fd_set_blocking(tty_fd, 0);
 			Log::trace("Err opening port {%s} {%d} {%s}\n", port_name, errno, strerror(errno));
 			cfsetospeed(&tio, bps);
@@ -83,27 +133,337 @@ void LinuxPort::_open()
 			Log::trace("Err opening port {%s} {%d} {%s}\n", port_name, errno, strerror(errno));
 			tcsetattr(tty_fd, TCSANOW, &tio);
 			Log::trace("Err opening port {%s} {%d} {%s}\n", port_name, errno, strerror(errno));
+			if (!standard)
+			{
+#ifdef __linux__
+				if (!linux_port_set_custom_speed(tty_fd, open_speed))
+#endif
+				{
+					Log::tracex("PORT", "Unsupported speed", "name {%s} speed {%u} using {38400}", port_name, open_speed);
+				}
+			}
 		}
 	}
 }
 
 void LinuxPort::_close()
 {
+    if (reader)
+    {
+        // the reader thread owns the device
+        reopen_requested = true;
+        return;
+    }
+    close_fd();
+}
+
+void LinuxPort::close_fd()
+{
+    fd_writable = false;
     if (tty_fd) ::close(tty_fd);
     tty_fd = 0;
 }
 
 int LinuxPort::_read(bool &nothing, bool& error)
 {
-    unsigned char c;
-    ssize_t bread = read(tty_fd, &c, 1);
-    nothing = (errno==11);
-    error = errno!=11 && errno!=0;
-    return c;
+    char c;
+    if (LinuxPort::_read_block(&c, 1, nothing, error) != 1) return -1;
+    return (unsigned char)c;
+}
+
+int LinuxPort::_write(const char* data, int len, bool& error)
+{
+    int fd = tty_fd;
+    error = false;
+    if (fd <= 0 || !fd_writable) return 0;
+    ssize_t n = ::write(fd, data, len);
+    if (n >= 0) return n;
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) return 0;
+    Log::tracex("PORT", "Write error", "name {%s} {%d} {%s}", port_name, errno, strerror(errno));
+    error = true;
+    return 0;
+}
+
+void LinuxPort::enable_write(PortWritePolicy policy)
+{
+    Port::enable_write(policy);
+    if (writable) return;
+    writable = true;
+    if (is_open()) close();
+}
+
+int LinuxPort::_read_block(char* buf, int len, bool &nothing, bool& error)
+{
+    // one syscall for whatever is available, up to len; errno is only meaningful on failure
+    ssize_t bread = read(tty_fd, buf, len);
+    if (bread > 0)
+    {
+        nothing = bread < len;
+        error = false;
+        return bread;
+    }
+    nothing = (bread == 0 || errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+    error = !nothing;
+    return 0;
 }
 
 bool LinuxPort::_is_open()
 {
     return tty_fd;
 }
+
+void LinuxPort::enable_reader_thread()
+{
+    if (reader == nullptr)
+    {
+        queue = new LineQueue();
+        reader_speed = speed;
+        reader_run = true;
+        reader = new std::thread(&LinuxPort::reader_loop, this);
+    }
+}
+
+void LinuxPort::reader_queue(const char* line, int len)
+{
+    LinuxPortLine* slot = queue->acquire_write();
+    if (slot)
+    {
+        memcpy(slot->line, line, len);
+        slot->line[len] = 0;
+        slot->len = len;
+        slot->time_us = _micros();
+        queue->commit_write();
+    }
+    else
+    {
+        relaxed_inc(overflows);
+    }
+}
+
+void LinuxPort::reader_push(const char* data, int len)
+{
+    // same framing as Port::process_block, into reader_buffer
+    const char* p = data;
+    const char* end = data + len;
+    const char* cr = (const char*)memchr(p, 13, len);
+    const char* lf = (const char*)memchr(p, 10, len);
+    while (p < end)
+    {
+        if (cr && cr < p) cr = (const char*)memchr(p, 13, end - p);
+        if (lf && lf < p) lf = (const char*)memchr(p, 10, end - p);
+        const char* eol = (cr && (!lf || cr < lf)) ? cr : lf;
+        int n = (eol ? eol : end) - p;
+        if (reader_discarding)
+        {
+            if (eol) reader_discarding = false;
+        }
+        else if (reader_pos + n > PORT_BUFFER_SIZE - 1)
+        {
+            relaxed_inc(reader_overruns);
+            reader_pos = 0;
+            reader_discarding = (eol == nullptr);
+        }
+        else if (eol && reader_pos == 0)
+        {
+            // the whole line is in the block: queue it straight from there
+            if (n) reader_queue(p, n);
+        }
+        else
+        {
+            memcpy(reader_buffer + reader_pos, p, n);
+            reader_pos += n;
+            if (eol)
+            {
+                if (reader_pos) reader_queue(reader_buffer, reader_pos);
+                reader_pos = 0;
+            }
+        }
+        p = eol ? eol + 1 : end;
+    }
+}
+
+void LinuxPort::reader_loop()
+{
+    unsigned long last_open_try = 0;
+    bool first = true;
+    char block[PORT_READ_BLOCK_SIZE];
+    while (reader_run)
+    {
+        if (reopen_requested)
+        {
+            reopen_requested = false;
+            close_fd();
+            first = true; // a speed change reopens immediately
+        }
+        if (!tty_fd)
+        {
+            unsigned long now = _millis();
+            if (first || (now - last_open_try) >= 1000)
+            {
+                first = false;
+                last_open_try = now;
+                open_fd();
+                if (tty_fd)
+                {
+                    relaxed_inc(opens);
+                    reader_pos = 0;
+                    reader_discarding = false;
+                }
+            }
+            if (!tty_fd)
+            {
+                usleep(LINUX_PORT_POLL_MS * 1000);
+                continue;
+            }
+        }
+        struct pollfd pfd;
+        pfd.fd = tty_fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        int r = poll(&pfd, 1, LINUX_PORT_POLL_MS);
+        if (r <= 0) continue;
+        ssize_t n = read(tty_fd, block, PORT_READ_BLOCK_SIZE);
+        if (n > 0)
+        {
+            relaxed_inc(reader_bytes, n);
+            reader_push(block, n);
+        }
+        else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+        {
+            // end of file or error: the device is gone
+            Log::tracex("PORT", "Reader closing", "name {%s} errno {%d}", port_name, n ? errno : 0);
+            close_fd();
+            last_open_try = _millis();
+        }
+    }
+}
+
+void LinuxPort::enable_auto_baud(const unsigned int* rates, int n_rates)
+{
+    if (rates == nullptr || n_rates <= 0)
+    {
+        rates = DEFAULT_AUTOBAUD_RATES;
+        n_rates = sizeof(DEFAULT_AUTOBAUD_RATES) / sizeof(DEFAULT_AUTOBAUD_RATES[0]);
+    }
+    if (n_rates > LINUX_PORT_AUTOBAUD_MAX_RATES) n_rates = LINUX_PORT_AUTOBAUD_MAX_RATES;
+    memcpy(autobaud_rates, rates, n_rates * sizeof(unsigned int));
+    autobaud_n = n_rates;
+    autobaud_index = 0;
+    autobaud_locked = false;
+    autobaud_window = 0;
+    set_checksum_check(true);
+    set_speed(autobaud_rates[0]);
+}
+
+void LinuxPort::auto_baud(unsigned long now)
+{
+    PortStats s = get_stats();
+    if (autobaud_window == 0 || !is_open())
+    {
+        // (re)start the window once the port is open at the current rate
+        autobaud_window = is_open() ? now : 0;
+        autobaud_valid = s.checksum_valid;
+        autobaud_errors = s.checksum_errors;
+        autobaud_bytes = s.bytes;
+        return;
+    }
+    unsigned long valid = s.checksum_valid - autobaud_valid;
+    unsigned long errors = s.checksum_errors - autobaud_errors;
+    unsigned long bytes = s.bytes - autobaud_bytes;
+    if (!autobaud_locked && valid >= LINUX_PORT_AUTOBAUD_LINES && valid > errors)
+    {
+        autobaud_locked = true;
+        Log::tracex("PORT", "Baud locked", "name {%s} speed {%u} valid {%lu} errors {%lu}", port_name, speed, valid, errors);
+    }
+    if ((now - autobaud_window) < LINUX_PORT_AUTOBAUD_WINDOW_MS) return;
+
+    if (autobaud_locked)
+    {
+        // at a wrong rate the input is noise, that seldom even looks like a sentence; a quiet
+        // line keeps the lock
+        if (valid == 0 && bytes > 0)
+        {
+            autobaud_locked = false;
+            Log::tracex("PORT", "Baud lost", "name {%s} speed {%u} bytes {%lu} errors {%lu}", port_name, speed, bytes, errors);
+        }
+    }
+    if (!autobaud_locked)
+    {
+        autobaud_index = (autobaud_index + 1) % autobaud_n;
+        set_speed(autobaud_rates[autobaud_index]);
+    }
+    autobaud_window = 0;
+}
+
+void LinuxPort::maintain(unsigned long now)
+{
+    if (autobaud_n) auto_baud(now);
+    if (reader == nullptr)
+    {
+        Port::maintain(now);
+        return;
+    }
+    if (reader_speed != speed)
+    {
+        // picked up by the reader thread when reopening
+        reader_speed = speed;
+        reopen_requested = true;
+    }
+}
+
+bool LinuxPort::read_available(unsigned int ms)
+{
+    if (reader == nullptr) return Port::read_available(ms);
+    unsigned long long t0 = _micros();
+    LinuxPortLine* slot;
+    while ((slot = queue->front()) != nullptr)
+    {
+        unsigned long long now = _micros();
+        unsigned long long latency = now - slot->time_us;
+        if (latency > stats.latency_max_us) stats.latency_max_us = latency;
+        stats.latency_total_us += latency;
+        stats.lines++;
+        deliver(slot->line, slot->len);
+        queue->pop();
+        if ((now - t0) >= ms * 1000ULL) break;
+    }
+    return is_open();
+}
+
+LinuxPortReaderStats LinuxPort::get_reader_stats()
+{
+    LinuxPortReaderStats s = stats;
+    s.overflows = overflows.load(std::memory_order_relaxed);
+    s.overruns = reader_overruns.load(std::memory_order_relaxed);
+    s.opens = opens.load(std::memory_order_relaxed);
+    return s;
+}
+
+PortStats LinuxPort::get_stats()
+{
+    PortStats s = Port::get_stats();
+    if (reader)
+    {
+        LinuxPortReaderStats r = get_reader_stats();
+        s.bytes = reader_bytes.load(std::memory_order_relaxed) - bytes_base;
+        if (s.period_ms) s.bytes_per_sec = s.bytes * 1000.0f / s.period_ms;
+        s.overruns += r.overruns - stats_base.overruns;
+        s.dropped = r.overflows - stats_base.overflows;
+        s.opens = r.opens - stats_base.opens;
+    }
+    return s;
+}
+
+void LinuxPort::reset_stats()
+{
+    Port::reset_stats();
+    // the auto-baud window counts from the stats: restart it
+    autobaud_window = 0;
+    if (reader)
+    {
+        // the reader thread owns its counters: keep a baseline instead of clearing them
+        stats_base = get_reader_stats();
+        bytes_base = reader_bytes.load(std::memory_order_relaxed);
+    }
+}
 #endif
@@ -2,6 +2,40 @@
 #define LINUXPORT_H_
 
 #include "Ports.h"
+#include "SPSCQueue.h"
+#include <atomic>
+#include <thread>
+
+#ifndef LINUX_PORT_QUEUE_SLOTS
+#define LINUX_PORT_QUEUE_SLOTS 64 // lines buffered by the reader thread, must be a power of two
+#endif
+
+#ifndef LINUX_PORT_AUTOBAUD_WINDOW_MS
+#define LINUX_PORT_AUTOBAUD_WINDOW_MS 2000 // time given to each candidate rate
+#endif
+
+#ifndef LINUX_PORT_AUTOBAUD_LINES
+#define LINUX_PORT_AUTOBAUD_LINES 3 // valid sentences needed to lock on a rate
+#endif
+
+#define LINUX_PORT_AUTOBAUD_MAX_RATES 16
+
+struct LinuxPortLine
+{
+    int len;
+    unsigned long long time_us; // when the reader got the terminator
+    char line[PORT_BUFFER_SIZE];
+};
+
+struct LinuxPortReaderStats
+{
+    unsigned long lines = 0;     // delivered by listen()
+    unsigned long overflows = 0; // lines dropped because the queue was full
+    unsigned long overruns = 0;  // lines dropped because longer than PORT_BUFFER_SIZE - 1
+    unsigned long opens = 0;
+    unsigned long long latency_max_us = 0; // from the read of the terminator to the delivery
+    unsigned long long latency_total_us = 0;
+};
 
 class LinuxPort: public Port
 {
@@ -10,17 +44,82 @@ public:
     LinuxPort(const char* port_pathd = "/dev/ttyUSB0");
     ~LinuxPort();
     void set_port_name(const char* port_pathd);
+    // file descriptor of the open device, -1 when closed
+    int get_fd() const { int fd = tty_fd; return fd > 0 ? fd : -1; }
+
+    // Starts a thread that owns the device: it blocks on the fd, splits the data in lines
+    // and queues them, and reopens the device when needed. listen() then only delivers the
+    // queued lines (on_line, no partials). Not for ports driven by a PortReactor.
+    void enable_reader_thread();
+    LinuxPortReaderStats get_reader_stats();
+
+    // Tries the candidate rates in turn (by default 4800 to 921600) and locks on the first one
+    // producing valid NMEA checksums; a locked rate receiving data but no valid sentence for a
+    // whole window restarts the scan.
+    // Enables the checksum check of the port stats.
+    void enable_auto_baud(const unsigned int* rates = nullptr, int n_rates = 0);
+    bool is_baud_locked() const { return autobaud_locked; }
+
+    // the device is opened read-write from now on (reopened if already open read-only)
+    virtual void enable_write(PortWritePolicy policy = PORT_WRITE_DROP_NEW);
+
+    virtual void maintain(unsigned long now);
+    virtual bool read_available(unsigned int ms);
+
+    // with the reader thread, bytes, overruns and opens come from the reader
+    virtual PortStats get_stats();
+    virtual void reset_stats();
+
 protected:
 
     virtual void _open();
     virtual void _close();
     virtual int _read(bool &nothing_to_read, bool &error);
+    virtual int _read_block(char* buf, int len, bool &nothing_to_read, bool &error);
+    // with the reader thread, writes go to the fd it owns: a reopen in between drops them
+    virtual int _write(const char* data, int len, bool &error);
 	virtual bool _is_open();
 
 private:
-    int tty_fd;
+    class LineQueue: public SPSCQueue<LinuxPortLine, LINUX_PORT_QUEUE_SLOTS> {};
+
+    void open_fd();
+    void close_fd();
+    void auto_baud(unsigned long now);
+    void reader_loop();
+    void reader_push(const char* data, int len);
+    void reader_queue(const char* line, int len);
+
+    std::atomic<int> tty_fd;
+    std::atomic<bool> writable; // open the device read-write
+    std::atomic<bool> fd_writable;
     char port_name[32];
 
+    std::thread* reader = nullptr;
+    std::atomic<bool> reader_run;
+    std::atomic<bool> reopen_requested;
+    std::atomic<unsigned int> reader_speed;
+    LineQueue* queue = nullptr;
+    char reader_buffer[PORT_BUFFER_SIZE];
+    int reader_pos = 0;
+    bool reader_discarding = false;
+    std::atomic<unsigned long> overflows;
+    std::atomic<unsigned long> reader_overruns;
+    std::atomic<unsigned long> opens;
+    std::atomic<unsigned long> reader_bytes;
+    LinuxPortReaderStats stats; // the consumer side ones
+    LinuxPortReaderStats stats_base; // reader counters at the last reset_stats
+    unsigned long bytes_base = 0;
+
+    unsigned int autobaud_rates[LINUX_PORT_AUTOBAUD_MAX_RATES];
+    int autobaud_n = 0;     // 0: auto-baud disabled
+    int autobaud_index = 0;
+    bool autobaud_locked = false;
+    unsigned long autobaud_window = 0;
+    unsigned long autobaud_valid = 0; // stats counters at the start of the window
+    unsigned long autobaud_errors = 0;
+    unsigned long autobaud_bytes = 0;
+
 };
 
 
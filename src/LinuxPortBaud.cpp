@@ -0,0 +1,23 @@
+#if defined(NATIVE) && defined(__linux__)
+#include "LinuxPortBaud.h"
+#include <asm/termbits.h>
+#include <sys/ioctl.h>
+
+bool linux_port_set_custom_speed(int fd, unsigned int bps)
+{
+    struct termios2 tio;
+    if (ioctl(fd, TCGETS2, &tio) < 0) return false;
+    tio.c_cflag &= ~(CBAUD | (CBAUD << IBSHIFT));
+    tio.c_cflag |= BOTHER | (BOTHER << IBSHIFT);
+    tio.c_ospeed = bps;
+    tio.c_ispeed = bps;
+    return ioctl(fd, TCSETS2, &tio) == 0;
+}
+
+unsigned int linux_port_get_speed(int fd)
+{
+    struct termios2 tio;
+    if (ioctl(fd, TCGETS2, &tio) < 0) return 0;
+    return tio.c_ospeed;
+}
+#endif
@@ -0,0 +1,15 @@
+#ifndef _LINUX_PORT_BAUD_H
+#define _LINUX_PORT_BAUD_H
+
+#if defined(NATIVE) && defined(__linux__)
+
+// termios2/BOTHER helpers, in their own translation unit because <asm/termbits.h> cannot be
+// included together with <termios.h>
+
+// sets any rate (e.g. 250000) on an open tty, false if the driver refuses it
+bool linux_port_set_custom_speed(int fd, unsigned int bps);
+// the actual output rate of an open tty, 0 on error
+unsigned int linux_port_get_speed(int fd);
+
+#endif
+#endif // _LINUX_PORT_BAUD_H
@@ -4,6 +4,7 @@
 #include "Ports.h"
 #include <string.h>
 #include <queue>
+#include <string>
 
 /**
  * Mock implementation of Port for testing
@@ -62,6 +63,21 @@ public:
     {
         should_error_on_read = error;
     }
+
+    // bytes accepted by the next _write calls, -1 for no limit
+    void set_write_room(int room)
+    {
+        write_room = room;
+    }
+
+    void set_error_on_write(bool error)
+    {
+        should_error_on_write = error;
+    }
+
+    // what the port wrote to the "device"
+    const std::string& get_written() const { return written; }
+    void clear_written() { written.clear(); }
     
     // Query mock state
     int get_open_count() const { return open_count; }
@@ -134,6 +150,16 @@ public:
     }
     
 protected:
+    virtual int _write(const char* data, int len, bool &error) override
+    {
+        error = should_error_on_write;
+        if (error) return 0;
+        int n = (write_room >= 0 && write_room < len) ? write_room : len;
+        if (write_room >= 0) write_room -= n;
+        written.append(data, n);
+        return n;
+    }
+
     // Implementation of pure virtual methods from Port
     virtual void _open() override
     {
@@ -150,6 +176,9 @@ protected:
 private:
     bool is_open_flag;
     bool should_error_on_read = false;
+    bool should_error_on_write = false;
+    int write_room = -1;
+    std::string written;
     
     int open_count;
     int close_count;
@@ -17,8 +17,8 @@
 #else 
 #ifdef SOCKET_CAN
 #define N2K_CLASS_NAME "socket_can"
-#define N2K_CLASS tNMEA2000_SocketCAN
-#include <NMEA2000_SocketCAN.h>
+#define N2K_CLASS tNMEA2000_linux
+#include "N2KLinuxCAN.h"
 #endif
 #endif
 
@@ -28,25 +28,43 @@
 #include "N2K.h"
 #include "Utils.h"
 #include "Log.h"
+#include "SPSCQueue.h"
 #include <NMEA2000.h>
+#ifdef NATIVE
+#include "N2KVirtualBus.h"
+#include <thread>
+#include <atomic>
+#endif
 
 #define N2K_LOG_TAG "N2k"
 
-static bool static_initialized = false;
 static N2K *instance = NULL;
-static N2KStats stats;
-
-static n2k_msg_handler _handler = nullptr;
-static n2k_source_change_handler _source_handler = nullptr;
 static n2k_sent_message_handler _sent_message_handler = nullptr;
 
+struct N2KRxSlot
+{
+    tN2kMsg msg;
+    unsigned long long rx_time_us;
+};
+
+class N2KRxQueue: public SPSCQueue<N2KRxSlot, N2K_RX_QUEUE_SIZE> {};
+
+// catch-all library handler (PGN 0), routes the parsed messages to the owning instance
+class N2KReceiver: public tNMEA2000::tMsgHandler
+{
+public:
+    N2KReceiver(N2K *_n2k): tNMEA2000::tMsgHandler(0, nullptr), n2k(_n2k) {}
+    void HandleMsg(const tN2kMsg &N2kMsg) override { n2k->on_message(N2kMsg); }
+
+private:
+    N2K *n2k;
+};
+
 N2K *N2K::get_instance(n2k_msg_handler _msg_handler, n2k_source_change_handler _src_handler)
 {
     if (instance == NULL)
     {
-        _handler = _msg_handler;
-        _source_handler = _src_handler;
-        instance = new N2K();
+        instance = new N2K(_msg_handler, _src_handler);
     }
     return instance;
 }
@@ -56,21 +74,169 @@ void N2K::set_sent_message_callback(n2k_sent_message_handler _MsgHandler)
     _sent_message_handler = _MsgHandler;
 }
 
-N2K::N2K()
+N2K::N2K(n2k_msg_handler _msg_handler, n2k_source_change_handler _src_handler)
+    : handler(_msg_handler), source_handler(_src_handler)
 {
-    NMEA2000 = nullptr;
+    strcpy(socket_name, "can0");
     desired_source = N2K_SOURCE_DEFAULT;
     pgns.clear();
 }
 
 N2K::~N2K()
 {
+#ifdef NATIVE
+    if (rx_thread)
+    {
+        rx_thread_run = false;
+        rx_thread->join();
+        delete rx_thread;
+        rx_thread = nullptr;
+    }
+#endif
+    if (NMEA2000 && receiver) NMEA2000->DetachMsgHandler(receiver);
+    delete receiver;
+#ifdef NATIVE
+    // the backend created by setup (the esp32 drivers live as long as the firmware)
+    if (virtual_bus) virtual_bus->destroy_node((tNMEA2000_virtual *)NMEA2000);
+#ifdef SOCKET_CAN
+    else delete linux_can; // closes the socket
+#endif
+    NMEA2000 = nullptr;
+#endif
+    delete rx_queue;
+    delete tx_queue;
+    delete pgn_stats;
+    delete last_values;
+    delete bus_load;
+    delete decode_cache;
+    delete scheduler;
+    delete change_filter;
+    if (instance == this) instance = NULL;
+}
+
+void N2K::dispatch_message(const tN2kMsg &N2kMsg, unsigned long long rx_time_us)
+{
+    current_rx_time_us = rx_time_us;
+    unsigned long long latency = get_clock_us() - rx_time_us;
+    if (latency < 60000000ULL) relaxed_max(rx_latency_max_us, latency);
+    unsigned long t0 = pgn_stats ? _micros() : 0;
+    if (handler) handler(N2kMsg);
+    subscriptions.dispatch(N2kMsg);
+    if (pgn_stats) pgn_stats->record_handler(N2kMsg.PGN, _micros() - t0);
+}
+
+void N2K::queue_message(const tN2kMsg &N2kMsg, unsigned long long rx_time_us)
+{
+    N2KRxSlot *slot = rx_queue->acquire_write();
+    if (slot)
+    {
+        slot->msg = N2kMsg;
+        slot->rx_time_us = rx_time_us;
+        rx_queue->commit_write();
+        unsigned long depth = rx_queue->size();
+        if (depth > stats.rx_queue_hwm) stats.rx_queue_hwm = depth;
+    }
+    else
+    {
+        stats.rx_queue_overflow++;
+    }
+}
+
+int N2K::drain_rx_queue()
+{
+    int n = 0;
+    N2KRxSlot *m;
+    while ((m = rx_queue->front()) != nullptr)
+    {
+        dispatch_message(m->msg, m->rx_time_us);
+        rx_queue->pop();
+        n++;
+    }
+    return n;
+}
+
+#ifdef NATIVE
+void N2K::rx_thread_loop()
+{
+    while (rx_thread_run)
+    {
+        if (drain_rx_queue() == 0) msleep(1);
+    }
+}
+#endif
+
+unsigned long long N2K::get_clock_us()
+{
+#ifdef SOCKET_CAN
+    if (linux_can) return tNMEA2000_linux::realtime_us();
+#endif
+    return _micros();
+}
+
+unsigned long long N2K::receive_timestamp()
+{
+#ifdef SOCKET_CAN
+    // the message handler runs right after the library read the last frame of the message
+    if (linux_can) return linux_can->get_last_rx_timestamp_us();
+#endif
+    return _micros();
+}
+
+unsigned long long N2K::get_rx_timestamp_us()
+{
+    return current_rx_time_us;
 }
 
-void private_message_handler(const tN2kMsg &N2kMsg)
+void N2K::on_message(const tN2kMsg &N2kMsg)
 {
+    if (stats.recv == 0 && stats.startup_first_frame_ms == 0)
+    {
+        stats.startup_first_frame_ms = loop_time - setup_time;
+    }
     stats.recv++;
-    if (_handler) _handler(N2kMsg);
+    if (pgn_stats) pgn_stats->record_recv(N2kMsg, _millis());
+    if (bus_load)
+    {
+        unsigned long bits = bus_load->record(N2kMsg, loop_time);
+        if (pgn_stats) pgn_stats->record_bits(N2kMsg.PGN, N2kMsg.Source, bits);
+    }
+    if (last_values) last_values->update(N2kMsg, _millis());
+    unsigned long long t = receive_timestamp();
+    if (rx_queue) queue_message(N2kMsg, t);
+    else dispatch_message(N2kMsg, t);
+}
+
+void N2K::enable_rx_queue(bool use_thread)
+{
+    if (rx_queue == nullptr)
+    {
+        rx_queue = new N2KRxQueue();
+    }
+#ifdef NATIVE
+    if (use_thread && rx_thread == nullptr)
+    {
+        rx_thread_run = true;
+        rx_thread = new std::thread(&N2K::rx_thread_loop, this);
+    }
+#endif
+}
+
+bool N2K::has_rx_thread()
+{
+#ifdef NATIVE
+    return rx_thread != nullptr;
+#else
+    return false;
+#endif
+}
+
+N2KPgnStats *N2K::enable_pgn_stats()
+{
+    if (pgn_stats == nullptr)
+    {
+        pgn_stats = new N2KPgnStats();
+    }
+    return pgn_stats;
 }
 
 unsigned char N2K::get_source()
@@ -85,15 +251,32 @@ void N2K::set_desired_source(unsigned char src)
 
 bool N2K::is_initialized()
 {
-    return static_initialized;
+    return initialized;
 }
 
 void N2K::loop(unsigned long time)
 {
+    loop_time = time;
+    if (state == N2K_STATE_OPENING && NMEA2000)
+    {
+        try_open(time);
+    }
     if (is_initialized() && NMEA2000)
     {
         NMEA2000->ParseMessages();
+#ifdef NATIVE
+        if (rx_queue && rx_thread == nullptr) drain_rx_queue();
+#else
+        if (rx_queue) drain_rx_queue();
+#endif
         stats.canbus = NMEA2000->IsOpen() ? 1 : 0;
+        if (tx_queue && bus_load && bus_load_defer > 0)
+        {
+            tx_queue->set_hold(N2K_TX_LOW, bus_load->get_load(1, time) > bus_load_defer);
+        }
+        if (scheduler && stats.canbus) scheduler->loop(time);
+        if (tx_queue && stats.canbus) tx_queue->flush(time);
+        if (can_filter) update_can_filter();
         unsigned char s = NMEA2000->GetN2kSource();
         if (s != desired_source)
         {
@@ -101,7 +284,7 @@ void N2K::loop(unsigned long time)
             Log::tracex(N2K_LOG_TAG, "Source claim", "old {%d} new {%d}", desired_source, s);
             unsigned char old_s = desired_source;
             desired_source = s;
-            if (_source_handler) _source_handler(old_s, s);
+            if (source_handler) source_handler(old_s, s);
         }
     }
 }
@@ -113,12 +296,133 @@ void N2K::set_can_socket_name(const char *name)
     socket_name[sizeof(socket_name) - 1] = '\0';
 }
 
+int N2K::get_can_fd()
+{
+#ifdef SOCKET_CAN
+    if (linux_can && is_bus_connected()) return linux_can->get_fd();
+#endif
+    return -1;
+}
+
 void N2K::add_pgn(unsigned long pgn)
 {
     // Keep a simple vector of PGNs; we'll add a terminating 0 when passing to C API
     pgns.push_back(pgn);
 }
 
+N2KLastValueCache *N2K::enable_last_value_cache()
+{
+    if (last_values == nullptr)
+    {
+        last_values = new N2KLastValueCache();
+    }
+    return last_values;
+}
+
+N2KBusLoad *N2K::enable_bus_load(float defer_low_above)
+{
+    if (bus_load == nullptr)
+    {
+        bus_load = new N2KBusLoad();
+    }
+    bus_load_defer = defer_low_above;
+    return bus_load;
+}
+
+void N2K::decode_handler(const tN2kMsg &N2kMsg, void *context)
+{
+    ((N2KDecodeCache *)context)->update(N2kMsg, _millis());
+}
+
+N2KDecodeCache *N2K::enable_decode(unsigned long pgn, unsigned char source)
+{
+    if (!N2KDecodeCache::is_supported(pgn) || subscriptions_frozen(pgn)) return nullptr;
+    if (decode_cache == nullptr)
+    {
+        decode_cache = new N2KDecodeCache();
+    }
+    if (subscriptions.subscribe(pgn, decode_handler, decode_cache, source) < 0) return nullptr;
+    return decode_cache;
+}
+
+bool N2K::scheduler_tx(const tN2kMsg &N2kMsg, void *context)
+{
+    return ((N2K *)context)->send_msg(N2kMsg);
+}
+
+N2KScheduler *N2K::enable_scheduler()
+{
+    if (scheduler == nullptr)
+    {
+        scheduler = new N2KScheduler(scheduler_tx, this);
+    }
+    return scheduler;
+}
+
+N2KChangeFilter *N2K::enable_change_filter()
+{
+    if (change_filter == nullptr)
+    {
+        change_filter = new N2KChangeFilter();
+    }
+    return change_filter;
+}
+
+bool N2K::send_on_change(const tN2kMsg &N2kMsg, unsigned char instance, double value)
+{
+    if (change_filter == nullptr) return send_msg(N2kMsg);
+    unsigned long now = _millis();
+    if (!change_filter->check(N2kMsg, instance, value, now)) return true;
+    bool res = send_msg(N2kMsg);
+    if (res) change_filter->sent(N2kMsg, instance, value, now);
+    return res;
+}
+
+bool N2K::get_last_value(unsigned long pgn, unsigned char source, tN2kMsg &N2kMsg, unsigned long max_age_ms)
+{
+    return last_values && last_values->get(pgn, source, N2kMsg, _millis(), max_age_ms);
+}
+
+void N2K::enable_can_filter()
+{
+    can_filter = true;
+    can_filter_version = subscriptions.get_version() - 1; // force the first update
+}
+
+void N2K::update_can_filter()
+{
+#ifdef SOCKET_CAN
+    if (linux_can && can_filter_version != subscriptions.get_version())
+    {
+        unsigned long p[N2K_MAX_SUBSCRIPTIONS];
+        int n = subscriptions.get_pgns(p, N2K_MAX_SUBSCRIPTIONS);
+        linux_can->set_pgn_filter(p, n);
+        can_filter_version = subscriptions.get_version();
+        Log::tracex(N2K_LOG_TAG, "CAN filter", "pgns {%d}", n);
+    }
+#endif
+}
+
+bool N2K::subscriptions_frozen(unsigned long pgn)
+{
+    // the consumer thread dispatches without locking, the registry cannot change under it
+    if (!has_rx_thread()) return false;
+    Log::tracex(N2K_LOG_TAG, "Subscriptions frozen", "pgn {%lu}", pgn);
+    return true;
+}
+
+int N2K::subscribe(unsigned long pgn, n2k_pgn_handler handler, void *context, unsigned char source)
+{
+    if (subscriptions_frozen(pgn)) return -1;
+    return subscriptions.subscribe(pgn, handler, context, source);
+}
+
+void N2K::unsubscribe(int handle)
+{
+    if (subscriptions_frozen(0)) return;
+    subscriptions.unsubscribe(handle);
+}
+
 #ifndef NATIVE
 #define CREATE_NMEA \
 Log::tracex(N2K_LOG_TAG, "Initializing N2K", "RX {%d} TX {%d} source {%d}", CAN_RX_PIN, CAN_TX_PIN, desired_source); \
@@ -126,27 +430,30 @@ NMEA2000 = new N2K_CLASS(CAN_TX_PIN, CAN_RX_PIN);
 #else
 #ifdef SOCKET_CAN
 #define CREATE_NMEA \
-Log::trace(N2K_LOG_TAG, "Initializing N2K", "socket {%s}", socket_name); \
-NMEA2000 = new tNMEA2000_SocketCAN(socket_name);
+if (virtual_bus) { \
+NMEA2000 = virtual_bus->create_node(); \
+} else { \
+Log::tracex(N2K_LOG_TAG, "Initializing N2K", "socket {%s}", socket_name); \
+NMEA2000 = linux_can = new N2K_CLASS(socket_name); \
+}
 #else
 #define CREATE_NMEA \
-NMEA2000 = nullptr;
+NMEA2000 = virtual_bus ? virtual_bus->create_node() : nullptr;
 #endif
 #endif
 
 void N2K::setup(n2k_device_info dvc)
 {
-    if (!is_initialized())
+    if (state == N2K_STATE_IDLE)
     {
         CREATE_NMEA
         if (NMEA2000)
         {
             NMEA2000->SetProductInformation(dvc.ModelSerialCode.c_str(), dvc.ProductCode, dvc.ModelID.c_str(), dvc.SwCode.c_str(), dvc.ModelVersion.c_str());
             NMEA2000->SetDeviceInformation(dvc.UniqueNumber, dvc.DeviceFunction, dvc.DeviceClass, dvc.ManufacturerCode);
-            if (_handler)
-            {
-                NMEA2000->SetMsgHandler(private_message_handler);
-            }
+            // always installed, subscriptions can be added after setup
+            receiver = new N2KReceiver(this);
+            NMEA2000->AttachMsgHandler(receiver);
             NMEA2000->SetMode(tNMEA2000::N2km_NodeOnly, desired_source);
             NMEA2000->SetN2kCANSendFrameBufSize(1000);
             NMEA2000->EnableForward(false); // Disable all msg forwarding to USB (=Serial)
@@ -156,46 +463,103 @@ void N2K::setup(n2k_device_info dvc)
                 ext.push_back(0);
                 NMEA2000->ExtendTransmitMessages(ext.data());
             }
-            int retry = 0;
-            do {
-                static_initialized = NMEA2000->Open();
-                if (!static_initialized)
-                {
-                    retry++;
-                    Log::tracex(N2K_LOG_TAG, "Failed N2K init", "Retry {%d}", retry);
-                    msleep(1000);
-                }
-            } while (!static_initialized && retry < 5);
-            Log::tracex(N2K_LOG_TAG, "initialized", "success {%s}", is_initialized() ? "OK" : "KO");
+            // opened from loop() with backoff, so that setup never blocks
+            state = N2K_STATE_OPENING;
+            open_retry_ms = N2K_OPEN_RETRY_MS;
+            open_tried = false;
         }
     }
 }
 
+void N2K::try_open(unsigned long time)
+{
+    if (!open_tried)
+    {
+        open_tried = true;
+        setup_time = time;
+        next_open_try = time;
+    }
+    if ((long)(time - next_open_try) < 0) return;
+    stats.open_attempts++;
+    initialized = NMEA2000->Open();
+    if (initialized)
+    {
+        state = N2K_STATE_READY;
+        stats.startup_open_ms = time - setup_time;
+        Log::tracex(N2K_LOG_TAG, "initialized", "success {OK} attempts {%lu} time {%lums}", stats.open_attempts, stats.startup_open_ms);
+        if (ready_handler) ready_handler(this);
+    }
+    else
+    {
+        Log::tracex(N2K_LOG_TAG, "Failed N2K init", "Retry {%lu} in {%lums}", stats.open_attempts, open_retry_ms);
+        next_open_try = time + open_retry_ms;
+        open_retry_ms = open_retry_ms * 2 > N2K_OPEN_RETRY_MAX_MS ? N2K_OPEN_RETRY_MAX_MS : open_retry_ms * 2;
+    }
+}
+
 bool N2K::is_bus_connected()
 {
     return NMEA2000 && NMEA2000->IsOpen();
 }
 
-bool N2K::send_msg(const tN2kMsg &N2kMsg)
+void N2K::tx_result(const tN2kMsg &N2kMsg, bool success, void *context)
+{
+    N2K *n2k = (N2K *)context;
+    n2k_sent_message_handler h = n2k->sent_handler ? n2k->sent_handler : _sent_message_handler;
+    if (h) h(N2kMsg, success);
+}
+
+bool N2K::tx_function(const tN2kMsg &N2kMsg, void *context)
+{
+    N2K *n2k = (N2K *)context;
+    bool res = n2k->NMEA2000->SendMsg(N2kMsg);
+    if (res)
+    {
+        n2k->stats.sent++;
+    }
+    else
+    {
+        //Log::tracex(N2K_LOG_TAG, "Failed message", "PGN {%d}", N2kMsg.PGN);
+        n2k->stats.fail++;
+    }
+    if (n2k->pgn_stats) n2k->pgn_stats->record_sent(N2kMsg.PGN, res);
+    if (res && n2k->bus_load)
+    {
+        // SendMsg has stamped our source on the message
+        unsigned long bits = n2k->bus_load->record(N2kMsg, n2k->loop_time);
+        if (n2k->pgn_stats) n2k->pgn_stats->record_bits(N2kMsg.PGN, N2kMsg.Source, bits);
+    }
+    return res;
+}
+
+void N2K::enable_tx_queue()
+{
+    if (tx_queue == nullptr)
+    {
+        tx_queue = new N2KTxQueue(tx_function, tx_result, this);
+    }
+}
+
+bool N2K::send_msg(const tN2kMsg &N2kMsg, bool echo)
 {
     if (is_bus_connected() && NMEA2000)
     {
-        if (_handler)
+        if (echo)
         {
             // notify internal listeners, that otherwise would not get the message
-            _handler(N2kMsg);
-        }
-        bool res = NMEA2000->SendMsg(N2kMsg);
-        if (res)
-        {
-            stats.sent++;
+            // (through the queue when enabled, so the handlers always run on the same side)
+            unsigned long long t = get_clock_us();
+            if (last_values) last_values->update(N2kMsg, _millis());
+            if (rx_queue) queue_message(N2kMsg, t);
+            else dispatch_message(N2kMsg, t);
         }
-        else
+        if (tx_queue)
         {
-            //Log::tracex(N2K_LOG_TAG, "Failed message", "PGN {%d}", N2kMsg.PGN);
-            stats.fail++;
+            // aged by flush() on the loop time
+            return tx_queue->send(N2kMsg, loop_time);
         }
-        if (_sent_message_handler) _sent_message_handler(N2kMsg, res);
+        bool res = tx_function(N2kMsg, this);
+        tx_result(N2kMsg, res, this);
         return res;
     }
     else
@@ -206,7 +570,24 @@ bool N2K::send_msg(const tN2kMsg &N2kMsg)
 
 void N2KStats::dump()
 {
-    Log::tracex(N2K_LOG_TAG, "Stats", "bus {%d} tx {%d/%d} rx {%d}", canbus, sent, fail, recv);
+    Log::tracex(N2K_LOG_TAG, "Stats", "bus {%d} tx {%d/%d} rx {%d} rxq hwm {%d} overflow {%d}", canbus, sent, fail, recv, rx_queue_hwm, rx_queue_overflow);
+    if (tx_queue_enabled)
+    {
+        for (int i = 0; i < N2K_TX_CLASSES; i++)
+        {
+            Log::tracex(N2K_LOG_TAG, "Stats", "txq class {%d} depth {%d/%d} dropped {%d} stale {%d} retried {%d}",
+                i, tx[i].depth, tx[i].hwm, tx[i].dropped, tx[i].stale, tx[i].retried);
+        }
+    }
+    if (can_filtered) Log::tracex(N2K_LOG_TAG, "Stats", "can filtered {%lu}", can_filtered);
+    if (can_rx_syscalls) Log::tracex(N2K_LOG_TAG, "Stats", "can rx frames {%lu} syscalls {%lu}", can_rx_frames, can_rx_syscalls);
+    Log::tracex(N2K_LOG_TAG, "Stats", "rx latency max {%luus}", (unsigned long)rx_latency_max_us);
+    if (bus_load_60s > 0) Log::tracex(N2K_LOG_TAG, "Stats", "bus load 1s {%.1f%%} 10s {%.1f%%} 60s {%.1f%%} low held {%d}", bus_load_1s, bus_load_10s, bus_load_60s, tx_low_held);
+    if (change_suppressed) Log::tracex(N2K_LOG_TAG, "Stats", "on change suppressed {%lu} saved {%lu bits}", change_suppressed, change_bits_saved);
+    Log::tracex(N2K_LOG_TAG, "Stats", "startup open {%lums} first frame {%lums} attempts {%lu}", startup_open_ms, startup_first_frame_ms, open_attempts);
+    if (pgn_stats) pgn_stats->dump();
+    if (scheduler) scheduler->dump();
+    if (change_filter) change_filter->dump();
 }
 
 void N2KStats::dump_and_reset()
@@ -220,9 +601,61 @@ void N2KStats::reset()
     recv = 0;
     sent = 0;
     fail = 0;
+    rx_queue_overflow = 0;
+    rx_queue_hwm = 0;
+    rx_latency_max_us = 0;
+    for (int i = 0; i < N2K_TX_CLASSES; i++)
+    {
+        tx[i].dropped = 0;
+        tx[i].stale = 0;
+        tx[i].retried = 0;
+        tx[i].hwm = tx[i].depth;
+    }
+    if (pgn_stats) pgn_stats->reset();
+    if (scheduler) scheduler->reset_stats();
+    if (change_filter) change_filter->reset_stats();
+}
+
+void N2K::reset_stats()
+{
+    stats.pgn_stats = pgn_stats;
+    stats.scheduler = scheduler;
+    stats.change_filter = change_filter;
+    stats.reset();
+    rx_latency_max_us.store(0, std::memory_order_relaxed);
+    if (tx_queue) tx_queue->reset_stats();
 }
 
 N2KStats N2K::getStats()
 {
+    if (tx_queue)
+    {
+        stats.tx_queue_enabled = true;
+        for (int i = 0; i < N2K_TX_CLASSES; i++) stats.tx[i] = tx_queue->get_stats(i);
+    }
+    stats.rx_latency_max_us = rx_latency_max_us.load(std::memory_order_relaxed);
+    stats.pgn_stats = pgn_stats;
+    stats.scheduler = scheduler;
+    stats.change_filter = change_filter;
+    if (change_filter)
+    {
+        stats.change_suppressed = change_filter->get_suppressed();
+        stats.change_bits_saved = change_filter->get_bits_saved();
+    }
+    if (bus_load)
+    {
+        stats.bus_load_1s = bus_load->get_load(1, loop_time);
+        stats.bus_load_10s = bus_load->get_load(10, loop_time);
+        stats.bus_load_60s = bus_load->get_load(60, loop_time);
+        stats.tx_low_held = tx_queue && tx_queue->is_held(N2K_TX_LOW);
+    }
+#ifdef SOCKET_CAN
+    if (linux_can)
+    {
+        stats.can_filtered = linux_can->get_filtered();
+        stats.can_rx_frames = linux_can->get_rx_frames();
+        stats.can_rx_syscalls = linux_can->get_rx_syscalls();
+    }
+#endif
     return stats;
 }
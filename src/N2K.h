@@ -3,14 +3,42 @@
 
 #include <N2kMessages.h>
 #include "Utils.h"
+#include "N2KSubscriptions.h"
+#include "N2KTxQueue.h"
+#include "N2KPgnStats.h"
+#include "N2KLastValueCache.h"
+#include "N2KBusLoad.h"
+#include "N2KDecodeCache.h"
+#include "N2KScheduler.h"
+#include "N2KChangeFilter.h"
 #include <vector>
 #include <string>
+#include <atomic>
+#ifdef NATIVE
+#include <thread>
+#endif
 
 #ifndef N2K_SOURCE_DEFAULT
 #define N2K_SOURCE_DEFAULT  22
 #endif
 
+// first retry delay when the CAN bus cannot be opened, doubled at every failure up to the max
+#ifndef N2K_OPEN_RETRY_MS
+#define N2K_OPEN_RETRY_MS 1000
+#endif
+#ifndef N2K_OPEN_RETRY_MAX_MS
+#define N2K_OPEN_RETRY_MAX_MS 30000
+#endif
+
+#ifndef N2K_RX_QUEUE_SIZE
+#define N2K_RX_QUEUE_SIZE 64 // must be a power of two
+#endif
+
 class tNMEA2000;
+class N2KVirtualBus;
+class tNMEA2000_linux;
+class N2KReceiver;
+class N2KRxQueue;
 
 class N2KStats
 {
@@ -19,7 +47,28 @@ public:
     unsigned long sent = 0;
     unsigned long fail = 0;
     unsigned char canbus = 0;
+    unsigned long rx_queue_overflow = 0;
+    unsigned long rx_queue_hwm = 0;
+    bool tx_queue_enabled = false;
+    N2KTxClassStats tx[N2K_TX_CLASSES];
+    N2KPgnStats *pgn_stats = nullptr; // live per-PGN counters, when enabled
+    N2KScheduler *scheduler = nullptr; // periodic transmissions, when enabled
+    N2KChangeFilter *change_filter = nullptr;
+    unsigned long can_filtered = 0;   // frames dropped by the kernel CAN filters (linux)
+    unsigned long can_rx_frames = 0;  // frames read from the CAN socket (linux)
+    unsigned long can_rx_syscalls = 0;
+    unsigned long long rx_latency_max_us = 0; // from reception to handler dispatch
+    unsigned long startup_open_ms = 0;        // from the first loop after setup to bus open
+    unsigned long startup_first_frame_ms = 0; // from the first loop after setup to the first received message
+    unsigned long open_attempts = 0;
+    float bus_load_1s = 0;    // % of the bitrate, when the bus load is enabled
+    float bus_load_10s = 0;
+    float bus_load_60s = 0;
+    bool tx_low_held = false; // low priority transmissions deferred by the bus load
+    unsigned long change_suppressed = 0; // messages not sent by send_on_change
+    unsigned long change_bits_saved = 0;
     void dump();
+    // clears this copy and the shared tables it points to; N2K::reset_stats resets the instance
     void reset();
     void dump_and_reset();
 };
@@ -41,19 +90,40 @@ struct n2k_device_info
 typedef void (*n2k_msg_handler)(const tN2kMsg &N2kMsg);
 typedef void (*n2k_source_change_handler)(const unsigned char old_source, const unsigned char new_source);
 typedef void (*n2k_sent_message_handler)(const tN2kMsg &N2kMsg, bool success);
+class N2K;
+typedef void (*n2k_ready_handler)(N2K *n2k);
+
+enum n2k_state
+{
+    N2K_STATE_IDLE,    // setup not called yet
+    N2K_STATE_OPENING, // waiting for the bus to open, retried from loop()
+    N2K_STATE_READY
+};
 
 class N2K {
 
     public:
+        // Default process-wide instance, created at the first call (the handlers of later calls are ignored).
         static N2K* get_instance(n2k_msg_handler _msg_handler, n2k_source_change_handler _src_handler);
 
+        // One instance per CAN interface, each with its own stats, handlers and queues.
+        N2K(n2k_msg_handler _msg_handler = nullptr, n2k_source_change_handler _src_handler = nullptr);
+
         virtual ~N2K();
 
+        // Creates and configures the bus without blocking: opening is attempted at the first
+        // loop() and then retried with exponential backoff until it succeeds, all on the loop time.
         void setup(n2k_device_info dvc);
 
         void loop(unsigned long time);
 
-        bool send_msg(const tN2kMsg &N2kMsg);
+        n2k_state get_state() { return state; }
+
+        // called once, from loop, when the bus is open
+        void set_ready_callback(n2k_ready_handler handler) { ready_handler = handler; }
+
+        // echo=false skips the internal listeners (used when forwarding between instances)
+        bool send_msg(const tN2kMsg &N2kMsg, bool echo = true);
 
         bool is_initialized();
 
@@ -61,23 +131,147 @@ class N2K {
 
         // used only on linux
         void set_can_socket_name(const char* name);
+        // the SocketCAN socket, for waiting on it (e.g. PortReactor); -1 if not open or not linux
+        int get_can_fd();
+
+#ifdef NATIVE
+        // attach to an in-process virtual bus instead of a CAN interface (call before setup);
+        // the bus must outlive the instance, that frees its node when destroyed
+        void set_virtual_bus(N2KVirtualBus *bus) { virtual_bus = bus; }
+#endif
 
+        // Linux SocketCAN only: install kernel filters so that only the subscribed PGNs (plus the
+        // ISO/address-claim ones) reach userspace. Filters follow subscription changes; with no
+        // subscriptions only the ISO/address-claim PGNs are received.
+        // Note that with filters on, the legacy n2k_msg_handler only sees the subscribed PGNs too.
+        void enable_can_filter();
+
+        // Snapshot of the counters, to take from the loop() thread; the values updated by the rx
+        // consumer thread are read atomically.
         N2KStats getStats();
+        // resets the instance counters, the tx queue ones and the enabled stats tables
+        void reset_stats();
+
+        // Receive time of the message being dispatched, valid inside handlers. With the linux
+        // SocketCAN backend it is the kernel timestamp of the last frame, otherwise the local
+        // clock when the message was parsed. Both in get_clock_us() units.
+        unsigned long long get_rx_timestamp_us();
+        unsigned long long get_clock_us();
 
         unsigned char get_source();
         void set_desired_source(unsigned char src);
 
         void add_pgn(unsigned long pgns);
 
+        // Register a handler (with its context) for a PGN, optionally restricted to one source.
+        // Returns a handle for unsubscribe, or -1 if N2K_MAX_SUBSCRIPTIONS is reached.
+        // Subscriptions are frozen once the rx consumer thread runs (enable_rx_queue(true)):
+        // subscribe before enabling it, later calls (and enable_decode) are refused.
+        int subscribe(unsigned long pgn, n2k_pgn_handler handler, void *context, unsigned char source = N2K_ANY_SOURCE);
+        void unsubscribe(int handle);
+
+        // default for all the instances that do not set their own callback
         static void set_sent_message_callback(n2k_sent_message_handler _MsgHandler);
+        void set_sent_callback(n2k_sent_message_handler _MsgHandler) { sent_handler = _MsgHandler; }
+
+        // Queue received messages and call the handler from a later phase of loop() instead of
+        // inline while the frames are parsed. On native, use_thread dispatches from a consumer thread:
+        // handlers then run concurrently with loop() and must not send on this instance.
+        void enable_rx_queue(bool use_thread = false);
+        // true if the handlers run on the rx consumer thread
+        bool has_rx_thread();
+
+        // Schedule transmissions by priority class: messages that cannot be sent right away are
+        // queued and retried from loop(), and send_msg returns true if the message was sent or queued.
+        void enable_tx_queue();
+
+        // Track per-PGN and per-source counters plus inter-arrival and handler time histograms.
+        // The returned table can be read (snapshot/reset) from a monitoring task without blocking loop().
+        N2KPgnStats *enable_pgn_stats();
+
+        // Keep the most recent message per (PGN, source), for consumers that poll at their own rate.
+        N2KLastValueCache *enable_last_value_cache();
+        // shortcut for the cache lookup; false if the cache is disabled, empty or stale
+        bool get_last_value(unsigned long pgn, unsigned char source, tN2kMsg &N2kMsg, unsigned long max_age_ms = 0);
+
+        // Estimate the bus utilization from the received and sent messages; the per-PGN and
+        // per-source breakdown goes to the PGN stats when enabled. With the tx queue enabled and
+        // defer_low_above > 0, low priority messages are held while the 1s load is above that %.
+        // The seconds are counted on the time passed to loop().
+        N2KBusLoad *enable_bus_load(float defer_low_above = 0);
+
+        // Decode a high-rate PGN (see N2KDecodeCache) once per message into the shared cache,
+        // from one source or from any. Call once per PGN; nullptr if the PGN is not supported
+        // or the subscriptions are exhausted or frozen.
+        N2KDecodeCache *enable_decode(unsigned long pgn, unsigned char source = N2K_ANY_SOURCE);
+        N2KDecodeCache *get_decode_cache() { return decode_cache; }
+
+        // Periodic transmissions, run from loop() once the bus is open (see N2KScheduler).
+        N2KScheduler *enable_scheduler();
+
+        // Change-driven transmission: set the dead-band and heartbeat per PGN on the returned
+        // filter, then send through send_on_change.
+        N2KChangeFilter *enable_change_filter();
+        // Sends the message only if value (the one the dead-band applies to) changed enough since
+        // the last transmission for the same PGN and instance, or the heartbeat expired. Returns
+        // true if the message was sent or deliberately suppressed.
+        bool send_on_change(const tN2kMsg &N2kMsg, unsigned char instance, double value);
 
     private:
-        N2K();
-        tNMEA2000* NMEA2000;
+        static bool tx_function(const tN2kMsg &N2kMsg, void *context);
+        static void tx_result(const tN2kMsg &N2kMsg, bool success, void *context);
+        unsigned long long receive_timestamp();
+        friend class N2KReceiver;
+        void on_message(const tN2kMsg &N2kMsg);
+        void dispatch_message(const tN2kMsg &N2kMsg, unsigned long long rx_time_us);
+        void queue_message(const tN2kMsg &N2kMsg, unsigned long long rx_time_us);
+        int drain_rx_queue();
+
+        tNMEA2000* NMEA2000 = nullptr;
+        N2KReceiver *receiver = nullptr;
+        bool initialized = false;
+        N2KStats stats;
+        // written by the dispatching thread (the rx consumer one, when enabled), copied by getStats()
+        std::atomic<unsigned long long> rx_latency_max_us{0};
+        n2k_msg_handler handler;
+        n2k_source_change_handler source_handler;
+        n2k_sent_message_handler sent_handler = nullptr;
+        N2KSubscriptions subscriptions;
+        N2KRxQueue *rx_queue = nullptr;
+        N2KTxQueue *tx_queue = nullptr;
+        N2KPgnStats *pgn_stats = nullptr;
+        N2KLastValueCache *last_values = nullptr;
+        N2KBusLoad *bus_load = nullptr;
+        N2KDecodeCache *decode_cache = nullptr;
+        static void decode_handler(const tN2kMsg &N2kMsg, void *context);
+        N2KScheduler *scheduler = nullptr;
+        N2KChangeFilter *change_filter = nullptr;
+        static bool scheduler_tx(const tN2kMsg &N2kMsg, void *context);
+        float bus_load_defer = 0;
+        unsigned long long current_rx_time_us = 0;
         char socket_name[32];
         unsigned char desired_source;
         std::vector<unsigned long> pgns;
         n2k_device_info device_info;
+        void update_can_filter();
+        bool subscriptions_frozen(unsigned long pgn);
+        void try_open(unsigned long time);
+        n2k_state state = N2K_STATE_IDLE;
+        n2k_ready_handler ready_handler = nullptr;
+        unsigned long setup_time = 0; // loop time of the first open attempt
+        unsigned long loop_time = 0;  // time passed to the running loop()
+        bool open_tried = false;
+        unsigned long next_open_try = 0;
+        unsigned long open_retry_ms = N2K_OPEN_RETRY_MS;
+        bool can_filter = false;
+        unsigned long can_filter_version = 0;
+#ifdef NATIVE
+        N2KVirtualBus *virtual_bus = nullptr;
+        tNMEA2000_linux *linux_can = nullptr;
+        std::thread *rx_thread = nullptr;
+        std::atomic<bool> rx_thread_run{false};
+        void rx_thread_loop();
+#endif
 
 };
 
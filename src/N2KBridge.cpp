@@ -0,0 +1,103 @@
+#include "N2KBridge.h"
+#include "N2K.h"
+#include "Log.h"
+
+#define N2K_BRIDGE_LOG_TAG "N2kBridge"
+
+N2KBridge::N2KBridge(N2K *a, N2K *b)
+{
+    routes[N2K_BRIDGE_A_TO_B].from = a;
+    routes[N2K_BRIDGE_A_TO_B].to = b;
+    routes[N2K_BRIDGE_B_TO_A].from = b;
+    routes[N2K_BRIDGE_B_TO_A].to = a;
+    for (int d = 0; d < 2; d++) routes[d].n_pgns = 0;
+}
+
+N2KBridge::~N2KBridge()
+{
+    for (int d = 0; d < 2; d++)
+    {
+        for (int i = 0; i < routes[d].n_pgns; i++) routes[d].from->unsubscribe(routes[d].handles[i]);
+        routes[d].n_pgns = 0;
+    }
+}
+
+bool N2KBridge::allow(n2k_bridge_direction direction, unsigned long pgn)
+{
+    route &r = routes[direction];
+    for (int i = 0; i < r.n_pgns; i++)
+    {
+        if (r.pgns[i] == pgn) return true;
+    }
+    if (r.n_pgns >= N2K_BRIDGE_MAX_PGNS) return false;
+    if (r.from->has_rx_thread())
+    {
+        // tNMEA2000 is not thread safe: the destination would be driven from two threads
+        Log::tracex(N2K_BRIDGE_LOG_TAG, "Refused", "pgn {%lu} reason {source rx thread}", pgn);
+        return false;
+    }
+    int h = r.from->subscribe(pgn, forward, &r);
+    if (h < 0) return false;
+    r.pgns[r.n_pgns] = pgn;
+    r.handles[r.n_pgns] = h;
+    r.n_pgns++;
+    return true;
+}
+
+void N2KBridge::disallow(n2k_bridge_direction direction, unsigned long pgn)
+{
+    route &r = routes[direction];
+    for (int i = 0; i < r.n_pgns; i++)
+    {
+        if (r.pgns[i] == pgn)
+        {
+            r.from->unsubscribe(r.handles[i]);
+            r.n_pgns--;
+            r.pgns[i] = r.pgns[r.n_pgns];
+            r.handles[i] = r.handles[r.n_pgns];
+            return;
+        }
+    }
+}
+
+void N2KBridge::forward(const tN2kMsg &N2kMsg, void *context)
+{
+    route *r = (route *)context;
+    // the rx thread was enabled after allow()
+    if (r->from->has_rx_thread())
+    {
+        r->stats.dropped++;
+        return;
+    }
+    // SendMsg stamps the destination node address on the message, restore it for the other subscribers
+    unsigned char source = N2kMsg.Source;
+    bool ok = r->to->send_msg(N2kMsg, false);
+    N2kMsg.ForceSource(source);
+    if (ok)
+    {
+        unsigned long latency = (unsigned long)(r->from->get_clock_us() - r->from->get_rx_timestamp_us());
+        r->stats.forwarded++;
+        r->stats.latency_total_us += latency;
+        if (latency > r->stats.latency_max_us) r->stats.latency_max_us = latency;
+    }
+    else
+    {
+        r->stats.dropped++;
+    }
+}
+
+void N2KBridge::reset_stats()
+{
+    for (int d = 0; d < 2; d++) routes[d].stats = N2KBridgeStats();
+}
+
+void N2KBridge::dump()
+{
+    for (int d = 0; d < 2; d++)
+    {
+        N2KBridgeStats &s = routes[d].stats;
+        Log::tracex(N2K_BRIDGE_LOG_TAG, "Stats", "dir {%s} pgns {%d} forwarded {%lu} dropped {%lu} latency avg {%luus} max {%luus}",
+            d == N2K_BRIDGE_A_TO_B ? "a>b" : "b>a", routes[d].n_pgns, s.forwarded, s.dropped,
+            s.forwarded ? (unsigned long)(s.latency_total_us / s.forwarded) : 0UL, s.latency_max_us);
+    }
+}
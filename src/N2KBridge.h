@@ -0,0 +1,68 @@
+#ifndef _N2K_BRIDGE_H
+#define _N2K_BRIDGE_H
+
+#include <N2kMsg.h>
+
+#ifndef N2K_BRIDGE_MAX_PGNS
+#define N2K_BRIDGE_MAX_PGNS 16 // per direction
+#endif
+
+class N2K;
+
+enum n2k_bridge_direction
+{
+    N2K_BRIDGE_A_TO_B = 0,
+    N2K_BRIDGE_B_TO_A = 1
+};
+
+struct N2KBridgeStats
+{
+    unsigned long forwarded = 0;
+    unsigned long dropped = 0;            // destination bus down or send failed
+    unsigned long latency_max_us = 0;     // from reception on one bus to send on the other
+    unsigned long long latency_total_us = 0;
+};
+
+/**
+ * Forwards messages between two N2K instances (e.g. a backbone and an isolated engine bus)
+ * through per-direction PGN allow-lists. Messages are handed from the receiving instance's
+ * subscription straight to the other instance's send_msg, without copies unless its tx queue
+ * is enabled, and are not echoed to the listeners of the destination, so that the opposite
+ * direction never sees them again. As for any bridge, forwarded messages take the source
+ * address of the destination node.
+ * Forwarding calls the destination send_msg from the dispatch of the source instance, so both
+ * instances must be looped by the same thread: a source dispatching on its rx thread
+ * (enable_rx_queue(true)) is refused by allow() and its messages are dropped.
+ */
+class N2KBridge
+{
+public:
+    N2KBridge(N2K *a, N2K *b);
+    ~N2KBridge();
+
+    // Forward pgn in the given direction; false if N2K_BRIDGE_MAX_PGNS or the subscriptions are
+    // exhausted, or if the source instance dispatches on its rx thread.
+    bool allow(n2k_bridge_direction direction, unsigned long pgn);
+    void disallow(n2k_bridge_direction direction, unsigned long pgn);
+
+    N2KBridgeStats get_stats(n2k_bridge_direction direction) { return routes[direction].stats; }
+    void reset_stats();
+    void dump();
+
+private:
+    struct route
+    {
+        N2K *from;
+        N2K *to;
+        unsigned long pgns[N2K_BRIDGE_MAX_PGNS];
+        int handles[N2K_BRIDGE_MAX_PGNS];
+        int n_pgns;
+        N2KBridgeStats stats;
+    };
+
+    static void forward(const tN2kMsg &N2kMsg, void *context);
+
+    route routes[2];
+};
+
+#endif // _N2K_BRIDGE_H
@@ -0,0 +1,154 @@
+#include "N2KBusLoad.h"
+#include "Utils.h"
+
+// CRC15 and stuff bit counter over the stuffable part of a frame (SOF to CRC)
+struct frame_bit_counter
+{
+    unsigned int crc = 0;
+    int run = 0;
+    int last = -1;
+    unsigned long bits = 0;
+
+    void stuff(int bit)
+    {
+        bits++;
+        if (bit == last)
+        {
+            run++;
+            if (run == 5)
+            {
+                // the complementary stuff bit starts a new run
+                bits++;
+                last = !bit;
+                run = 1;
+            }
+        }
+        else
+        {
+            last = bit;
+            run = 1;
+        }
+    }
+
+    void put(unsigned long value, int n)
+    {
+        for (int i = n - 1; i >= 0; i--)
+        {
+            int bit = (value >> i) & 1;
+            int crc_next = bit ^ ((crc >> 14) & 1);
+            crc = (crc << 1) & 0x7FFF;
+            if (crc_next) crc ^= 0x4599;
+            stuff(bit);
+        }
+    }
+
+    void put_crc()
+    {
+        unsigned int c = crc;
+        for (int i = 14; i >= 0; i--) stuff((c >> i) & 1);
+    }
+};
+
+N2KBusLoad::N2KBusLoad(unsigned long _bitrate): bitrate(_bitrate)
+{
+    for (int i = 0; i < BUCKETS; i++)
+    {
+        bits[i] = 0;
+        second[i] = 0;
+    }
+    total_bits = 0;
+}
+
+unsigned long N2KBusLoad::frame_bits(unsigned long id, unsigned char len, const unsigned char *buf)
+{
+    if (len > 8) len = 8;
+    frame_bit_counter f;
+    f.put(0, 1);                    // SOF
+    f.put((id >> 18) & 0x7FF, 11);  // base id
+    f.put(3, 2);                    // SRR, IDE
+    f.put(id & 0x3FFFF, 18);        // id extension
+    f.put(0, 3);                    // RTR, r1, r0
+    f.put(len, 4);                  // DLC
+    for (int i = 0; i < len; i++) f.put(buf[i], 8);
+    f.put_crc();
+    // CRC delimiter, ACK slot and delimiter, EOF, intermission are not stuffed
+    return f.bits + 13;
+}
+
+unsigned long N2KBusLoad::can_id(const tN2kMsg &N2kMsg)
+{
+    unsigned long pgn = N2kMsg.PGN;
+    if (((pgn >> 8) & 0xFF) < 240) pgn = (pgn & 0x3FF00) | N2kMsg.Destination; // PDU1: addressed
+    return ((unsigned long)(N2kMsg.Priority & 0x7) << 26) | ((pgn & 0x3FFFF) << 8) | N2kMsg.Source;
+}
+
+unsigned long N2KBusLoad::message_bits(const tN2kMsg &N2kMsg, int *frames)
+{
+    unsigned long id = can_id(N2kMsg);
+    int len = N2kMsg.DataLen;
+    if (len <= 8)
+    {
+        if (frames) *frames = 1;
+        return frame_bits(id, len, N2kMsg.Data);
+    }
+    // fast packet: sequence/frame counter, then the total length and 6 bytes in the first
+    // frame and 7 bytes in the next ones, the last one padded with 0xFF
+    unsigned char buf[8];
+    unsigned long total = 0;
+    int n = 0;
+    int pos = 0;
+    while (pos < len)
+    {
+        int i = 0;
+        buf[i++] = n & 0x1F;
+        if (n == 0) buf[i++] = len;
+        while (i < 8 && pos < len) buf[i++] = N2kMsg.Data[pos++];
+        while (i < 8) buf[i++] = 0xFF;
+        total += frame_bits(id, 8, buf);
+        n++;
+    }
+    if (frames) *frames = n;
+    return total;
+}
+
+void N2KBusLoad::add(unsigned long b, unsigned long now_ms)
+{
+    unsigned long s = now_ms / 1000;
+    int i = s % BUCKETS;
+    if (second[i].load(std::memory_order_relaxed) != s)
+    {
+        bits[i].store(0, std::memory_order_relaxed);
+        second[i].store(s, std::memory_order_release);
+    }
+    relaxed_inc(bits[i], b);
+    relaxed_inc(total_bits, b);
+}
+
+unsigned long N2KBusLoad::record(const tN2kMsg &N2kMsg, unsigned long now_ms)
+{
+    unsigned long b = message_bits(N2kMsg);
+    add(b, now_ms);
+    return b;
+}
+
+unsigned long N2KBusLoad::record_frame(unsigned long id, unsigned char len, const unsigned char *buf, unsigned long now_ms)
+{
+    unsigned long b = frame_bits(id, len, buf);
+    add(b, now_ms);
+    return b;
+}
+
+float N2KBusLoad::get_load(int seconds, unsigned long now_ms) const
+{
+    if (seconds <= 0 || bitrate == 0) return 0;
+    if (seconds > N2K_BUS_LOAD_SECONDS) seconds = N2K_BUS_LOAD_SECONDS;
+    unsigned long now = now_ms / 1000;
+    unsigned long long sum = 0;
+    for (int k = 1; k <= seconds; k++)
+    {
+        unsigned long s = now - k;
+        int i = s % BUCKETS;
+        if (second[i].load(std::memory_order_acquire) == s) sum += bits[i].load(std::memory_order_relaxed);
+    }
+    return (float)(sum * 100.0 / ((double)bitrate * seconds));
+}
@@ -0,0 +1,52 @@
+#ifndef _N2K_BUS_LOAD_H
+#define _N2K_BUS_LOAD_H
+
+#include <N2kMsg.h>
+#include <atomic>
+
+#ifndef N2K_BUS_BITRATE
+#define N2K_BUS_BITRATE 250000
+#endif
+
+#define N2K_BUS_LOAD_SECONDS 60
+
+/**
+ * Bus utilization estimator. Every observed frame is sized bit by bit (29 bit id, data,
+ * CRC15, bit stuffing, delimiters and intermission) and accounted to a per-second bucket;
+ * the last 60 complete seconds give the rolling 1s/10s/60s loads.
+ * Messages are split back into the frames they travel in (single frame or fast packet),
+ * so the cost per frame is constant. The N2K loop is the only writer and readers on
+ * other tasks never block it.
+ */
+class N2KBusLoad
+{
+public:
+    N2KBusLoad(unsigned long bitrate = N2K_BUS_BITRATE);
+
+    // writer side, returns the bits accounted
+    unsigned long record(const tN2kMsg &N2kMsg, unsigned long now_ms);
+    unsigned long record_frame(unsigned long id, unsigned char len, const unsigned char *buf, unsigned long now_ms);
+
+    // utilization (0-100%) over the last complete seconds, up to N2K_BUS_LOAD_SECONDS
+    float get_load(int seconds, unsigned long now_ms) const;
+    unsigned long get_total_bits() const { return total_bits.load(std::memory_order_relaxed); } // wraps around
+    unsigned long get_bitrate() const { return bitrate; }
+
+    // exact on-the-wire length of an extended CAN data frame, stuff bits included
+    static unsigned long frame_bits(unsigned long id, unsigned char len, const unsigned char *buf);
+    // sum of frame_bits over the frames carrying the message (fast packet when longer than 8 bytes)
+    static unsigned long message_bits(const tN2kMsg &N2kMsg, int *frames = nullptr);
+    static unsigned long can_id(const tN2kMsg &N2kMsg);
+
+private:
+    static const int BUCKETS = N2K_BUS_LOAD_SECONDS + 1; // plus the second being filled
+
+    void add(unsigned long bits, unsigned long now_ms);
+
+    unsigned long bitrate;
+    std::atomic<unsigned long> bits[BUCKETS];
+    std::atomic<unsigned long> second[BUCKETS]; // which second each bucket holds
+    std::atomic<unsigned long> total_bits;
+};
+
+#endif // _N2K_BUS_LOAD_H
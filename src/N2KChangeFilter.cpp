@@ -0,0 +1,132 @@
+#include "N2KChangeFilter.h"
+#include "N2KBusLoad.h"
+#include "Log.h"
+#include "Utils.h"
+#include <math.h>
+
+#define N2K_CHANGE_LOG_TAG "N2k"
+
+static_assert((N2K_CHANGE_MAX_KEYS & (N2K_CHANGE_MAX_KEYS - 1)) == 0, "N2K_CHANGE_MAX_KEYS must be a power of two");
+static_assert(N2K_CHANGE_MAX_KEYS >= 2, "N2K_CHANGE_MAX_KEYS must be at least 2");
+
+N2KChangeFilter::N2KChangeFilter(): n_policies(0), suppressed(0), bits_saved(0)
+{
+    for (int i = 0; i < N2K_CHANGE_MAX_KEYS; i++)
+    {
+        states[i].pgn = 0;
+        states[i].valid = false;
+        states[i].heartbeat = false;
+    }
+}
+
+bool N2KChangeFilter::set_policy(unsigned long pgn, double dead_band, unsigned long heartbeat_ms)
+{
+    policy *p = find_policy(pgn);
+    if (p == nullptr)
+    {
+        if (n_policies == N2K_CHANGE_MAX_PGNS) return false;
+        p = &policies[n_policies++];
+        p->stats = N2KChangeStats();
+        p->stats.pgn = pgn;
+    }
+    p->dead_band = dead_band;
+    p->heartbeat = heartbeat_ms;
+    return true;
+}
+
+N2KChangeFilter::policy *N2KChangeFilter::find_policy(unsigned long pgn)
+{
+    for (int i = 0; i < n_policies; i++)
+    {
+        if (policies[i].stats.pgn == pgn) return &policies[i];
+    }
+    return nullptr;
+}
+
+N2KChangeFilter::state *N2KChangeFilter::find_state(unsigned long pgn, unsigned char instance, bool create)
+{
+    // the low bits of the product only depend on the instance, take the top ones
+    unsigned int h = ((uint32_t)((pgn << 8) | instance) * 2654435761u) >> (32 - log2i(N2K_CHANGE_MAX_KEYS));
+    for (int i = 0; i < N2K_CHANGE_MAX_KEYS; i++)
+    {
+        state &s = states[(h + i) & (N2K_CHANGE_MAX_KEYS - 1)];
+        if (s.pgn == pgn && s.instance == instance) return &s;
+        if (s.pgn == 0)
+        {
+            if (!create) return nullptr;
+            s.pgn = pgn;
+            s.instance = instance;
+            s.valid = false;
+            return &s;
+        }
+    }
+    return nullptr;
+}
+
+bool N2KChangeFilter::check(const tN2kMsg &N2kMsg, unsigned char instance, double value, unsigned long now)
+{
+    policy *p = find_policy(N2kMsg.PGN);
+    if (p == nullptr) return true;
+    state *s = find_state(N2kMsg.PGN, instance, true);
+    if (s == nullptr || !s->valid) return true;
+    // NA (or NaN) values count as a change only when switching to or from a valid value
+    bool na = N2kIsNA(value) || isnan(value);
+    bool last_na = N2kIsNA(s->value) || isnan(s->value);
+    bool changed = (na != last_na) || (!na && fabs(value - s->value) > p->dead_band);
+    s->heartbeat = false;
+    if (changed) return true;
+    if (p->heartbeat && (now - s->time) >= p->heartbeat)
+    {
+        s->heartbeat = true;
+        return true;
+    }
+    unsigned long bits = N2KBusLoad::message_bits(N2kMsg);
+    p->stats.suppressed++;
+    p->stats.bits_saved += bits;
+    suppressed++;
+    bits_saved += bits;
+    return false;
+}
+
+void N2KChangeFilter::sent(const tN2kMsg &N2kMsg, unsigned char instance, double value, unsigned long now)
+{
+    policy *p = find_policy(N2kMsg.PGN);
+    if (p == nullptr) return;
+    state *s = find_state(N2kMsg.PGN, instance, true);
+    if (s == nullptr) return;
+    p->stats.sent++;
+    if (s->heartbeat) p->stats.heartbeats++;
+    s->heartbeat = false;
+    s->valid = true;
+    s->value = value;
+    s->time = now;
+}
+
+int N2KChangeFilter::snapshot(N2KChangeStats *out, int max_entries) const
+{
+    int n = 0;
+    for (; n < n_policies && n < max_entries; n++) out[n] = policies[n].stats;
+    return n;
+}
+
+void N2KChangeFilter::reset_stats()
+{
+    for (int i = 0; i < n_policies; i++)
+    {
+        unsigned long pgn = policies[i].stats.pgn;
+        policies[i].stats = N2KChangeStats();
+        policies[i].stats.pgn = pgn;
+    }
+    suppressed = 0;
+    bits_saved = 0;
+}
+
+void N2KChangeFilter::dump()
+{
+    for (int i = 0; i < n_policies; i++)
+    {
+        const N2KChangeStats &s = policies[i].stats;
+        Log::tracex(N2K_CHANGE_LOG_TAG, "On change", "pgn {%lu} sent {%lu} heartbeats {%lu} suppressed {%lu} saved {%lu bits}",
+            s.pgn, s.sent, s.heartbeats, s.suppressed, s.bits_saved);
+    }
+}
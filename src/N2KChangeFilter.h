@@ -0,0 +1,76 @@
+#ifndef _N2K_CHANGE_FILTER_H
+#define _N2K_CHANGE_FILTER_H
+
+#include <N2kMsg.h>
+
+#ifndef N2K_CHANGE_MAX_PGNS
+#define N2K_CHANGE_MAX_PGNS 16 // PGNs with a policy
+#endif
+
+#ifndef N2K_CHANGE_MAX_KEYS
+#define N2K_CHANGE_MAX_KEYS 64 // (PGN, instance) pairs, must be a power of two
+#endif
+
+struct N2KChangeStats
+{
+    unsigned long pgn = 0;
+    unsigned long sent = 0;
+    unsigned long suppressed = 0;
+    unsigned long heartbeats = 0; // sent only because the heartbeat expired
+    unsigned long bits_saved = 0; // bus bits of the suppressed messages
+};
+
+/**
+ * Change-driven transmission: for the PGNs with a policy, a message is sent only when its
+ * value moved by more than the dead-band since the last transmission of the same
+ * (PGN, instance), or when the heartbeat interval expired. PGNs without a policy, and
+ * pairs that do not fit the table, always go through.
+ */
+class N2KChangeFilter
+{
+public:
+    N2KChangeFilter();
+
+    // false if N2K_CHANGE_MAX_PGNS is reached
+    bool set_policy(unsigned long pgn, double dead_band, unsigned long heartbeat_ms);
+
+    // true if the message is due; otherwise it is counted as suppressed
+    bool check(const tN2kMsg &N2kMsg, unsigned char instance, double value, unsigned long now);
+    // records a successful transmission, as the new reference for the dead-band and heartbeat
+    void sent(const tN2kMsg &N2kMsg, unsigned char instance, double value, unsigned long now);
+
+    int snapshot(N2KChangeStats *out, int max_entries) const;
+    unsigned long get_suppressed() const { return suppressed; }
+    unsigned long get_bits_saved() const { return bits_saved; }
+    void reset_stats();
+    void dump();
+
+private:
+    struct policy
+    {
+        double dead_band;
+        unsigned long heartbeat;
+        N2KChangeStats stats;
+    };
+
+    struct state
+    {
+        unsigned long pgn; // 0 marks a free slot
+        unsigned char instance;
+        bool valid;
+        bool heartbeat; // the pending transmission is due to the heartbeat only
+        double value;
+        unsigned long time;
+    };
+
+    policy *find_policy(unsigned long pgn);
+    state *find_state(unsigned long pgn, unsigned char instance, bool create);
+
+    policy policies[N2K_CHANGE_MAX_PGNS];
+    int n_policies;
+    state states[N2K_CHANGE_MAX_KEYS];
+    unsigned long suppressed;
+    unsigned long bits_saved;
+};
+
+#endif // _N2K_CHANGE_FILTER_H
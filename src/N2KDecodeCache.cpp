@@ -0,0 +1,130 @@
+#include "N2KDecodeCache.h"
+
+bool N2KDecodeCache::is_supported(unsigned long pgn)
+{
+    return pgn == 129025 || pgn == 127250 || pgn == 130306 || pgn == 127257;
+}
+
+bool N2KDecodeCache::update(const tN2kMsg &N2kMsg, unsigned long now_ms)
+{
+    bool ok = false;
+    switch (N2kMsg.PGN)
+    {
+    case 129025:
+    {
+        N2KPosition p;
+        ok = ParseN2kPGN129025(N2kMsg, p.latitude, p.longitude);
+        if (ok)
+        {
+            position = p;
+            position_time = now_ms;
+            double v[2] = {p.latitude, p.longitude};
+            position_history.push(now_ms, v);
+        }
+        break;
+    }
+    case 127250:
+    {
+        N2KHeading h;
+        ok = ParseN2kPGN127250(N2kMsg, h.sid, h.heading, h.deviation, h.variation, h.reference);
+        if (ok)
+        {
+            heading = h;
+            heading_time = now_ms;
+            double v[3] = {h.heading, h.deviation, h.variation};
+            heading_history.push(now_ms, v);
+        }
+        break;
+    }
+    case 130306:
+    {
+        N2KWind w;
+        ok = ParseN2kPGN130306(N2kMsg, w.sid, w.speed, w.angle, w.reference);
+        if (ok)
+        {
+            wind = w;
+            wind_time = now_ms;
+            double v[2] = {w.speed, w.angle};
+            wind_history.push(now_ms, v);
+        }
+        break;
+    }
+    case 127257:
+    {
+        N2KAttitude a;
+        ok = ParseN2kPGN127257(N2kMsg, a.sid, a.yaw, a.pitch, a.roll);
+        if (ok)
+        {
+            attitude = a;
+            attitude_time = now_ms;
+            double v[3] = {a.yaw, a.pitch, a.roll};
+            attitude_history.push(now_ms, v);
+        }
+        break;
+    }
+    default:
+        return false;
+    }
+    if (ok) decoded++;
+    else errors++;
+    return ok;
+}
+
+bool N2KDecodeCache::get_position(N2KPosition &p, unsigned long *time) const
+{
+    if (position_history.size() == 0) return false;
+    p = position;
+    if (time) *time = position_time;
+    return true;
+}
+
+bool N2KDecodeCache::get_heading(N2KHeading &h, unsigned long *time) const
+{
+    if (heading_history.size() == 0) return false;
+    h = heading;
+    if (time) *time = heading_time;
+    return true;
+}
+
+bool N2KDecodeCache::get_wind(N2KWind &w, unsigned long *time) const
+{
+    if (wind_history.size() == 0) return false;
+    w = wind;
+    if (time) *time = wind_time;
+    return true;
+}
+
+bool N2KDecodeCache::get_attitude(N2KAttitude &a, unsigned long *time) const
+{
+    if (attitude_history.size() == 0) return false;
+    a = attitude;
+    if (time) *time = attitude_time;
+    return true;
+}
+
+bool N2KDecodeCache::get_stats(unsigned long pgn, int field, unsigned long window_ms, unsigned long now_ms, N2KFieldStats &out) const
+{
+    out = N2KFieldStats();
+    switch (pgn)
+    {
+    case 129025:
+        if (field < 0 || field > N2K_DECODE_LONGITUDE) return false;
+        position_history.stats(field, position_history.window(now_ms, window_ms), false, out);
+        break;
+    case 127250:
+        if (field < 0 || field > N2K_DECODE_VARIATION) return false;
+        heading_history.stats(field, heading_history.window(now_ms, window_ms), true, out);
+        break;
+    case 130306:
+        if (field < 0 || field > N2K_DECODE_WIND_ANGLE) return false;
+        wind_history.stats(field, wind_history.window(now_ms, window_ms), field == N2K_DECODE_WIND_ANGLE, out);
+        break;
+    case 127257:
+        if (field < 0 || field > N2K_DECODE_ROLL) return false;
+        attitude_history.stats(field, attitude_history.window(now_ms, window_ms), true, out);
+        break;
+    default:
+        return false;
+    }
+    return out.samples > 0;
+}
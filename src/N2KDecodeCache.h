@@ -0,0 +1,213 @@
+#ifndef _N2K_DECODE_CACHE_H
+#define _N2K_DECODE_CACHE_H
+
+#include <N2kMessages.h>
+#include <math.h>
+
+#ifndef N2K_DECODE_HISTORY
+#define N2K_DECODE_HISTORY 64 // samples kept per PGN, must be a power of two
+#endif
+
+struct N2KPosition
+{
+    double latitude = N2kDoubleNA;
+    double longitude = N2kDoubleNA;
+};
+
+struct N2KHeading
+{
+    unsigned char sid = 0;
+    double heading = N2kDoubleNA; // rad
+    double deviation = N2kDoubleNA;
+    double variation = N2kDoubleNA;
+    tN2kHeadingReference reference = N2khr_Unavailable;
+};
+
+struct N2KWind
+{
+    unsigned char sid = 0;
+    double speed = N2kDoubleNA; // m/s
+    double angle = N2kDoubleNA; // rad
+    tN2kWindReference reference = N2kWind_Unavailable;
+};
+
+struct N2KAttitude
+{
+    unsigned char sid = 0;
+    double yaw = N2kDoubleNA; // rad
+    double pitch = N2kDoubleNA;
+    double roll = N2kDoubleNA;
+};
+
+// history columns, by PGN
+enum n2k_decode_field
+{
+    N2K_DECODE_LATITUDE = 0,   // 129025
+    N2K_DECODE_LONGITUDE = 1,
+    N2K_DECODE_HEADING = 0,    // 127250
+    N2K_DECODE_DEVIATION = 1,
+    N2K_DECODE_VARIATION = 2,
+    N2K_DECODE_WIND_SPEED = 0, // 130306
+    N2K_DECODE_WIND_ANGLE = 1,
+    N2K_DECODE_YAW = 0,        // 127257
+    N2K_DECODE_PITCH = 1,
+    N2K_DECODE_ROLL = 2
+};
+
+struct N2KFieldStats
+{
+    int samples = 0; // valid (not NA) samples in the window
+    double min = 0;
+    double max = 0;
+    double mean = 0; // circular mean for angles, in (-pi, pi]; min/max are then the extremes around it
+};
+
+/**
+ * Struct-of-arrays ring: one contiguous column per field plus the sample times, so that
+ * window statistics run as tight loops over a single column. NA values are kept as NaN.
+ */
+template <typename T, int F, int N> class N2KDecodeRing
+{
+    static_assert(N > 0 && (N & (N - 1)) == 0, "N2KDecodeRing size must be a power of two");
+
+public:
+    void push(unsigned long time, const double *v)
+    {
+        int i = head & (N - 1);
+        times[i] = time;
+        for (int f = 0; f < F; f++) columns[f][i] = N2kIsNA(v[f]) ? (T)NAN : (T)v[f];
+        head++;
+    }
+
+    unsigned long size() const { return head < N ? head : N; }
+
+    // samples received in the last window_ms (at most N)
+    int window(unsigned long now, unsigned long window_ms) const
+    {
+        int n = 0;
+        int max = (int)size();
+        while (n < max && (now - times[(head - 1 - n) & (N - 1)]) <= window_ms) n++;
+        return n;
+    }
+
+    void stats(int field, int n, bool angle, N2KFieldStats &out) const
+    {
+        out = N2KFieldStats();
+        if (n <= 0) return;
+        const T *c = columns[field];
+        int start = (head - n) & (N - 1);
+        // the window is at most two contiguous runs of the column
+        int first = (start + n <= N) ? n : N - start;
+        if (angle)
+        {
+            double s = 0, co = 0;
+            sum_angle(c + start, first, s, co, out.samples);
+            sum_angle(c, n - first, s, co, out.samples);
+            if (out.samples == 0) return;
+            out.mean = atan2(s, co);
+            double lo = 0, hi = 0;
+            span_angle(c + start, first, out.mean, lo, hi);
+            span_angle(c, n - first, out.mean, lo, hi);
+            out.min = out.mean + lo;
+            out.max = out.mean + hi;
+        }
+        else
+        {
+            double sum = 0, lo = INFINITY, hi = -INFINITY;
+            sum_linear(c + start, first, sum, lo, hi, out.samples);
+            sum_linear(c, n - first, sum, lo, hi, out.samples);
+            if (out.samples == 0) return;
+            out.mean = sum / out.samples;
+            out.min = lo;
+            out.max = hi;
+        }
+    }
+
+private:
+    static void sum_linear(const T *c, int n, double &sum, double &lo, double &hi, int &samples)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            if (isnan(c[i])) continue;
+            sum += c[i];
+            if (c[i] < lo) lo = c[i];
+            if (c[i] > hi) hi = c[i];
+            samples++;
+        }
+    }
+
+    static void sum_angle(const T *c, int n, double &s, double &co, int &samples)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            if (isnan(c[i])) continue;
+            s += sin(c[i]);
+            co += cos(c[i]);
+            samples++;
+        }
+    }
+
+    static void span_angle(const T *c, int n, double mean, double &lo, double &hi)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            if (isnan(c[i])) continue;
+            double d = remainder(c[i] - mean, 2 * M_PI);
+            if (d < lo) lo = d;
+            if (d > hi) hi = d;
+        }
+    }
+
+    T columns[F][N];
+    unsigned long times[N];
+    unsigned long head = 0;
+};
+
+/**
+ * Decodes the high-rate PGNs (129025 position, 127250 heading, 130306 wind, 127257 attitude)
+ * once per message, keeping the last value and a short history per PGN, so that consumers
+ * do not run the N2kMessages.h parsers again. Fed by N2K subscriptions (see N2K::enable_decode);
+ * it is meant to be read from the same context that runs the N2K handlers.
+ */
+class N2KDecodeCache
+{
+public:
+    static bool is_supported(unsigned long pgn);
+
+    // writer side, returns false if the message is not supported or cannot be parsed
+    bool update(const tN2kMsg &N2kMsg, unsigned long now_ms);
+
+    // last decoded value; false if none was received yet. time receives its receive time.
+    bool get_position(N2KPosition &p, unsigned long *time = nullptr) const;
+    bool get_heading(N2KHeading &h, unsigned long *time = nullptr) const;
+    bool get_wind(N2KWind &w, unsigned long *time = nullptr) const;
+    bool get_attitude(N2KAttitude &a, unsigned long *time = nullptr) const;
+
+    // min/max/mean of one history column over the last window_ms (bounded by N2K_DECODE_HISTORY samples)
+    bool get_stats(unsigned long pgn, int field, unsigned long window_ms, unsigned long now_ms, N2KFieldStats &out) const;
+
+    // number of messages decoded and failed to parse
+    unsigned long get_decoded() const { return decoded; }
+    unsigned long get_errors() const { return errors; }
+
+private:
+    N2KPosition position;
+    N2KHeading heading;
+    N2KWind wind;
+    N2KAttitude attitude;
+    unsigned long position_time = 0;
+    unsigned long heading_time = 0;
+    unsigned long wind_time = 0;
+    unsigned long attitude_time = 0;
+
+    // positions need double precision, the rest fits in a float
+    N2KDecodeRing<double, 2, N2K_DECODE_HISTORY> position_history;
+    N2KDecodeRing<float, 3, N2K_DECODE_HISTORY> heading_history;
+    N2KDecodeRing<float, 2, N2K_DECODE_HISTORY> wind_history;
+    N2KDecodeRing<float, 3, N2K_DECODE_HISTORY> attitude_history;
+
+    unsigned long decoded = 0;
+    unsigned long errors = 0;
+};
+
+#endif // _N2K_DECODE_CACHE_H
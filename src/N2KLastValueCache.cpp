@@ -0,0 +1,115 @@
+#include "N2KLastValueCache.h"
+#include "Utils.h"
+
+static_assert((N2K_LVC_SIZE & (N2K_LVC_SIZE - 1)) == 0, "N2K_LVC_SIZE must be a power of two");
+static_assert(N2K_LVC_SIZE >= 2, "N2K_LVC_SIZE must be at least 2");
+
+N2KLastValueCache::N2KLastValueCache()
+{
+    for (int i = 0; i < N2K_LVC_SIZE; i++)
+    {
+        slots[i].key = EMPTY;
+        slots[i].seq = 0;
+        slots[i].time = 0;
+    }
+    overflow = 0;
+}
+
+int N2KLastValueCache::find(uint32_t key, bool create)
+{
+    // multiplicative hash: the well mixed bits are the high ones
+    unsigned int h = (key * 2654435761u) >> (32 - log2i(N2K_LVC_SIZE));
+    for (int i = 0; i < N2K_LVC_SIZE; i++)
+    {
+        int idx = (h + i) & (N2K_LVC_SIZE - 1);
+        uint32_t k = slots[idx].key.load(std::memory_order_acquire);
+        if (k == key) return idx;
+        if (k == EMPTY)
+        {
+            if (!create) return -1;
+            return idx;
+        }
+    }
+    return -1;
+}
+
+void N2KLastValueCache::update(const tN2kMsg &N2kMsg, unsigned long now_ms)
+{
+    uint32_t key = make_key(N2kMsg.PGN, N2kMsg.Source);
+    int i = find(key, true);
+    if (i < 0)
+    {
+        relaxed_inc(overflow);
+        return;
+    }
+    slot &s = slots[i];
+    uint32_t seq = s.seq.load(std::memory_order_relaxed);
+    s.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    s.msg = N2kMsg;
+    s.time = now_ms;
+    s.seq.store(seq + 2, std::memory_order_release);
+    // publish the key only once the slot holds a complete message
+    if (s.key.load(std::memory_order_relaxed) == EMPTY) s.key.store(key, std::memory_order_release);
+}
+
+bool N2KLastValueCache::read(int i, tN2kMsg &N2kMsg, unsigned long &time)
+{
+    slot &s = slots[i];
+    for (int retry = 0; retry < N2K_LVC_READ_RETRIES; retry++)
+    {
+        uint32_t seq0 = s.seq.load(std::memory_order_acquire);
+        if (seq0 & 1) continue;
+        N2kMsg = s.msg;
+        time = s.time;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (s.seq.load(std::memory_order_relaxed) == seq0) return true;
+    }
+    return false;
+}
+
+bool N2KLastValueCache::read_time(int i, unsigned long &time)
+{
+    slot &s = slots[i];
+    for (int retry = 0; retry < N2K_LVC_READ_RETRIES; retry++)
+    {
+        uint32_t seq0 = s.seq.load(std::memory_order_acquire);
+        if (seq0 & 1) continue;
+        time = s.time;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (s.seq.load(std::memory_order_relaxed) == seq0) return true;
+    }
+    return false;
+}
+
+bool N2KLastValueCache::get(unsigned long pgn, unsigned char source, tN2kMsg &N2kMsg, unsigned long now_ms, unsigned long max_age_ms, unsigned long *time)
+{
+    int i = find(make_key(pgn, source), false);
+    unsigned long t;
+    if (i < 0 || !read(i, N2kMsg, t)) return false;
+    if (time) *time = t;
+    return max_age_ms == 0 || (now_ms - t) <= max_age_ms;
+}
+
+bool N2KLastValueCache::get_any(unsigned long pgn, tN2kMsg &N2kMsg, unsigned long now_ms, unsigned long max_age_ms, unsigned long *time)
+{
+    // sources of the same PGN are scattered by the hash, so scan the (small) table
+    int newest = -1;
+    unsigned long newest_age = 0;
+    for (int i = 0; i < N2K_LVC_SIZE; i++)
+    {
+        uint32_t k = slots[i].key.load(std::memory_order_acquire);
+        unsigned long t;
+        if (k == EMPTY || (k >> 8) != (uint32_t)pgn || !read_time(i, t)) continue;
+        unsigned long age = now_ms - t;
+        if (newest < 0 || age < newest_age)
+        {
+            newest = i;
+            newest_age = age;
+        }
+    }
+    unsigned long t;
+    if (newest < 0 || !read(newest, N2kMsg, t)) return false;
+    if (time) *time = t;
+    return max_age_ms == 0 || (now_ms - t) <= max_age_ms;
+}
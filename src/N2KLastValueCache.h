@@ -0,0 +1,60 @@
+#ifndef _N2K_LAST_VALUE_CACHE_H
+#define _N2K_LAST_VALUE_CACHE_H
+
+#include <N2kMsg.h>
+#include <atomic>
+
+#ifndef N2K_LVC_SIZE
+#define N2K_LVC_SIZE 64 // (PGN, source) pairs, must be a power of two
+#endif
+
+#ifndef N2K_LVC_READ_RETRIES
+#define N2K_LVC_READ_RETRIES 8
+#endif
+
+/**
+ * Fixed-capacity cache of the most recent message per (PGN, source), with its receive time.
+ * The N2K loop is the only writer; updates are O(1) and never allocate. Each slot is
+ * guarded by a sequence counter, so readers on other tasks get a consistent copy
+ * without locking the writer (a read racing with an update is retried).
+ */
+class N2KLastValueCache
+{
+public:
+    N2KLastValueCache();
+
+    // writer side
+    void update(const tN2kMsg &N2kMsg, unsigned long now_ms);
+
+    // Copies the last message of pgn from source into N2kMsg. Fails if there is none or
+    // if it is older than max_age_ms (0 accepts any age). time receives the receive time.
+    bool get(unsigned long pgn, unsigned char source, tN2kMsg &N2kMsg, unsigned long now_ms, unsigned long max_age_ms = 0, unsigned long *time = nullptr);
+
+    // same as get, picking the most recent message of pgn from any source
+    bool get_any(unsigned long pgn, tN2kMsg &N2kMsg, unsigned long now_ms, unsigned long max_age_ms = 0, unsigned long *time = nullptr);
+
+    // messages not cached because the cache was full
+    unsigned long get_overflow() const { return overflow.load(std::memory_order_relaxed); }
+
+private:
+    static const uint32_t EMPTY = 0xFFFFFFFF;
+
+    struct slot
+    {
+        std::atomic<uint32_t> key; // (pgn << 8) | source
+        std::atomic<uint32_t> seq; // odd while the slot is being written
+        tN2kMsg msg;
+        unsigned long time;
+    };
+
+    static uint32_t make_key(unsigned long pgn, unsigned char source) { return ((uint32_t)pgn << 8) | source; }
+
+    int find(uint32_t key, bool create);
+    bool read(int i, tN2kMsg &N2kMsg, unsigned long &time);
+    bool read_time(int i, unsigned long &time);
+
+    slot slots[N2K_LVC_SIZE];
+    std::atomic<unsigned long> overflow;
+};
+
+#endif // _N2K_LAST_VALUE_CACHE_H
@@ -0,0 +1,247 @@
+#if defined(NATIVE) && defined(__linux__)
+#include "N2KLinuxCAN.h"
+#include "Log.h"
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+
+#define N2K_CAN_LOG_TAG "N2kCAN"
+
+// received by every node regardless of the application interest
+static const unsigned long mandatory_pgns[] = {
+    59392,  // ISO acknowledgement
+    59904,  // ISO request
+    60160,  // ISO transport protocol, data transfer
+    60416,  // ISO transport protocol, connection management
+    60928,  // ISO address claim
+    65240,  // ISO commanded address
+    126208, // group function
+};
+#define N_MANDATORY_PGNS (int)(sizeof(mandatory_pgns) / sizeof(mandatory_pgns[0]))
+
+void tNMEA2000_linux::make_filter(unsigned long pgn, struct can_filter &f)
+{
+    // the PGN sits in bits 8-25 of the 29 bit id; for PDU1 (PF < 240) the low byte is the destination
+    bool pdu1 = ((pgn >> 8) & 0xFF) < 240;
+    f.can_id = ((pgn & 0x3FFFF) << 8) | CAN_EFF_FLAG;
+    f.can_mask = (pdu1 ? 0x3FF0000 : 0x3FFFF00) | CAN_EFF_FLAG;
+}
+
+tNMEA2000_linux::tNMEA2000_linux(const char *name): tNMEA2000(), skt(-1), n_filter_pgns(0), filter_enabled(false), received(0), interface_rx0(0),
+    batch_size(0), batch_pos(0), last_rx_time_us(0), rx_syscalls(0), rx_frames(0)
+{
+    // bounded copy to avoid overflow
+    strncpy(interface_name, name, sizeof(interface_name) - 1);
+    interface_name[sizeof(interface_name) - 1] = '\0';
+}
+
+tNMEA2000_linux::~tNMEA2000_linux()
+{
+    if (skt >= 0) ::close(skt);
+}
+
+bool tNMEA2000_linux::CANOpen()
+{
+    if (skt >= 0) return true;
+
+    skt = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+    if (skt < 0)
+    {
+        Log::tracex(N2K_CAN_LOG_TAG, "Socket failed", "err {%d} {%s}", errno, strerror(errno));
+        return false;
+    }
+
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, interface_name, IFNAMSIZ - 1);
+    struct sockaddr_can addr;
+    memset(&addr, 0, sizeof(addr));
+    if (ioctl(skt, SIOCGIFINDEX, &ifr) < 0)
+    {
+        Log::tracex(N2K_CAN_LOG_TAG, "Unknown interface", "name {%s} err {%s}", interface_name, strerror(errno));
+        ::close(skt);
+        skt = -1;
+        return false;
+    }
+    addr.can_family = AF_CAN;
+    addr.can_ifindex = ifr.ifr_ifindex;
+    if (bind(skt, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        Log::tracex(N2K_CAN_LOG_TAG, "Bind failed", "name {%s} err {%s}", interface_name, strerror(errno));
+        ::close(skt);
+        skt = -1;
+        return false;
+    }
+    enable_timestamps();
+    apply_filter();
+    Log::tracex(N2K_CAN_LOG_TAG, "Open", "name {%s} filters {%d}", interface_name, filter_enabled ? n_filter_pgns + N_MANDATORY_PGNS : 0);
+    return true;
+}
+
+void tNMEA2000_linux::enable_timestamps()
+{
+    fcntl(skt, F_SETFL, fcntl(skt, F_GETFL, 0) | O_NONBLOCK);
+    // software stamps only: the raw hardware ones count on the controller clock, not CLOCK_REALTIME
+    int ts_flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+    if (setsockopt(skt, SOL_SOCKET, SO_TIMESTAMPING, &ts_flags, sizeof(ts_flags)) < 0)
+    {
+        Log::tracex(N2K_CAN_LOG_TAG, "No kernel timestamps", "name {%s} err {%s}", interface_name, strerror(errno));
+    }
+    batch_size = 0;
+    batch_pos = 0;
+}
+
+void tNMEA2000_linux::attach_socket(int fd)
+{
+    if (skt >= 0) ::close(skt);
+    skt = fd;
+    enable_timestamps();
+}
+
+bool tNMEA2000_linux::CANSendFrame(unsigned long id, unsigned char len, const unsigned char *buf, bool wait_sent)
+{
+    if (skt < 0 || len > 8) return false;
+    struct can_frame frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.can_id = (id & CAN_EFF_MASK) | CAN_EFF_FLAG;
+    frame.can_dlc = len;
+    memcpy(frame.data, buf, len);
+    return write(skt, &frame, sizeof(frame)) == sizeof(frame);
+}
+
+unsigned long long tNMEA2000_linux::realtime_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+bool tNMEA2000_linux::fill_batch()
+{
+    for (int i = 0; i < N2K_CAN_RX_BATCH; i++)
+    {
+        batch_iov[i].iov_base = &batch[i];
+        batch_iov[i].iov_len = sizeof(struct can_frame);
+        memset(&batch_hdr[i], 0, sizeof(struct mmsghdr));
+        batch_hdr[i].msg_hdr.msg_iov = &batch_iov[i];
+        batch_hdr[i].msg_hdr.msg_iovlen = 1;
+        batch_hdr[i].msg_hdr.msg_control = batch_ctrl[i];
+        batch_hdr[i].msg_hdr.msg_controllen = sizeof(batch_ctrl[i]);
+    }
+    rx_syscalls++;
+    int n = recvmmsg(skt, batch_hdr, N2K_CAN_RX_BATCH, MSG_DONTWAIT, nullptr);
+    batch_pos = 0;
+    batch_size = n > 0 ? n : 0;
+    for (int i = 0; i < batch_size; i++)
+    {
+        unsigned long long t = 0;
+        for (struct cmsghdr *c = CMSG_FIRSTHDR(&batch_hdr[i].msg_hdr); c; c = CMSG_NXTHDR(&batch_hdr[i].msg_hdr, c))
+        {
+            if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPING)
+            {
+                struct scm_timestamping *stamps = (struct scm_timestamping *)CMSG_DATA(c);
+                const struct timespec &ts = stamps->ts[0]; // software, CLOCK_REALTIME
+                t = (unsigned long long)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+            }
+        }
+        batch_time_us[i] = t ? t : realtime_us();
+    }
+    return batch_size > 0;
+}
+
+bool tNMEA2000_linux::CANGetFrame(unsigned long &id, unsigned char &len, unsigned char *buf)
+{
+    if (skt < 0) return false;
+    while (true)
+    {
+        if (batch_pos >= batch_size && !fill_batch()) return false;
+        int i = batch_pos++;
+        if (batch_hdr[i].msg_len != sizeof(struct can_frame)) continue;
+        received++;
+        rx_frames++;
+        struct can_frame &frame = batch[i];
+        if ((frame.can_id & CAN_EFF_FLAG) == 0 || (frame.can_id & (CAN_RTR_FLAG | CAN_ERR_FLAG))) continue;
+        id = frame.can_id & CAN_EFF_MASK;
+        len = frame.can_dlc > 8 ? 8 : frame.can_dlc;
+        memcpy(buf, frame.data, len);
+        last_rx_time_us = batch_time_us[i];
+        return true;
+    }
+}
+
+bool tNMEA2000_linux::set_pgn_filter(const unsigned long *pgns, int n)
+{
+    if (n > N2K_CAN_MAX_FILTERS)
+    {
+        Log::tracex(N2K_CAN_LOG_TAG, "Too many filters", "name {%s} pgns {%d} max {%d}", interface_name, n, N2K_CAN_MAX_FILTERS);
+        return clear_pgn_filter();
+    }
+    filter_enabled = true;
+    n_filter_pgns = n;
+    for (int i = 0; i < n; i++) filter_pgns[i] = pgns[i];
+    return skt < 0 || apply_filter();
+}
+
+bool tNMEA2000_linux::clear_pgn_filter()
+{
+    filter_enabled = false;
+    n_filter_pgns = 0;
+    return skt < 0 || apply_filter();
+}
+
+bool tNMEA2000_linux::apply_filter()
+{
+    struct can_filter filters[N2K_CAN_MAX_FILTERS + N_MANDATORY_PGNS];
+    int n = 0;
+    if (filter_enabled)
+    {
+        for (int i = 0; i < N_MANDATORY_PGNS; i++) make_filter(mandatory_pgns[i], filters[n++]);
+        for (int i = 0; i < n_filter_pgns; i++) make_filter(filter_pgns[i], filters[n++]);
+    }
+    else
+    {
+        // accept all extended frames
+        filters[0].can_id = CAN_EFF_FLAG;
+        filters[0].can_mask = CAN_EFF_FLAG;
+        n = 1;
+    }
+    if (setsockopt(skt, SOL_CAN_RAW, CAN_RAW_FILTER, filters, n * sizeof(struct can_filter)) < 0)
+    {
+        Log::tracex(N2K_CAN_LOG_TAG, "Filter failed", "name {%s} err {%s}", interface_name, strerror(errno));
+        return false;
+    }
+    received = 0;
+    interface_rx0 = read_interface_rx();
+    return true;
+}
+
+unsigned long tNMEA2000_linux::read_interface_rx()
+{
+    char path[96];
+    snprintf(path, sizeof(path), "/sys/class/net/%s/statistics/rx_packets", interface_name);
+    FILE *f = fopen(path, "r");
+    unsigned long rx = 0;
+    if (f)
+    {
+        if (fscanf(f, "%lu", &rx) != 1) rx = 0;
+        fclose(f);
+    }
+    return rx;
+}
+
+unsigned long tNMEA2000_linux::get_filtered()
+{
+    if (!filter_enabled || skt < 0) return 0;
+    unsigned long rx = read_interface_rx() - interface_rx0;
+    return rx > received ? rx - received : 0;
+}
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef _N2K_LINUX_CAN_H
+#define _N2K_LINUX_CAN_H
+
+#if defined(NATIVE) && defined(__linux__)
+
+#include <NMEA2000.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <linux/can.h>
+#include <linux/net_tstamp.h>
+#include <linux/errqueue.h>
+
+#ifndef N2K_CAN_MAX_FILTERS
+#define N2K_CAN_MAX_FILTERS 64
+#endif
+
+#ifndef N2K_CAN_RX_BATCH
+#define N2K_CAN_RX_BATCH 32 // frames drained from the socket with one recvmmsg call
+#endif
+
+/**
+ * SocketCAN backend for tNMEA2000 that owns its raw CAN socket, so that the kernel
+ * can be asked to drop uninteresting traffic before it is copied to userspace.
+ * Frames are drained in batches with recvmmsg and carry the kernel software receive
+ * timestamp (CLOCK_REALTIME, comparable with realtime_us()).
+ */
+class tNMEA2000_linux: public tNMEA2000
+{
+public:
+    tNMEA2000_linux(const char *interface_name);
+    virtual ~tNMEA2000_linux();
+
+    // Accept only the given PGNs, plus the ISO/address-claim PGNs the library needs to
+    // stay on the bus (n = 0 leaves just those). Can be called before or after the socket is open.
+    // More than N2K_CAN_MAX_FILTERS PGNs do not fit the kernel filters: everything is accepted.
+    bool set_pgn_filter(const unsigned long *pgns, int n);
+
+    // back to accepting every extended frame
+    bool clear_pgn_filter();
+
+    // kernel filter matching a PGN from any source with any priority; PDU1 PGNs (PF < 240)
+    // also match any destination
+    static void make_filter(unsigned long pgn, struct can_filter &f);
+
+    // estimate of the frames received by the interface and dropped by the filters
+    unsigned long get_filtered();
+
+    int get_fd() const { return skt; }
+
+    // kernel receive time (CLOCK_REALTIME, us) of the last frame handed to the library, the
+    // time of the read when the socket delivers no timestamp
+    unsigned long long get_last_rx_timestamp_us() const { return last_rx_time_us; }
+
+    unsigned long get_rx_syscalls() const { return rx_syscalls; }
+    unsigned long get_rx_frames() const { return rx_frames; }
+
+    static unsigned long long realtime_us();
+
+    // public for test purposes: drains an already bound socket (e.g. UDP carrying can_frame
+    // datagrams) instead of opening the interface
+    void attach_socket(int fd);
+
+protected:
+    virtual bool CANSendFrame(unsigned long id, unsigned char len, const unsigned char *buf, bool wait_sent = true);
+    virtual bool CANOpen();
+    virtual bool CANGetFrame(unsigned long &id, unsigned char &len, unsigned char *buf);
+
+private:
+    bool apply_filter();
+    unsigned long read_interface_rx();
+    bool fill_batch();
+    void enable_timestamps();
+
+    int skt;
+    char interface_name[32];
+    unsigned long filter_pgns[N2K_CAN_MAX_FILTERS];
+    int n_filter_pgns;
+    bool filter_enabled;
+
+    unsigned long received;      // frames read from the socket since the filter was applied
+    unsigned long interface_rx0; // interface rx counter when the filter was applied
+
+    struct can_frame batch[N2K_CAN_RX_BATCH];
+    struct mmsghdr batch_hdr[N2K_CAN_RX_BATCH];
+    struct iovec batch_iov[N2K_CAN_RX_BATCH];
+    char batch_ctrl[N2K_CAN_RX_BATCH][CMSG_SPACE(sizeof(struct scm_timestamping))];
+    unsigned long long batch_time_us[N2K_CAN_RX_BATCH];
+    int batch_size;
+    int batch_pos;
+
+    unsigned long long last_rx_time_us;
+    unsigned long rx_syscalls;
+    unsigned long rx_frames;
+};
+
+#endif
+
+#endif // _N2K_LINUX_CAN_H
@@ -0,0 +1,243 @@
+#include "N2KPgnStats.h"
+#include "Log.h"
+#include "Utils.h"
+#include <string.h>
+#include <stdio.h>
+
+#define N2K_STATS_LOG_TAG "N2k"
+
+static_assert((N2K_STATS_MAX_PGNS & (N2K_STATS_MAX_PGNS - 1)) == 0, "N2K_STATS_MAX_PGNS must be a power of two");
+static_assert(N2K_STATS_MAX_PGNS >= 2, "N2K_STATS_MAX_PGNS must be at least 2");
+
+// multiplicative hash: the well mixed bits are the high ones
+#define N2K_STATS_HASH_SHIFT (32 - log2i(N2K_STATS_MAX_PGNS))
+
+static inline unsigned long get(const std::atomic<unsigned long> &c)
+{
+    return c.load(std::memory_order_relaxed);
+}
+
+N2KPgnStats::N2KPgnStats(): base_handler_total_us(0), base_untracked(0)
+{
+    for (int i = 0; i < N2K_STATS_MAX_PGNS; i++)
+    {
+        entry &e = entries[i];
+        e.pgn = 0;
+        e.recv = 0;
+        e.sent = 0;
+        e.fail = 0;
+        e.handler_us = 0;
+        e.bits = 0;
+        for (int j = 0; j < N2K_HISTOGRAM_BUCKETS; j++) e.interarrival[j] = 0;
+        e.last_time = 0;
+    }
+    for (int i = 0; i < N2K_STATS_SOURCES; i++)
+    {
+        sources[i] = 0;
+        source_bits[i] = 0;
+    }
+    for (int i = 0; i < N2K_HISTOGRAM_BUCKETS; i++) handler_time[i] = 0;
+    handler_total_us = 0;
+    untracked = 0;
+    memset(base_sources, 0, sizeof(base_sources));
+    memset(base_source_bits, 0, sizeof(base_source_bits));
+    memset(base_handler_time, 0, sizeof(base_handler_time));
+}
+
+int N2KPgnStats::get_bucket(unsigned long value)
+{
+    int b = 0;
+    while (value && b < N2K_HISTOGRAM_BUCKETS - 1)
+    {
+        value >>= 1;
+        b++;
+    }
+    return b;
+}
+
+N2KPgnStats::entry *N2KPgnStats::find(unsigned long pgn, bool create)
+{
+    unsigned int h = ((uint32_t)pgn * 2654435761u) >> N2K_STATS_HASH_SHIFT;
+    for (int i = 0; i < N2K_STATS_MAX_PGNS; i++)
+    {
+        entry &e = entries[(h + i) & (N2K_STATS_MAX_PGNS - 1)];
+        unsigned long p = e.pgn.load(std::memory_order_acquire);
+        if (p == pgn) return &e;
+        if (p == 0)
+        {
+            if (!create) return nullptr;
+            e.pgn.store(pgn, std::memory_order_release);
+            return &e;
+        }
+    }
+    return nullptr;
+}
+
+void N2KPgnStats::record_recv(const tN2kMsg &N2kMsg, unsigned long now_ms)
+{
+    relaxed_inc(sources[N2kMsg.Source]);
+    entry *e = find(N2kMsg.PGN, true);
+    if (e == nullptr)
+    {
+        relaxed_inc(untracked);
+        return;
+    }
+    if (get(e->recv)) relaxed_inc(e->interarrival[get_bucket(now_ms - e->last_time)]);
+    e->last_time = now_ms;
+    relaxed_inc(e->recv);
+}
+
+void N2KPgnStats::record_sent(unsigned long pgn, bool success)
+{
+    entry *e = find(pgn, true);
+    if (e == nullptr)
+    {
+        relaxed_inc(untracked);
+        return;
+    }
+    if (success) relaxed_inc(e->sent);
+    else relaxed_inc(e->fail);
+}
+
+void N2KPgnStats::record_handler(unsigned long pgn, unsigned long us)
+{
+    relaxed_inc(handler_time[get_bucket(us)]);
+    relaxed_inc(handler_total_us, us);
+    entry *e = find(pgn, false);
+    if (e) relaxed_inc(e->handler_us, us);
+}
+
+void N2KPgnStats::record_bits(unsigned long pgn, unsigned char source, unsigned long bits)
+{
+    relaxed_inc(source_bits[source], bits);
+    entry *e = find(pgn, false);
+    if (e) relaxed_inc(e->bits, bits);
+}
+
+void N2KPgnStats::read_entry(int i, N2KPgnCounters &out)
+{
+    const entry &e = entries[i];
+    const N2KPgnCounters &b = base_entries[i];
+    out.pgn = e.pgn.load(std::memory_order_acquire);
+    out.recv = get(e.recv) - b.recv;
+    out.sent = get(e.sent) - b.sent;
+    out.fail = get(e.fail) - b.fail;
+    out.handler_us = get(e.handler_us) - b.handler_us;
+    out.bits = get(e.bits) - b.bits;
+    for (int j = 0; j < N2K_HISTOGRAM_BUCKETS; j++) out.interarrival[j] = get(e.interarrival[j]) - b.interarrival[j];
+}
+
+int N2KPgnStats::snapshot(N2KPgnCounters *out, int max_entries)
+{
+    int n = 0;
+    for (int i = 0; i < N2K_STATS_MAX_PGNS && n < max_entries; i++)
+    {
+        if (entries[i].pgn.load(std::memory_order_acquire) == 0) continue;
+        read_entry(i, out[n]);
+        n++;
+    }
+    return n;
+}
+
+void N2KPgnStats::snapshot_sources(unsigned long *out)
+{
+    for (int i = 0; i < N2K_STATS_SOURCES; i++) out[i] = get(sources[i]) - base_sources[i];
+}
+
+void N2KPgnStats::snapshot_source_bits(unsigned long *out)
+{
+    for (int i = 0; i < N2K_STATS_SOURCES; i++) out[i] = get(source_bits[i]) - base_source_bits[i];
+}
+
+void N2KPgnStats::snapshot_handler_time(unsigned long *out)
+{
+    for (int i = 0; i < N2K_HISTOGRAM_BUCKETS; i++) out[i] = get(handler_time[i]) - base_handler_time[i];
+}
+
+unsigned long N2KPgnStats::get_handler_total_us() const
+{
+    return get(handler_total_us) - base_handler_total_us;
+}
+
+unsigned long N2KPgnStats::get_untracked() const
+{
+    return get(untracked) - base_untracked;
+}
+
+void N2KPgnStats::reset()
+{
+    for (int i = 0; i < N2K_STATS_MAX_PGNS; i++)
+    {
+        N2KPgnCounters c;
+        read_entry(i, c);
+        N2KPgnCounters &b = base_entries[i];
+        b.recv += c.recv;
+        b.sent += c.sent;
+        b.fail += c.fail;
+        b.handler_us += c.handler_us;
+        b.bits += c.bits;
+        for (int j = 0; j < N2K_HISTOGRAM_BUCKETS; j++) b.interarrival[j] += c.interarrival[j];
+    }
+    for (int i = 0; i < N2K_STATS_SOURCES; i++)
+    {
+        base_sources[i] = get(sources[i]);
+        base_source_bits[i] = get(source_bits[i]);
+    }
+    for (int i = 0; i < N2K_HISTOGRAM_BUCKETS; i++) base_handler_time[i] = get(handler_time[i]);
+    base_handler_total_us = get(handler_total_us);
+    base_untracked = get(untracked);
+}
+
+void N2KPgnStats::dump(int top_n)
+{
+    // pick the busiest PGNs without copying the whole table on the stack
+    int top[N2K_STATS_TOP_N];
+    unsigned long top_recv[N2K_STATS_TOP_N];
+    if (top_n > N2K_STATS_TOP_N) top_n = N2K_STATS_TOP_N;
+    int n = 0;
+    for (int i = 0; i < N2K_STATS_MAX_PGNS; i++)
+    {
+        if (entries[i].pgn.load(std::memory_order_acquire) == 0) continue;
+        unsigned long r = get(entries[i].recv) + get(entries[i].sent) - base_entries[i].recv - base_entries[i].sent;
+        int k = n < top_n ? n++ : top_n;
+        while (k > 0 && top_recv[k - 1] < r)
+        {
+            if (k < top_n)
+            {
+                top[k] = top[k - 1];
+                top_recv[k] = top_recv[k - 1];
+            }
+            k--;
+        }
+        if (k < top_n)
+        {
+            top[k] = i;
+            top_recv[k] = r;
+        }
+    }
+    for (int i = 0; i < n; i++)
+    {
+        N2KPgnCounters c;
+        read_entry(top[i], c);
+        // median inter-arrival bucket, as an order of magnitude of the period
+        unsigned long samples = 0, acc = 0;
+        for (int j = 0; j < N2K_HISTOGRAM_BUCKETS; j++) samples += c.interarrival[j];
+        int median = 0;
+        for (; median < N2K_HISTOGRAM_BUCKETS - 1; median++)
+        {
+            acc += c.interarrival[median];
+            if (acc > samples / 2) break;
+        }
+        char period[16];
+        if (samples == 0) snprintf(period, sizeof(period), "-");
+        else if (median == N2K_HISTOGRAM_BUCKETS - 1) snprintf(period, sizeof(period), ">%lums", 1UL << (median - 1));
+        else snprintf(period, sizeof(period), "<%lums", 1UL << median);
+        Log::tracex(N2K_STATS_LOG_TAG, "PGN stats", "pgn {%lu} rx {%lu} tx {%lu/%lu} period {%s} handler {%luus} bits {%lu}",
+            c.pgn, c.recv, c.sent, c.fail, period, c.handler_us, c.bits);
+    }
+    unsigned long h[N2K_HISTOGRAM_BUCKETS];
+    snapshot_handler_time(h);
+    Log::tracex(N2K_STATS_LOG_TAG, "Handler time", "<1us {%lu} <16us {%lu} <256us {%lu} <4ms {%lu} >4ms {%lu}",
+        h[0], h[1] + h[2] + h[3] + h[4], h[5] + h[6] + h[7] + h[8], h[9] + h[10] + h[11] + h[12], h[13]);
+    if (get_untracked()) Log::tracex(N2K_STATS_LOG_TAG, "PGN stats", "untracked {%lu}", get_untracked());
+}
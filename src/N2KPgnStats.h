@@ -0,0 +1,97 @@
+#ifndef _N2K_PGN_STATS_H
+#define _N2K_PGN_STATS_H
+
+#include <N2kMsg.h>
+#include <atomic>
+
+#ifndef N2K_STATS_MAX_PGNS
+#define N2K_STATS_MAX_PGNS 64 // must be a power of two
+#endif
+
+#ifndef N2K_STATS_TOP_N
+#define N2K_STATS_TOP_N 10
+#endif
+
+#define N2K_STATS_SOURCES 256
+
+// log2 buckets: [0,1) [1,2) [2,4) ... [4096,inf)
+#define N2K_HISTOGRAM_BUCKETS 14
+
+struct N2KPgnCounters
+{
+    unsigned long pgn = 0;
+    unsigned long recv = 0;
+    unsigned long sent = 0;
+    unsigned long fail = 0;
+    unsigned long handler_us = 0;                          // total time spent in handlers
+    unsigned long bits = 0;                                // bus bits, when the bus load is enabled
+    unsigned long interarrival[N2K_HISTOGRAM_BUCKETS] = {0}; // ms between two received messages
+};
+
+/**
+ * Fixed-memory traffic counters per PGN and per source, plus inter-arrival (per PGN)
+ * and handler execution time (global) histograms.
+ * Counters are only ever incremented by the N2K loop, so the loop never blocks and
+ * never contends; a single monitoring task can take snapshots at any time and reset()
+ * just moves its own baseline, so snapshots return the deltas since the last reset.
+ */
+class N2KPgnStats
+{
+public:
+    N2KPgnStats();
+
+    // writer side (N2K loop)
+    void record_recv(const tN2kMsg &N2kMsg, unsigned long now_ms);
+    void record_sent(unsigned long pgn, bool success);
+    void record_handler(unsigned long pgn, unsigned long us);
+    void record_bits(unsigned long pgn, unsigned char source, unsigned long bits);
+
+    // reader side, lock-free
+    int snapshot(N2KPgnCounters *out, int max_entries);
+    void snapshot_sources(unsigned long *out);      // N2K_STATS_SOURCES entries
+    void snapshot_source_bits(unsigned long *out);  // N2K_STATS_SOURCES entries
+    void snapshot_handler_time(unsigned long *out); // N2K_HISTOGRAM_BUCKETS entries, us
+    unsigned long get_untracked() const;            // messages of PGNs that did not fit the table
+    unsigned long get_handler_total_us() const;
+    void reset();
+
+    void dump(int top_n = N2K_STATS_TOP_N);
+
+    static int get_bucket(unsigned long value);
+
+private:
+    typedef std::atomic<unsigned long> counter;
+
+    struct entry
+    {
+        std::atomic<unsigned long> pgn; // 0 marks a free entry
+        counter recv;
+        counter sent;
+        counter fail;
+        counter handler_us;
+        counter bits;
+        counter interarrival[N2K_HISTOGRAM_BUCKETS];
+        unsigned long last_time; // writer only
+    };
+
+    entry *find(unsigned long pgn, bool create);
+
+    void read_entry(int i, N2KPgnCounters &out);
+
+    entry entries[N2K_STATS_MAX_PGNS];
+    counter sources[N2K_STATS_SOURCES];
+    counter source_bits[N2K_STATS_SOURCES];
+    counter handler_time[N2K_HISTOGRAM_BUCKETS];
+    counter handler_total_us;
+    counter untracked;
+
+    // reader side baselines, moved by reset()
+    N2KPgnCounters base_entries[N2K_STATS_MAX_PGNS];
+    unsigned long base_sources[N2K_STATS_SOURCES];
+    unsigned long base_source_bits[N2K_STATS_SOURCES];
+    unsigned long base_handler_time[N2K_HISTOGRAM_BUCKETS];
+    unsigned long base_handler_total_us;
+    unsigned long base_untracked;
+};
+
+#endif // _N2K_PGN_STATS_H
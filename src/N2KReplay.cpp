@@ -0,0 +1,215 @@
+#ifdef NATIVE
+#include "N2KReplay.h"
+#include "N2KVirtualBus.h"
+#include "N2K.h"
+#include "Log.h"
+#include "Utils.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#define N2K_REPLAY_LOG_TAG "N2kReplay"
+
+static const char *skip_spaces(const char *p)
+{
+    while (*p == ' ' || *p == '\t') p++;
+    return p;
+}
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// parses a sequence of hex bytes, either packed ("A0C2F9") or space separated ("A0 C2 F9")
+static bool parse_data(const char *p, N2KReplayFrame &frame)
+{
+    frame.len = 0;
+    while (true)
+    {
+        p = skip_spaces(p);
+        int h = hex_value(p[0]);
+        if (h < 0) break;
+        int l = hex_value(p[1]);
+        if (l < 0 || frame.len == 8) return false;
+        frame.data[frame.len++] = (h << 4) | l;
+        p += 2;
+    }
+    return *p == 0 || *p == '\r' || *p == '\n';
+}
+
+// "(1436509053.650713) can0 09F80102#A0C2F9FE70C12F07"
+static bool parse_candump_log(const char *line, N2KReplayFrame &frame)
+{
+    char *end;
+    unsigned long long sec = strtoull(line + 1, &end, 10);
+    unsigned long long usec = 0;
+    if (*end == '.')
+    {
+        const char *frac = end + 1;
+        usec = strtoull(frac, &end, 10);
+        for (int digits = end - frac; digits < 6; digits++) usec *= 10;
+        for (int digits = end - frac; digits > 6; digits--) usec /= 10;
+    }
+    if (*end != ')') return false;
+    const char *p = skip_spaces(end + 1);
+    while (*p && *p != ' ') p++; // interface
+    frame.id = strtoul(p, &end, 16);
+    if (*end != '#') return false;
+    frame.time_us = sec * 1000000ULL + usec;
+    return parse_data(end + 1, frame);
+}
+
+// "  can0  09F80102   [8]  A0 C2 F9 FE 70 C1 2F 07" (no timestamp)
+static bool parse_candump(const char *line, N2KReplayFrame &frame)
+{
+    const char *p = skip_spaces(line);
+    while (*p && *p != ' ') p++; // interface
+    char *end;
+    frame.id = strtoul(p, &end, 16);
+    p = skip_spaces(end);
+    if (*p != '[') return false;
+    int len = strtol(p + 1, &end, 10);
+    if (*end != ']') return false;
+    frame.time_us = 0;
+    return parse_data(end + 1, frame) && frame.len == len;
+}
+
+// "17:33:21.107 R 19F51323 01 2F 30 70 00 2F 30 70" (Actisense/YDWG RAW)
+static bool parse_raw(const char *line, N2KReplayFrame &frame)
+{
+    char *end;
+    unsigned long h = strtoul(line, &end, 10);
+    if (*end != ':') return false;
+    unsigned long m = strtoul(end + 1, &end, 10);
+    if (*end != ':') return false;
+    double s = strtod(end + 1, &end);
+    const char *p = skip_spaces(end);
+    if (*p != 'R' && *p != 'T') return false;
+    frame.id = strtoul(p + 1, &end, 16);
+    frame.time_us = (unsigned long long)((h * 3600 + m * 60) * 1000000ULL + s * 1000000.0);
+    return parse_data(end, frame);
+}
+
+bool N2KReplay::parse_line(const char *line, N2KReplayFrame &frame)
+{
+    const char *p = skip_spaces(line);
+    bool ok;
+    if (*p == '(') ok = parse_candump_log(p, frame);
+    else if (isdigit(*p)) ok = parse_raw(p, frame);
+    else if (isalpha(*p)) ok = parse_candump(p, frame);
+    else ok = false;
+    return ok && frame.id <= 0x1FFFFFFF;
+}
+
+N2KReplay::N2KReplay(N2K *_n2k, N2KVirtualBus *_bus): n2k(_n2k), bus(_bus), f(nullptr)
+{
+}
+
+N2KReplay::~N2KReplay()
+{
+    close();
+}
+
+bool N2KReplay::open(const char *path)
+{
+    close();
+    f = fopen(path, "r");
+    if (f == nullptr)
+    {
+        Log::tracex(N2K_REPLAY_LOG_TAG, "Open failed", "file {%s}", path);
+    }
+    return f != nullptr;
+}
+
+void N2KReplay::close()
+{
+    if (f) fclose(f);
+    f = nullptr;
+}
+
+void N2KReplay::pump(N2KReplayReport &report)
+{
+    // let N2K consume everything injected so far, so node buffers never overflow
+    // (stops as soon as a loop makes no progress, e.g. frames still in flight on a throttled bus)
+    int pending = bus->get_max_pending();
+    int last;
+    do
+    {
+        unsigned long t0 = _micros();
+        n2k->loop(_millis());
+        report.loop_us += _micros() - t0;
+        last = pending;
+        pending = bus->get_max_pending();
+    } while (pending > 0 && pending < last);
+}
+
+N2KReplayReport N2KReplay::run(double speed)
+{
+    N2KReplayReport report;
+    if (f == nullptr || n2k == nullptr || bus == nullptr) return report;
+
+    N2KStats stats0 = n2k->getStats();
+    // handlers are timed only by the pgn stats, if the caller enabled them
+    N2KPgnStats *pgn_stats = stats0.pgn_stats;
+    unsigned long handler_us0 = pgn_stats ? pgn_stats->get_handler_total_us() : 0;
+    unsigned long recv0 = stats0.recv;
+
+    char line[256];
+    N2KReplayFrame frame;
+    unsigned long long first_frame_us = 0;
+    bool first = true;
+    int batch = 0;
+    unsigned long t_start = _micros();
+    while (fgets(line, sizeof(line), f))
+    {
+        if (!parse_line(line, frame))
+        {
+            report.skipped++;
+            continue;
+        }
+        if (first)
+        {
+            first_frame_us = frame.time_us;
+            first = false;
+        }
+        if (speed > 0.0 && frame.time_us >= first_frame_us)
+        {
+            unsigned long long due = (unsigned long long)((frame.time_us - first_frame_us) / speed);
+            unsigned long long elapsed = _micros() - t_start;
+            if (due > elapsed + 1000)
+            {
+                pump(report);
+                batch = 0;
+                elapsed = _micros() - t_start;
+                if (due > elapsed) msleep((due - elapsed) / 1000);
+            }
+        }
+        if (bus->inject(frame.id, frame.len, frame.data)) report.frames++;
+        else report.dropped++;
+        if (++batch >= N2K_REPLAY_BATCH)
+        {
+            pump(report);
+            batch = 0;
+        }
+    }
+    pump(report);
+
+    unsigned long wall_us = _micros() - t_start;
+    report.wall_ms = wall_us / 1000;
+    report.frames_per_sec = wall_us ? (report.frames * 1000000.0 / wall_us) : 0.0;
+    report.handler_us = pgn_stats ? pgn_stats->get_handler_total_us() - handler_us0 : 0;
+    report.messages = n2k->getStats().recv - recv0;
+    return report;
+}
+
+void N2KReplayReport::dump()
+{
+    Log::tracex(N2K_REPLAY_LOG_TAG, "Report", "frames {%lu} dropped {%lu} skipped {%lu} messages {%lu} time {%lums} rate {%.0f frames/s} loop {%luus} handlers {%luus}",
+        frames, dropped, skipped, messages, wall_ms, frames_per_sec, loop_us, handler_us);
+}
+
+#endif
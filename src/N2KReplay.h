@@ -0,0 +1,68 @@
+#ifndef _N2K_REPLAY_H
+#define _N2K_REPLAY_H
+
+#ifdef NATIVE
+
+#include <stdio.h>
+
+class N2K;
+class N2KVirtualBus;
+
+#ifndef N2K_REPLAY_BATCH
+#define N2K_REPLAY_BATCH 16 // frames injected between two N2K loops
+#endif
+
+struct N2KReplayFrame
+{
+    unsigned long id;
+    unsigned char len;
+    unsigned char data[8];
+    unsigned long long time_us; // log timestamp
+};
+
+struct N2KReplayReport
+{
+    unsigned long frames = 0;     // put on the bus
+    unsigned long dropped = 0;    // refused by the bus (busy, see N2K_VIRTUAL_NODE_TX_BACKLOG)
+    unsigned long skipped = 0;    // lines that could not be parsed
+    unsigned long wall_ms = 0;
+    double frames_per_sec = 0.0;
+    unsigned long loop_us = 0;    // time spent in N2K::loop (parsing + handlers)
+    unsigned long handler_us = 0; // time spent in handlers, when the N2K pgn stats are enabled
+    unsigned long messages = 0;   // messages delivered to N2K
+
+    void dump();
+};
+
+/**
+ * Plays a candump (-l or default format) or Actisense/YDWG RAW text log through an
+ * N2K instance attached to a virtual bus, so frames take the normal receive path
+ * (fast-packet assembly, handlers, stats, source claims).
+ * speed is a multiplier of the recorded timing: 1 is real time, 0 is as fast as possible.
+ * The bus should have a bit-rate of 0 when replaying faster than real time.
+ */
+class N2KReplay
+{
+public:
+    N2KReplay(N2K *n2k, N2KVirtualBus *bus);
+    ~N2KReplay();
+
+    bool open(const char *path);
+    void close();
+
+    N2KReplayReport run(double speed = 0.0);
+
+    // parses one log line in any of the supported formats
+    static bool parse_line(const char *line, N2KReplayFrame &frame);
+
+private:
+    void pump(N2KReplayReport &report);
+
+    N2K *n2k;
+    N2KVirtualBus *bus;
+    FILE *f;
+};
+
+#endif // NATIVE
+
+#endif // _N2K_REPLAY_H
@@ -0,0 +1,125 @@
+#include "N2KScheduler.h"
+#include "Log.h"
+
+#define N2K_SCHEDULER_LOG_TAG "N2kSched"
+
+N2KScheduler::N2KScheduler(n2k_tx_function _tx, void *_context): tx(_tx), context(_context)
+{
+}
+
+int N2KScheduler::add(unsigned long interval_ms, unsigned char priority, n2k_producer producer, void *ctx)
+{
+    if (producer == nullptr || interval_ms == 0) return -1;
+    for (int i = 0; i < N2K_SCHEDULER_MAX_TASKS; i++)
+    {
+        task &t = tasks[i];
+        if (t.producer == nullptr)
+        {
+            t.producer = producer;
+            t.context = ctx;
+            t.interval = interval_ms;
+            t.priority = priority;
+            t.stats = N2KScheduleStats();
+            spread(interval_ms);
+            return i;
+        }
+    }
+    return -1;
+}
+
+void N2KScheduler::remove(int handle)
+{
+    if (handle < 0 || handle >= N2K_SCHEDULER_MAX_TASKS || tasks[handle].producer == nullptr) return;
+    tasks[handle].producer = nullptr;
+    spread(tasks[handle].interval);
+}
+
+void N2KScheduler::spread(unsigned long interval)
+{
+    // evenly spaced phases for all the tasks sharing the interval, applied at the next loop
+    int n = 0;
+    for (int i = 0; i < N2K_SCHEDULER_MAX_TASKS; i++)
+    {
+        if (tasks[i].producer && tasks[i].interval == interval) n++;
+    }
+    int k = 0;
+    for (int i = 0; i < N2K_SCHEDULER_MAX_TASKS; i++)
+    {
+        task &t = tasks[i];
+        if (t.producer && t.interval == interval)
+        {
+            t.phase = (interval * k) / n;
+            t.scheduled = false;
+            k++;
+        }
+    }
+}
+
+void N2KScheduler::loop(unsigned long now)
+{
+    for (int i = 0; i < N2K_SCHEDULER_MAX_TASKS; i++)
+    {
+        task &t = tasks[i];
+        if (t.producer == nullptr) continue;
+        if (!t.scheduled)
+        {
+            t.next = now - (now % t.interval) + t.phase;
+            if ((long)(t.next - now) < 0) t.next += t.interval;
+            t.scheduled = true;
+        }
+        if ((long)(now - t.next) < 0) continue;
+
+        unsigned long late = now - t.next;
+        if (late >= t.interval)
+        {
+            // do not burst to catch up, keep the phase and count the lost periods
+            unsigned long lost = late / t.interval;
+            t.stats.missed += lost;
+            t.next += lost * t.interval;
+            late -= lost * t.interval;
+        }
+        if (late > t.stats.jitter_max_ms) t.stats.jitter_max_ms = late;
+        t.stats.jitter_total_ms += late;
+        t.next += t.interval;
+
+        t.msg.Clear();
+        if (!t.producer(t.msg, t.sid.getNew(), t.context))
+        {
+            t.stats.skipped++;
+            continue;
+        }
+        t.msg.Priority = t.priority;
+        t.stats.pgn = t.msg.PGN;
+        if (tx(t.msg, context)) t.stats.sent++;
+        else t.stats.failed++;
+    }
+}
+
+N2KScheduleStats N2KScheduler::get_stats(int handle) const
+{
+    if (handle < 0 || handle >= N2K_SCHEDULER_MAX_TASKS) return N2KScheduleStats();
+    return tasks[handle].stats;
+}
+
+void N2KScheduler::reset_stats()
+{
+    for (int i = 0; i < N2K_SCHEDULER_MAX_TASKS; i++)
+    {
+        unsigned long pgn = tasks[i].stats.pgn;
+        tasks[i].stats = N2KScheduleStats();
+        tasks[i].stats.pgn = pgn;
+    }
+}
+
+void N2KScheduler::dump()
+{
+    for (int i = 0; i < N2K_SCHEDULER_MAX_TASKS; i++)
+    {
+        const task &t = tasks[i];
+        if (t.producer == nullptr) continue;
+        unsigned long runs = t.stats.sent + t.stats.failed + t.stats.skipped;
+        Log::tracex(N2K_SCHEDULER_LOG_TAG, "Stats", "pgn {%lu} period {%lums} phase {%lums} tx {%lu/%lu} skipped {%lu} missed {%lu} jitter avg {%lums} max {%lums}",
+            t.stats.pgn, t.interval, t.phase, t.stats.sent, t.stats.failed, t.stats.skipped, t.stats.missed,
+            runs ? t.stats.jitter_total_ms / runs : 0UL, t.stats.jitter_max_ms);
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef _N2K_SCHEDULER_H
+#define _N2K_SCHEDULER_H
+
+#include <N2kMsg.h>
+#include "N2KTxQueue.h"
+#include "Utils.h"
+
+#ifndef N2K_SCHEDULER_MAX_TASKS
+#define N2K_SCHEDULER_MAX_TASKS 32
+#endif
+
+// Fills N2kMsg for this cycle, using sid when the PGN has one. Return false to skip the cycle.
+typedef bool (*n2k_producer)(tN2kMsg &N2kMsg, unsigned char sid, void *context);
+
+struct N2KScheduleStats
+{
+    unsigned long pgn = 0;            // of the last message produced
+    unsigned long sent = 0;
+    unsigned long failed = 0;
+    unsigned long skipped = 0;        // producer had nothing to send
+    unsigned long missed = 0;         // periods lost because loop() was late
+    unsigned long jitter_max_ms = 0;  // delay from the scheduled time
+    unsigned long jitter_total_ms = 0;
+};
+
+/**
+ * Periodic transmissions: components register a producer with an interval and a priority,
+ * and loop() calls it when due. Tasks with the same interval get evenly spaced phases
+ * within the period, so that e.g. all the 1Hz PGNs do not hit the bus in the same ms.
+ * Each task owns a preallocated message and a SID sequence, so nothing is allocated
+ * while running.
+ */
+class N2KScheduler
+{
+public:
+    N2KScheduler(n2k_tx_function tx, void *context);
+
+    // returns a handle for remove/get_stats, or -1 if N2K_SCHEDULER_MAX_TASKS is reached
+    int add(unsigned long interval_ms, unsigned char priority, n2k_producer producer, void *context);
+    void remove(int handle);
+
+    void loop(unsigned long now);
+
+    N2KScheduleStats get_stats(int handle) const;
+    void reset_stats();
+    void dump();
+
+private:
+    struct task
+    {
+        n2k_producer producer = nullptr; // nullptr marks a free slot
+        void *context = nullptr;
+        unsigned long interval = 0;
+        unsigned long phase = 0;
+        unsigned long next = 0;
+        bool scheduled = false;
+        unsigned char priority = 6;
+        N2KSid sid;
+        tN2kMsg msg;
+        N2KScheduleStats stats;
+    };
+
+    void spread(unsigned long interval);
+
+    task tasks[N2K_SCHEDULER_MAX_TASKS];
+    n2k_tx_function tx;
+    void *context;
+};
+
+#endif // _N2K_SCHEDULER_H
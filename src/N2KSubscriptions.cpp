@@ -0,0 +1,105 @@
+#include "N2KSubscriptions.h"
+#include <string.h>
+
+N2KSubscriptions::N2KSubscriptions(): n_pgns(0), version(0)
+{
+    memset(subs, 0, sizeof(subs));
+    memset(order, 0, sizeof(order));
+    memset(index, 0, sizeof(index));
+}
+
+int N2KSubscriptions::subscribe(unsigned long pgn, n2k_pgn_handler handler, void *context, unsigned char source)
+{
+    if (handler == nullptr) return -1;
+    for (int i = 0; i < N2K_MAX_SUBSCRIPTIONS; i++)
+    {
+        if (!subs[i].active)
+        {
+            subs[i].pgn = pgn;
+            subs[i].handler = handler;
+            subs[i].context = context;
+            subs[i].source = source;
+            subs[i].active = true;
+            rebuild_index();
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool N2KSubscriptions::unsubscribe(int handle)
+{
+    if (handle < 0 || handle >= N2K_MAX_SUBSCRIPTIONS || !subs[handle].active) return false;
+    subs[handle].active = false;
+    rebuild_index();
+    return true;
+}
+
+const N2KSubscriptions::index_entry *N2KSubscriptions::lookup(unsigned long pgn) const
+{
+    unsigned int h = hash(pgn);
+    for (int i = 0; i < INDEX_SIZE; i++)
+    {
+        const index_entry &e = index[(h + i) & (INDEX_SIZE - 1)];
+        if (e.count == 0) return nullptr;
+        if (e.pgn == pgn) return &e;
+    }
+    return nullptr;
+}
+
+int N2KSubscriptions::dispatch(const tN2kMsg &N2kMsg) const
+{
+    const index_entry *e = lookup(N2kMsg.PGN);
+    if (e == nullptr) return 0;
+    int calls = 0;
+    for (int i = e->first; i < e->first + e->count; i++)
+    {
+        const subscription &s = subs[order[i]];
+        if (s.source == N2K_ANY_SOURCE || s.source == N2kMsg.Source)
+        {
+            s.handler(N2kMsg, s.context);
+            calls++;
+        }
+    }
+    return calls;
+}
+
+int N2KSubscriptions::get_pgns(unsigned long *pgns, int max) const
+{
+    int n = 0;
+    for (int i = 0; i < INDEX_SIZE && n < max; i++)
+    {
+        if (index[i].count) pgns[n++] = index[i].pgn;
+    }
+    return n;
+}
+
+void N2KSubscriptions::rebuild_index()
+{
+    memset(index, 0, sizeof(index));
+    n_pgns = 0;
+    int n = 0;
+    bool placed[N2K_MAX_SUBSCRIPTIONS] = {false};
+    for (int i = 0; i < N2K_MAX_SUBSCRIPTIONS; i++)
+    {
+        if (!subs[i].active || placed[i]) continue;
+        // group every subscription sharing this PGN into a contiguous run
+        unsigned long pgn = subs[i].pgn;
+        int first = n;
+        for (int j = i; j < N2K_MAX_SUBSCRIPTIONS; j++)
+        {
+            if (subs[j].active && !placed[j] && subs[j].pgn == pgn)
+            {
+                order[n++] = j;
+                placed[j] = true;
+            }
+        }
+        unsigned int h = hash(pgn);
+        while (index[h].count != 0) h = (h + 1) & (INDEX_SIZE - 1);
+        index[h].pgn = pgn;
+        index[h].first = first;
+        index[h].count = n - first;
+        n_pgns++;
+    }
+    version++;
+}
@@ -0,0 +1,78 @@
+#ifndef _N2K_SUBSCRIPTIONS_H
+#define _N2K_SUBSCRIPTIONS_H
+
+#include <N2kMsg.h>
+
+#ifndef N2K_MAX_SUBSCRIPTIONS
+#define N2K_MAX_SUBSCRIPTIONS 32
+#endif
+
+#define N2K_ANY_SOURCE 0xFF
+
+typedef void (*n2k_pgn_handler)(const tN2kMsg &N2kMsg, void *context);
+
+/**
+ * Fixed-capacity registry of per-PGN (or per PGN+source) handlers.
+ * Subscriptions are grouped by PGN behind a small open-addressing hash that is rebuilt
+ * whenever the registry changes, so dispatching a message costs one hash probe and
+ * unsubscribed PGNs are discarded without calling anything.
+ * Handlers must not subscribe or unsubscribe while being dispatched, and the registry
+ * must not change while another thread dispatches (N2K freezes it once its rx thread runs).
+ */
+class N2KSubscriptions
+{
+public:
+    N2KSubscriptions();
+
+    // returns a handle to use with unsubscribe, or -1 if the registry is full
+    int subscribe(unsigned long pgn, n2k_pgn_handler handler, void *context, unsigned char source = N2K_ANY_SOURCE);
+    bool unsubscribe(int handle);
+
+    // calls the handlers subscribed to the message PGN (and source); returns the number of calls
+    int dispatch(const tN2kMsg &N2kMsg) const;
+
+    bool is_subscribed(unsigned long pgn) const { return lookup(pgn) != nullptr; }
+
+    bool empty() const { return n_pgns == 0; }
+
+    // copies the distinct subscribed PGNs into pgns; returns how many were copied
+    int get_pgns(unsigned long *pgns, int max) const;
+
+    // incremented on every change, to let dependent state (e.g. filters) refresh
+    unsigned long get_version() const { return version; }
+
+private:
+    // the index size must be a power of two and at least twice the number of subscriptions
+    static const int INDEX_BITS = 6;
+    static const int INDEX_SIZE = 1 << INDEX_BITS;
+    static_assert(N2K_MAX_SUBSCRIPTIONS * 2 <= INDEX_SIZE, "N2K_MAX_SUBSCRIPTIONS too large for the PGN index");
+
+    struct subscription
+    {
+        unsigned long pgn;
+        n2k_pgn_handler handler;
+        void *context;
+        unsigned char source;
+        bool active;
+    };
+
+    struct index_entry
+    {
+        unsigned long pgn;
+        unsigned char first; // first position in 'order'
+        unsigned char count; // 0 marks an empty entry
+    };
+
+    static unsigned int hash(unsigned long pgn) { return ((uint32_t)pgn * 2654435761u) >> (32 - INDEX_BITS); }
+
+    const index_entry *lookup(unsigned long pgn) const;
+    void rebuild_index();
+
+    subscription subs[N2K_MAX_SUBSCRIPTIONS];
+    unsigned char order[N2K_MAX_SUBSCRIPTIONS]; // subscription slots grouped by PGN
+    index_entry index[INDEX_SIZE];
+    int n_pgns;
+    unsigned long version;
+};
+
+#endif // _N2K_SUBSCRIPTIONS_H
@@ -0,0 +1,100 @@
+#include "N2KTxQueue.h"
+
+static const unsigned long max_age[N2K_TX_CLASSES] = {N2K_TX_HIGH_MAX_AGE, N2K_TX_NORMAL_MAX_AGE, N2K_TX_LOW_MAX_AGE};
+
+N2KTxQueue::N2KTxQueue(n2k_tx_function _tx, n2k_tx_result_function _result, void *_context): tx(_tx), result(_result), context(_context)
+{
+}
+
+int N2KTxQueue::get_class(unsigned char priority)
+{
+    if (priority <= 2) return N2K_TX_HIGH;
+    if (priority <= 5) return N2K_TX_NORMAL;
+    return N2K_TX_LOW;
+}
+
+bool N2KTxQueue::has_pending(int up_to_class) const
+{
+    for (int i = 0; i <= up_to_class && i < N2K_TX_CLASSES; i++)
+    {
+        if (queues[i].count) return true;
+    }
+    return false;
+}
+
+bool N2KTxQueue::send(const tN2kMsg &N2kMsg, unsigned long now)
+{
+    int cls = get_class(N2kMsg.Priority);
+    if (!held[cls] && !has_pending(cls) && tx(N2kMsg, context))
+    {
+        if (result) result(N2kMsg, true, context);
+        return true;
+    }
+    enqueue(cls, N2kMsg, now);
+    return true;
+}
+
+void N2KTxQueue::enqueue(int cls, const tN2kMsg &N2kMsg, unsigned long now)
+{
+    class_queue &q = queues[cls];
+    if (q.count == N2K_TX_QUEUE_SIZE)
+    {
+        // keep the freshest data: drop the oldest message of the class
+        stats[cls].dropped++;
+        if (result) result(q.slots[q.head].msg, false, context);
+        pop(cls);
+    }
+    slot &s = q.slots[(q.head + q.count) % N2K_TX_QUEUE_SIZE];
+    s.msg = N2kMsg;
+    s.time = now;
+    q.count++;
+    stats[cls].depth = q.count;
+    if (stats[cls].depth > stats[cls].hwm) stats[cls].hwm = stats[cls].depth;
+}
+
+void N2KTxQueue::pop(int cls)
+{
+    class_queue &q = queues[cls];
+    q.head = (q.head + 1) % N2K_TX_QUEUE_SIZE;
+    q.count--;
+    stats[cls].depth = q.count;
+}
+
+void N2KTxQueue::flush(unsigned long now)
+{
+    for (int cls = 0; cls < N2K_TX_CLASSES; cls++)
+    {
+        class_queue &q = queues[cls];
+        while (q.count)
+        {
+            slot &s = q.slots[q.head];
+            if ((now - s.time) > max_age[cls])
+            {
+                stats[cls].stale++;
+                if (result) result(s.msg, false, context);
+                pop(cls);
+                continue;
+            }
+            if (held[cls]) break;
+            stats[cls].retried++;
+            if (!tx(s.msg, context))
+            {
+                // bus still saturated, leave everything else for the next round
+                return;
+            }
+            if (result) result(s.msg, true, context);
+            pop(cls);
+        }
+    }
+}
+
+void N2KTxQueue::reset_stats()
+{
+    for (int i = 0; i < N2K_TX_CLASSES; i++)
+    {
+        stats[i].dropped = 0;
+        stats[i].stale = 0;
+        stats[i].retried = 0;
+        stats[i].hwm = stats[i].depth;
+    }
+}
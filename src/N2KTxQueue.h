@@ -0,0 +1,97 @@
+#ifndef _N2K_TX_QUEUE_H
+#define _N2K_TX_QUEUE_H
+
+#include <N2kMsg.h>
+
+#ifndef N2K_TX_QUEUE_SIZE
+#define N2K_TX_QUEUE_SIZE 16 // per priority class
+#endif
+
+// maximum time a message can wait in the queue, per class (ms)
+#ifndef N2K_TX_HIGH_MAX_AGE
+#define N2K_TX_HIGH_MAX_AGE 2000
+#endif
+#ifndef N2K_TX_NORMAL_MAX_AGE
+#define N2K_TX_NORMAL_MAX_AGE 1000
+#endif
+#ifndef N2K_TX_LOW_MAX_AGE
+#define N2K_TX_LOW_MAX_AGE 500
+#endif
+
+#define N2K_TX_CLASSES 3
+
+enum n2k_tx_class
+{
+    N2K_TX_HIGH = 0,   // priority 0-2 (e.g. heading, rudder)
+    N2K_TX_NORMAL = 1, // priority 3-5
+    N2K_TX_LOW = 2     // priority 6-7 (e.g. environmental data)
+};
+
+struct N2KTxClassStats
+{
+    unsigned long depth = 0;
+    unsigned long hwm = 0;
+    unsigned long dropped = 0; // queue full
+    unsigned long stale = 0;   // waited longer than the class max age
+    unsigned long retried = 0;
+};
+
+typedef bool (*n2k_tx_function)(const tN2kMsg &N2kMsg, void *context);
+typedef void (*n2k_tx_result_function)(const tN2kMsg &N2kMsg, bool success, void *context);
+
+/**
+ * Priority transmit scheduler: messages that cannot be sent immediately are parked in a
+ * bounded queue per priority class and retried by flush(), highest class first.
+ * A message is sent directly only if nothing of equal or higher class is waiting, and
+ * flushing stops at the first failure, so a saturated bus backs pressure onto the
+ * lower classes. The result function is called once per message, when it is finally
+ * sent or dropped.
+ */
+class N2KTxQueue
+{
+public:
+    N2KTxQueue(n2k_tx_function tx, n2k_tx_result_function result, void *context);
+
+    // returns true if the message was sent or queued
+    bool send(const tN2kMsg &N2kMsg, unsigned long now);
+
+    void flush(unsigned long now);
+
+    bool has_pending(int up_to_class) const;
+
+    // Hold back a class (e.g. when the bus is busy): its messages are queued, not sent,
+    // until released or expired.
+    void set_hold(int cls, bool hold) { held[cls] = hold; }
+    bool is_held(int cls) const { return held[cls]; }
+
+    const N2KTxClassStats &get_stats(int cls) const { return stats[cls]; }
+    void reset_stats();
+
+    static int get_class(unsigned char priority);
+
+private:
+    struct slot
+    {
+        tN2kMsg msg;
+        unsigned long time;
+    };
+
+    struct class_queue
+    {
+        slot slots[N2K_TX_QUEUE_SIZE];
+        int head = 0;
+        int count = 0;
+    };
+
+    void enqueue(int cls, const tN2kMsg &N2kMsg, unsigned long now);
+    void pop(int cls);
+
+    class_queue queues[N2K_TX_CLASSES];
+    bool held[N2K_TX_CLASSES] = {false, false, false};
+    N2KTxClassStats stats[N2K_TX_CLASSES];
+    n2k_tx_function tx;
+    n2k_tx_result_function result;
+    void *context;
+};
+
+#endif // _N2K_TX_QUEUE_H
@@ -0,0 +1,210 @@
+#ifdef NATIVE
+#include "N2KVirtualBus.h"
+#include "N2KBusLoad.h"
+#include "Utils.h"
+#include <string.h>
+
+tNMEA2000_virtual::tNMEA2000_virtual(N2KVirtualBus *b): tNMEA2000(), bus(b), open(false)
+{
+    if (bus && !bus->attach(this)) bus = nullptr;
+}
+
+tNMEA2000_virtual::~tNMEA2000_virtual()
+{
+    if (bus) bus->detach(this);
+}
+
+bool tNMEA2000_virtual::CANOpen()
+{
+    open = bus && bus->open_node();
+    return open;
+}
+
+bool tNMEA2000_virtual::CANSendFrame(unsigned long id, unsigned char len, const unsigned char *buf, bool wait_sent)
+{
+    return open && bus && bus->transmit(this, id, len, buf);
+}
+
+bool tNMEA2000_virtual::CANGetFrame(unsigned long &id, unsigned char &len, unsigned char *buf)
+{
+    N2KVirtualFrame *f = rx.front();
+    if (f == nullptr || (long)(_micros() - f->delivery_us) < 0) return false;
+    id = f->id;
+    len = f->len;
+    memcpy(buf, f->data, len);
+    rx.pop();
+    return true;
+}
+
+N2KVirtualBus::N2KVirtualBus(unsigned long bps): bitrate(bps), busy_until_us(0), exact_bits(false), drop_threshold(0), rnd(1), open_failures(0)
+{
+    memset(nodes, 0, sizeof(nodes));
+}
+
+N2KVirtualBus::~N2KVirtualBus()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    for (int i = 0; i < N2K_VIRTUAL_BUS_MAX_NODES; i++)
+    {
+        if (nodes[i]) nodes[i]->bus = nullptr;
+    }
+}
+
+tNMEA2000_virtual *N2KVirtualBus::create_node()
+{
+    tNMEA2000_virtual *n = new tNMEA2000_virtual(this);
+    if (!n->is_attached())
+    {
+        delete n;
+        return nullptr;
+    }
+    return n;
+}
+
+void N2KVirtualBus::destroy_node(tNMEA2000_virtual *node)
+{
+    if (node == nullptr) return;
+    detach(node);
+    node->bus = nullptr;
+    delete node;
+}
+
+bool N2KVirtualBus::attach(tNMEA2000_virtual *node)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    for (int i = 0; i < N2K_VIRTUAL_BUS_MAX_NODES; i++)
+    {
+        if (nodes[i] == nullptr)
+        {
+            nodes[i] = node;
+            return true;
+        }
+    }
+    return false;
+}
+
+void N2KVirtualBus::detach(tNMEA2000_virtual *node)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    for (int i = 0; i < N2K_VIRTUAL_BUS_MAX_NODES; i++)
+    {
+        if (nodes[i] == node) nodes[i] = nullptr;
+    }
+}
+
+void N2KVirtualBus::set_drop_rate(double probability, unsigned long seed)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (probability <= 0.0) drop_threshold = 0;
+    else if (probability >= 1.0) drop_threshold = 0xFFFFFFFF;
+    else drop_threshold = (unsigned long)(probability * 4294967295.0);
+    rnd = seed ? seed : 1;
+}
+
+void N2KVirtualBus::set_open_failures(int count)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    open_failures = count;
+}
+
+bool N2KVirtualBus::open_node()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (open_failures <= 0) return true;
+    open_failures--;
+    return false;
+}
+
+bool N2KVirtualBus::should_drop()
+{
+    if (drop_threshold == 0) return false;
+    // xorshift32, reproducible for a given seed
+    uint32_t x = (uint32_t)rnd;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    rnd = x;
+    return x <= drop_threshold;
+}
+
+unsigned long N2KVirtualBus::frame_bits(unsigned char len)
+{
+    // SOF, 29 bit id, SRR, IDE, RTR, r1, r0, DLC, data, CRC: 54 + 8 * len stuffable bits
+    unsigned long stuffable = 54 + 8UL * len;
+    // CRC delimiter, ACK, EOF, intermission
+    return stuffable + (stuffable - 1) / 4 + 13;
+}
+
+bool N2KVirtualBus::transmit(tNMEA2000_virtual *sender, unsigned long id, unsigned char len, const unsigned char *buf)
+{
+    if (len > 8) return false;
+    std::lock_guard<std::mutex> guard(lock);
+    unsigned long now = _micros();
+    unsigned long bits = exact_bits ? N2KBusLoad::frame_bits(id, len, buf) : frame_bits(len);
+    unsigned long delivery = now;
+    if (bitrate)
+    {
+        // the sender mailboxes are full while its oldest tracked frame is still on the bus
+        N2KVirtualTxBacklog &b = sender ? sender->backlog : inject_backlog;
+        if ((long)(b.end_us[b.pos] - now) > 0)
+        {
+            stats.rejected++;
+            return false;
+        }
+        unsigned long duration = (bits * 1000000UL) / bitrate;
+        unsigned long start = ((long)(busy_until_us - now) > 0) ? busy_until_us : now;
+        busy_until_us = start + duration;
+        delivery = busy_until_us;
+        b.end_us[b.pos] = delivery;
+        b.pos = (b.pos + 1) % (N2K_VIRTUAL_NODE_TX_BACKLOG + 1);
+    }
+    stats.frames++;
+    stats.bits += bits;
+    for (int i = 0; i < N2K_VIRTUAL_BUS_MAX_NODES; i++)
+    {
+        tNMEA2000_virtual *n = nodes[i];
+        if (n == nullptr || n == sender || !n->open) continue;
+        if (should_drop())
+        {
+            stats.dropped++;
+            continue;
+        }
+        N2KVirtualFrame *f = n->rx.acquire_write();
+        if (f == nullptr)
+        {
+            stats.overflow++;
+            continue;
+        }
+        f->id = id;
+        f->len = len;
+        memcpy(f->data, buf, len);
+        f->delivery_us = delivery;
+        n->rx.commit_write();
+    }
+    return true;
+}
+
+int N2KVirtualBus::get_max_pending()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    int res = 0;
+    for (int i = 0; i < N2K_VIRTUAL_BUS_MAX_NODES; i++)
+    {
+        if (nodes[i] && nodes[i]->open && (int)nodes[i]->rx.size() > res) res = nodes[i]->rx.size();
+    }
+    return res;
+}
+
+N2KVirtualBusStats N2KVirtualBus::get_stats()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return stats;
+}
+
+void N2KVirtualBus::reset_stats()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    stats = N2KVirtualBusStats();
+}
+
+#endif
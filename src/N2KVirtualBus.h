@@ -0,0 +1,141 @@
+#ifndef _N2K_VIRTUAL_BUS_H
+#define _N2K_VIRTUAL_BUS_H
+
+#ifdef NATIVE
+
+#include <NMEA2000.h>
+#include <mutex>
+#include <atomic>
+#include "SPSCQueue.h"
+
+#ifndef N2K_VIRTUAL_BUS_MAX_NODES
+#define N2K_VIRTUAL_BUS_MAX_NODES 8
+#endif
+
+#ifndef N2K_VIRTUAL_NODE_RX_SIZE
+#define N2K_VIRTUAL_NODE_RX_SIZE 256 // frames, must be a power of two
+#endif
+
+// frames each node (and the injector) can have waiting on a busy bus, besides the one being
+// transmitted, before CANSendFrame fails (like the controller mailboxes)
+#ifndef N2K_VIRTUAL_NODE_TX_BACKLOG
+#define N2K_VIRTUAL_NODE_TX_BACKLOG 3
+#endif
+
+struct N2KVirtualFrame
+{
+    unsigned long id;
+    unsigned char len;
+    unsigned char data[8];
+    unsigned long delivery_us; // not visible to the receiver before this time
+};
+
+// end of transmission of the last frames of one sender, oldest at pos
+struct N2KVirtualTxBacklog
+{
+    unsigned long end_us[N2K_VIRTUAL_NODE_TX_BACKLOG + 1] = {0};
+    int pos = 0;
+};
+
+struct N2KVirtualBusStats
+{
+    unsigned long frames = 0;   // frames put on the bus
+    unsigned long bits = 0;     // bus time used, in bits
+    unsigned long rejected = 0; // send attempts refused because the bus was busy
+    unsigned long dropped = 0;  // deliveries dropped by injection
+    unsigned long overflow = 0; // deliveries lost because a node rx buffer was full
+};
+
+class N2KVirtualBus;
+
+/**
+ * tNMEA2000 backend attached to an N2KVirtualBus: address claim, fast-packet
+ * and everything else the library does run unchanged on top of it.
+ */
+class tNMEA2000_virtual: public tNMEA2000
+{
+public:
+    tNMEA2000_virtual(N2KVirtualBus *bus);
+    virtual ~tNMEA2000_virtual();
+
+    bool is_attached() const { return bus != nullptr; }
+
+protected:
+    virtual bool CANSendFrame(unsigned long id, unsigned char len, const unsigned char *buf, bool wait_sent = true);
+    virtual bool CANOpen();
+    virtual bool CANGetFrame(unsigned long &id, unsigned char &len, unsigned char *buf);
+
+private:
+    friend class N2KVirtualBus;
+    N2KVirtualBus *bus;
+    SPSCQueue<N2KVirtualFrame, N2K_VIRTUAL_NODE_RX_SIZE> rx;
+    N2KVirtualTxBacklog backlog; // guarded by the bus lock
+    std::atomic<bool> open;      // set by the node thread, read by the senders
+};
+
+/**
+ * In-process CAN bus for native builds. Every frame sent by a node is delivered to
+ * all the other attached nodes. With a bit-rate set, frames are serialized on the bus:
+ * they become visible to receivers only after their transmission time and each node
+ * cannot queue more than N2K_VIRTUAL_NODE_TX_BACKLOG frames ahead, so throughput and
+ * saturation behave like a real bus. A bit-rate of 0 delivers immediately.
+ */
+class N2KVirtualBus
+{
+public:
+    N2KVirtualBus(unsigned long bitrate = 250000);
+    ~N2KVirtualBus();
+
+    // returns a new node attached to the bus (owned by the caller), or nullptr if the bus is full
+    tNMEA2000_virtual *create_node();
+    // detaches and frees a node returned by create_node, so that its slot can be reused
+    void destroy_node(tNMEA2000_virtual *node);
+
+    void set_bitrate(unsigned long bps) { bitrate = bps; }
+    unsigned long get_bitrate() const { return bitrate; }
+
+    // time frames by their exact length (actual stuff bits, see N2KBusLoad) instead of the worst case
+    void set_exact_bits(bool exact) { exact_bits = exact; }
+
+    // probability [0..1] of dropping each delivery to a receiver, with a reproducible sequence
+    void set_drop_rate(double probability, unsigned long seed = 1);
+
+    // the next count node opens fail, like an interface that is not up yet
+    void set_open_failures(int count);
+
+    // puts a frame on the bus on behalf of a device that is not a node (e.g. a log replay)
+    bool inject(unsigned long id, unsigned char len, const unsigned char *buf) { return transmit(nullptr, id, len, buf); }
+
+    // largest number of frames waiting to be read by any node
+    int get_max_pending();
+
+    N2KVirtualBusStats get_stats();
+    void reset_stats();
+
+    // nominal bit length of an extended data frame, with worst-case stuffing
+    static unsigned long frame_bits(unsigned char len);
+
+private:
+    friend class tNMEA2000_virtual;
+
+    bool transmit(tNMEA2000_virtual *sender, unsigned long id, unsigned char len, const unsigned char *buf);
+    bool attach(tNMEA2000_virtual *node);
+    void detach(tNMEA2000_virtual *node);
+    bool should_drop();
+    bool open_node();
+
+    std::mutex lock;
+    tNMEA2000_virtual *nodes[N2K_VIRTUAL_BUS_MAX_NODES];
+    unsigned long bitrate;
+    unsigned long busy_until_us;
+    N2KVirtualTxBacklog inject_backlog;
+    bool exact_bits;
+    unsigned long drop_threshold; // 0 = never drop
+    unsigned long rnd;
+    int open_failures;
+    N2KVirtualBusStats stats;
+};
+
+#endif // NATIVE
+
+#endif // _N2K_VIRTUAL_BUS_H
@@ -0,0 +1,256 @@
+#include "NMEA0183Gateway.h"
+#include "Log.h"
+#include <N2kMessages.h>
+#include <math.h>
+
+#define NMEA0183_GATEWAY_LOG_TAG "N0183GW"
+
+#define NMEA0183_GATEWAY_RMC 1
+#define NMEA0183_GATEWAY_GGA 2
+#define NMEA0183_GATEWAY_VTG 4
+
+#define KNOTS_TO_MS (1852.0 / 3600.0)
+
+static double na(double v)
+{
+    return isnan(v) ? N2kDoubleNA : v;
+}
+
+static double rad(double deg)
+{
+    return isnan(deg) ? N2kDoubleNA : DegToRad(deg);
+}
+
+static double merge(double current, double v)
+{
+    return isnan(v) ? current : v;
+}
+
+NMEA0183Gateway::NMEA0183Gateway(n2k_tx_function _tx, void *_context): tx(_tx), context(_context), last_seen(0), batch_size(0)
+{
+    cycle.open = false;
+}
+
+tN2kMsg &NMEA0183Gateway::next_msg()
+{
+    // a conversion larger than the batch goes out in more batches (same SID)
+    if (batch_size == NMEA0183_GATEWAY_MAX_BATCH) send_batch();
+    tN2kMsg &m = batch[batch_size++];
+    m.Clear();
+    return m;
+}
+
+void NMEA0183Gateway::send_batch()
+{
+    if (batch_size == 0) return;
+    stats.batches++;
+    for (int i = 0; i < batch_size; i++)
+    {
+        if (tx(batch[i], context)) stats.sent++;
+        else stats.failed++;
+    }
+    batch_size = 0;
+}
+
+void NMEA0183Gateway::begin(unsigned int type, double time)
+{
+    // a different time (or a type already seen) means a new fix
+    if (cycle.open && ((cycle.seen & type) || (!isnan(time) && !isnan(cycle.time) && time != cycle.time))) flush();
+    if (!cycle.open)
+    {
+        cycle.open = true;
+        cycle.timed = false;
+        cycle.seen = 0;
+        cycle.time = NAN;
+        cycle.valid = false;
+        cycle.latitude = cycle.longitude = NAN;
+        cycle.cog_true = cycle.cog_magnetic = cycle.sog = NAN;
+        cycle.days = -1;
+        cycle.variation = NAN;
+        cycle.gga = false;
+    }
+    cycle.time = merge(cycle.time, time);
+}
+
+void NMEA0183Gateway::end(unsigned int type)
+{
+    cycle.seen |= type;
+    // all that the receiver sent last time has arrived: no need to wait
+    if (last_seen && (cycle.seen & last_seen) == last_seen) flush();
+}
+
+void NMEA0183Gateway::flush()
+{
+    if (!cycle.open) return;
+    cycle.open = false;
+    last_seen = cycle.seen;
+    stats.cycles++;
+
+    unsigned char s = sid.getNew();
+    bool position = cycle.valid && !isnan(cycle.latitude) && !isnan(cycle.longitude);
+    if (position)
+    {
+        SetN2kPGN129025(next_msg(), cycle.latitude, cycle.longitude);
+    }
+    if (cycle.valid && (!isnan(cycle.sog) || !isnan(cycle.cog_true) || !isnan(cycle.cog_magnetic)))
+    {
+        bool magnetic = isnan(cycle.cog_true) && !isnan(cycle.cog_magnetic);
+        SetN2kPGN129026(next_msg(), s, magnetic ? N2khr_magnetic : N2khr_true,
+            rad(magnetic ? cycle.cog_magnetic : cycle.cog_true), na(cycle.sog * KNOTS_TO_MS));
+    }
+    if (cycle.gga && position)
+    {
+        tN2kGNSSmethod method = cycle.quality == 2 ? N2kGNSSm_DGNSS : (cycle.quality > 0 ? N2kGNSSm_GNSSfix : N2kGNSSm_noGNSS);
+        SetN2kPGN129029(next_msg(), s, cycle.days >= 0 ? cycle.days : N2kUInt16NA, na(cycle.time),
+            cycle.latitude, cycle.longitude, na(cycle.altitude), N2kGNSSt_GPS, method,
+            cycle.satellites >= 0 ? cycle.satellites : N2kUInt8NA, na(cycle.hdop), N2kDoubleNA, na(cycle.geoid_separation));
+    }
+    if (cycle.valid && !isnan(cycle.variation))
+    {
+        SetN2kPGN127258(next_msg(), s, N2kmagvar_Calc, cycle.days >= 0 ? cycle.days : N2kUInt16NA, rad(cycle.variation));
+    }
+    if (cycle.days >= 0 && !isnan(cycle.time))
+    {
+        SetN2kPGN126992(next_msg(), s, cycle.days, cycle.time, N2ktimes_GPS);
+    }
+    send_batch();
+}
+
+void NMEA0183Gateway::loop(unsigned long now)
+{
+    if (!cycle.open) return;
+    // sentences carry no local time: the cycle is timed from the first loop that sees it
+    if (!cycle.timed)
+    {
+        cycle.opened = now;
+        cycle.timed = true;
+    }
+    else if ((now - cycle.opened) >= NMEA0183_GATEWAY_CYCLE_MS) flush();
+}
+
+void NMEA0183Gateway::on_rmc(const NMEA0183RMC &rmc, const NMEA0183Sentence &s)
+{
+    begin(NMEA0183_GATEWAY_RMC, rmc.time);
+    cycle.valid |= rmc.valid;
+    cycle.latitude = merge(cycle.latitude, rmc.latitude);
+    cycle.longitude = merge(cycle.longitude, rmc.longitude);
+    cycle.sog = merge(cycle.sog, rmc.sog);
+    cycle.cog_true = merge(cycle.cog_true, rmc.cog);
+    cycle.variation = merge(cycle.variation, rmc.variation);
+    if (rmc.year > 0 && rmc.month > 0 && rmc.day > 0) cycle.days = getDaysSince1970(rmc.year, rmc.month, rmc.day);
+    if (!rmc.valid) stats.ignored++;
+    end(NMEA0183_GATEWAY_RMC);
+}
+
+void NMEA0183Gateway::on_gga(const NMEA0183GGA &gga, const NMEA0183Sentence &s)
+{
+    begin(NMEA0183_GATEWAY_GGA, gga.time);
+    cycle.valid |= gga.quality > 0;
+    cycle.latitude = merge(cycle.latitude, gga.latitude);
+    cycle.longitude = merge(cycle.longitude, gga.longitude);
+    cycle.gga = true;
+    cycle.quality = gga.quality;
+    cycle.satellites = gga.satellites;
+    cycle.hdop = gga.hdop;
+    cycle.altitude = gga.altitude;
+    cycle.geoid_separation = gga.geoid_separation;
+    if (gga.quality <= 0) stats.ignored++;
+    end(NMEA0183_GATEWAY_GGA);
+}
+
+void NMEA0183Gateway::on_vtg(const NMEA0183VTG &vtg, const NMEA0183Sentence &s)
+{
+    // no time: belongs to the open cycle
+    begin(NMEA0183_GATEWAY_VTG, NAN);
+    cycle.cog_true = merge(cycle.cog_true, vtg.cog_true);
+    cycle.cog_magnetic = merge(cycle.cog_magnetic, vtg.cog_magnetic);
+    cycle.sog = merge(cycle.sog, isnan(vtg.sog_knots) ? vtg.sog_kmh / 1.852 : vtg.sog_knots);
+    end(NMEA0183_GATEWAY_VTG);
+}
+
+void NMEA0183Gateway::on_hdg(const NMEA0183HDG &hdg, const NMEA0183Sentence &s)
+{
+    if (isnan(hdg.heading))
+    {
+        stats.ignored++;
+        return;
+    }
+    SetN2kPGN127250(next_msg(), sid.getNew(), rad(hdg.heading), rad(hdg.deviation), rad(hdg.variation), N2khr_magnetic);
+    send_batch();
+}
+
+void NMEA0183Gateway::on_mwv(const NMEA0183MWV &mwv, const NMEA0183Sentence &s)
+{
+    double speed = mwv.speed;
+    if (mwv.unit == 'N') speed *= KNOTS_TO_MS;
+    else if (mwv.unit == 'K') speed /= 3.6;
+    else if (mwv.unit != 'M') speed = NAN;
+    if (!mwv.valid || (isnan(speed) && isnan(mwv.angle)))
+    {
+        stats.ignored++;
+        return;
+    }
+    SetN2kPGN130306(next_msg(), sid.getNew(), na(speed), rad(mwv.angle), mwv.true_wind ? N2kWind_True_boat : N2kWind_Apparent);
+    send_batch();
+}
+
+void NMEA0183Gateway::on_dpt(const NMEA0183DPT &dpt, const NMEA0183Sentence &s)
+{
+    if (isnan(dpt.depth))
+    {
+        stats.ignored++;
+        return;
+    }
+    SetN2kPGN128267(next_msg(), sid.getNew(), dpt.depth, na(dpt.offset), na(dpt.max_range));
+    send_batch();
+}
+
+void NMEA0183Gateway::on_vhw(const NMEA0183VHW &vhw, const NMEA0183Sentence &s)
+{
+    double speed = isnan(vhw.speed_knots) ? vhw.speed_kmh / 3.6 : vhw.speed_knots * KNOTS_TO_MS;
+    unsigned char id = sid.getNew();
+    if (!isnan(speed))
+    {
+        SetN2kPGN128259(next_msg(), id, speed);
+    }
+    if (!isnan(vhw.heading_true) || !isnan(vhw.heading_magnetic))
+    {
+        bool magnetic = isnan(vhw.heading_true);
+        SetN2kPGN127250(next_msg(), id, rad(magnetic ? vhw.heading_magnetic : vhw.heading_true), N2kDoubleNA, N2kDoubleNA,
+            magnetic ? N2khr_magnetic : N2khr_true);
+    }
+    if (batch_size == 0) stats.ignored++;
+    send_batch();
+}
+
+void NMEA0183Gateway::on_xdr(const NMEA0183XDR &xdr, const NMEA0183Sentence &s)
+{
+    unsigned char id = sid.getNew();
+    for (int i = 0; i < xdr.n_measures; i++)
+    {
+        const NMEA0183XDRMeasure &m = xdr.measures[i];
+        if (isnan(m.value)) continue;
+        // the measure index is the instance
+        if (m.type == 'C' && m.unit == 'C')
+        {
+            bool water = m.name.find("WATER") != std::string_view::npos || m.name.find("SEA") != std::string_view::npos;
+            SetN2kPGN130316(next_msg(), id, i, water ? N2kts_SeaTemperature : N2kts_OutsideTemperature, m.value + 273.15);
+        }
+        else if (m.type == 'P' && (m.unit == 'B' || m.unit == 'P'))
+        {
+            SetN2kPGN130314(next_msg(), id, i, N2kps_Atmospheric, m.unit == 'B' ? m.value * 100000.0 : m.value);
+        }
+        else if (m.type == 'H' && m.unit == 'P')
+        {
+            SetN2kPGN130313(next_msg(), id, i, N2khs_OutsideHumidity, m.value);
+        }
+    }
+    if (batch_size == 0) stats.ignored++;
+    send_batch();
+}
+
+void NMEA0183Gateway::dump()
+{
+    Log::tracex(NMEA0183_GATEWAY_LOG_TAG, "Stats", "cycles {%lu} batches {%lu} sent {%lu} failed {%lu} ignored {%lu}",
+        stats.cycles, stats.batches, stats.sent, stats.failed, stats.ignored);
+}
@@ -0,0 +1,96 @@
+#ifndef _NMEA0183_GATEWAY_H
+#define _NMEA0183_GATEWAY_H
+
+#include "NMEA0183Parser.h"
+#include "N2KTxQueue.h"
+#include "Utils.h"
+#include <N2kMsg.h>
+
+// max time a fix cycle stays open waiting for more sentences of the same fix
+#ifndef NMEA0183_GATEWAY_CYCLE_MS
+#define NMEA0183_GATEWAY_CYCLE_MS 200
+#endif
+
+#ifndef NMEA0183_GATEWAY_MAX_BATCH
+#define NMEA0183_GATEWAY_MAX_BATCH 8
+#endif
+
+struct NMEA0183GatewayStats
+{
+    unsigned long cycles = 0;   // fix cycles flushed
+    unsigned long batches = 0;  // including the instruments ones
+    unsigned long sent = 0;
+    unsigned long failed = 0;
+    unsigned long ignored = 0;  // sentences without usable data (e.g. no fix, invalid wind)
+};
+
+/**
+ * NMEA 0183 to NMEA 2000 conversion, set as the handler of an NMEA0183Parser.
+ *
+ * GNSS sentences (RMC, GGA, VTG) are merged per fix cycle: a cycle collects the sentences
+ * with the same UTC time and is flushed when a new fix starts, when all the sentence types
+ * seen in the previous cycle arrived, or after NMEA0183_GATEWAY_CYCLE_MS (see loop). The
+ * flush sends 129025, 129026, 129029, 127258 (RMC variation) and 126992 as one batch
+ * sharing one SID.
+ * Instrument sentences are converted on arrival: DPT to 128267, HDG to 127250, MWV to
+ * 130306, VHW to 128259 (and 127250), XDR temperature, pressure and humidity to 130316,
+ * 130314 and 130313; the messages from one sentence share a SID.
+ */
+class NMEA0183Gateway: public NMEA0183Handler
+{
+public:
+    NMEA0183Gateway(n2k_tx_function tx, void *context);
+
+    // flushes a fix cycle left open for NMEA0183_GATEWAY_CYCLE_MS, counted on the loop time
+    // from the first loop that sees it open
+    void loop(unsigned long now);
+    void flush();
+
+    virtual void on_rmc(const NMEA0183RMC &rmc, const NMEA0183Sentence &s);
+    virtual void on_gga(const NMEA0183GGA &gga, const NMEA0183Sentence &s);
+    virtual void on_vtg(const NMEA0183VTG &vtg, const NMEA0183Sentence &s);
+    virtual void on_hdg(const NMEA0183HDG &hdg, const NMEA0183Sentence &s);
+    virtual void on_mwv(const NMEA0183MWV &mwv, const NMEA0183Sentence &s);
+    virtual void on_dpt(const NMEA0183DPT &dpt, const NMEA0183Sentence &s);
+    virtual void on_vhw(const NMEA0183VHW &vhw, const NMEA0183Sentence &s);
+    virtual void on_xdr(const NMEA0183XDR &xdr, const NMEA0183Sentence &s);
+
+    NMEA0183GatewayStats get_stats() const { return stats; }
+    void reset_stats() { stats = NMEA0183GatewayStats(); }
+    void dump();
+
+private:
+    struct fix_cycle
+    {
+        bool open;
+        bool timed;             // opened is set
+        unsigned long opened;   // loop time
+        unsigned int seen;      // sentence types, NMEA0183_GATEWAY_RMC...
+        double time;            // seconds of the day, NAN until known
+        bool valid;             // RMC status or GGA quality
+        double latitude, longitude;
+        double cog_true, cog_magnetic; // degrees
+        double sog;             // knots
+        int days;               // since 1970, -1 until known
+        double variation;
+        bool gga;
+        int quality, satellites;
+        double hdop, altitude, geoid_separation;
+    };
+
+    void begin(unsigned int type, double time);
+    void end(unsigned int type);
+    tN2kMsg &next_msg();
+    void send_batch();
+
+    n2k_tx_function tx;
+    void *context;
+    N2KSid sid;
+    fix_cycle cycle;
+    unsigned int last_seen;
+    tN2kMsg batch[NMEA0183_GATEWAY_MAX_BATCH];
+    int batch_size;
+    NMEA0183GatewayStats stats;
+};
+
+#endif // _NMEA0183_GATEWAY_H
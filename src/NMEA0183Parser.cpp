@@ -0,0 +1,342 @@
+#include "NMEA0183Parser.h"
+#include "Log.h"
+#include <math.h>
+#include <string.h>
+#include <stdint.h>
+
+#define NMEA0183_LOG_TAG "NMEA0183"
+
+// sentence types packed in an int, for the dispatch switch
+#define NMEA0183_TYPE(a, b, c) (((a) << 16) | ((b) << 8) | (c))
+
+static const double POW10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+static int hex_digit(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+static double signed_by(double v, std::string_view dir, char negative)
+{
+    if (!dir.empty() && dir[0] == negative) return -v;
+    return v;
+}
+
+static char to_char(std::string_view f)
+{
+    return f.empty() ? 0 : f[0];
+}
+
+NMEA0183Parser::NMEA0183Parser(NMEA0183Handler *h): handler(h), strict(false)
+{
+}
+
+unsigned char NMEA0183Parser::checksum(const char *data, int len)
+{
+    unsigned char c = 0;
+    for (int i = 0; i < len; i++) c ^= (unsigned char)data[i];
+    return c;
+}
+
+double NMEA0183Parser::to_double(std::string_view f)
+{
+    // [+-]digits[.digits], which is all NMEA uses; exact for up to 15 significant digits
+    // (integer mantissa divided by an exact power of ten)
+    size_t i = 0;
+    size_t n = f.size();
+    bool negative = false;
+    if (i < n && (f[i] == '-' || f[i] == '+'))
+    {
+        negative = f[i] == '-';
+        i++;
+    }
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool any = false;
+    for (; i < n && f[i] >= '0' && f[i] <= '9'; i++)
+    {
+        any = true;
+        if (digits < 19)
+        {
+            mantissa = mantissa * 10 + (f[i] - '0');
+            if (mantissa) digits++;
+        }
+        else exponent++;
+    }
+    if (i < n && f[i] == '.')
+    {
+        i++;
+        for (; i < n && f[i] >= '0' && f[i] <= '9'; i++)
+        {
+            any = true;
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + (f[i] - '0');
+                if (mantissa) digits++;
+                exponent--;
+            }
+        }
+    }
+    if (!any || i != n) return NAN;
+    double v = (double)mantissa;
+    if (exponent < 0) v = (-exponent <= 22) ? v / POW10[-exponent] : v * pow(10.0, exponent);
+    else if (exponent > 0) v = (exponent <= 22) ? v * POW10[exponent] : v * pow(10.0, exponent);
+    return negative ? -v : v;
+}
+
+int NMEA0183Parser::to_int(std::string_view f)
+{
+    if (f.empty() || f.size() > 9) return -1;
+    int v = 0;
+    for (char c: f)
+    {
+        if (c < '0' || c > '9') return -1;
+        v = v * 10 + (c - '0');
+    }
+    return v;
+}
+
+double NMEA0183Parser::to_latlon(std::string_view value, std::string_view hemisphere)
+{
+    double v = to_double(value);
+    if (isnan(v)) return NAN;
+    double degrees = floor(v / 100.0);
+    double d = degrees + (v - degrees * 100.0) / 60.0;
+    char h = to_char(hemisphere);
+    return (h == 'S' || h == 'W') ? -d : d;
+}
+
+double NMEA0183Parser::to_time(std::string_view f)
+{
+    if (f.size() < 6) return NAN;
+    int hh = to_int(f.substr(0, 2));
+    int mm = to_int(f.substr(2, 2));
+    double ss = to_double(f.substr(4));
+    if (hh < 0 || mm < 0 || isnan(ss)) return NAN;
+    return hh * 3600 + mm * 60 + ss;
+}
+
+bool NMEA0183Parser::split(const char *line, int len, NMEA0183Sentence &s, bool &checksum_ok)
+{
+    checksum_ok = false;
+    // skip the noise before the start delimiter (e.g. after reopening a port)
+    int start = 0;
+    while (start < len && line[start] != '$' && line[start] != '!') start++;
+    if (start == len) return false;
+    while (len > start && (line[len - 1] == '\r' || line[len - 1] == '\n' || line[len - 1] == ' ')) len--;
+
+    const char *body = line + start + 1;
+    int body_len = len - start - 1;
+    s.has_checksum = false;
+    if (body_len >= 3 && body[body_len - 3] == '*')
+    {
+        int hi = hex_digit(body[body_len - 2]);
+        int lo = hex_digit(body[body_len - 1]);
+        if (hi < 0 || lo < 0) return false;
+        s.has_checksum = true;
+        body_len -= 3;
+        checksum_ok = checksum(body, body_len) == (unsigned char)((hi << 4) | lo);
+    }
+    else
+    {
+        checksum_ok = true;
+    }
+
+    const char *comma = (const char *)memchr(body, ',', body_len);
+    int address_len = comma ? (int)(comma - body) : body_len;
+    if (address_len < 2) return false;
+    s.start = line[start];
+    if (body[0] == 'P')
+    {
+        s.talker = std::string_view(body, 1);
+        s.type = std::string_view(body + 1, address_len - 1);
+    }
+    else
+    {
+        if (address_len < 3) return false;
+        s.talker = std::string_view(body, address_len - 3);
+        s.type = std::string_view(body + address_len - 3, 3);
+    }
+
+    s.n_fields = 0;
+    if (comma)
+    {
+        const char *p = comma + 1;
+        const char *end = body + body_len;
+        while (true)
+        {
+            if (s.n_fields == NMEA0183_MAX_FIELDS) return false;
+            const char *next = (const char *)memchr(p, ',', end - p);
+            const char *field_end = next ? next : end;
+            s.fields[s.n_fields++] = std::string_view(p, field_end - p);
+            if (next == nullptr) break;
+            p = next + 1;
+        }
+    }
+    return true;
+}
+
+void NMEA0183Parser::on_line_read(const char *line)
+{
+    parse(line, strlen(line));
+}
+
+bool NMEA0183Parser::parse(const char *line, int len)
+{
+    stats.lines++;
+    NMEA0183Sentence s;
+    bool checksum_ok;
+    if (!split(line, len, s, checksum_ok))
+    {
+        stats.malformed++;
+        return false;
+    }
+    if (!checksum_ok)
+    {
+        stats.checksum_errors++;
+        return false;
+    }
+    if (!s.has_checksum)
+    {
+        stats.no_checksum++;
+        if (strict) return false;
+    }
+    stats.sentences++;
+    if (handler)
+    {
+        handler->on_sentence(s);
+        dispatch(s);
+    }
+    return true;
+}
+
+void NMEA0183Parser::dispatch(const NMEA0183Sentence &s)
+{
+    if (s.type.size() != 3 || s.talker == "P") return;
+    switch (NMEA0183_TYPE(s.type[0], s.type[1], s.type[2]))
+    {
+    case NMEA0183_TYPE('R', 'M', 'C'):
+    {
+        NMEA0183RMC rmc;
+        rmc.time = to_time(s.field(0));
+        rmc.valid = to_char(s.field(1)) == 'A';
+        rmc.latitude = to_latlon(s.field(2), s.field(3));
+        rmc.longitude = to_latlon(s.field(4), s.field(5));
+        rmc.sog = to_double(s.field(6));
+        rmc.cog = to_double(s.field(7));
+        std::string_view date = s.field(8);
+        rmc.day = rmc.month = rmc.year = -1;
+        if (date.size() == 6)
+        {
+            rmc.day = to_int(date.substr(0, 2));
+            rmc.month = to_int(date.substr(2, 2));
+            rmc.year = to_int(date.substr(4, 2));
+            if (rmc.year >= 0) rmc.year += (rmc.year < 80) ? 2000 : 1900;
+        }
+        rmc.variation = signed_by(to_double(s.field(9)), s.field(10), 'W');
+        stats.decoded++;
+        handler->on_rmc(rmc, s);
+        break;
+    }
+    case NMEA0183_TYPE('G', 'G', 'A'):
+    {
+        NMEA0183GGA gga;
+        gga.time = to_time(s.field(0));
+        gga.latitude = to_latlon(s.field(1), s.field(2));
+        gga.longitude = to_latlon(s.field(3), s.field(4));
+        gga.quality = to_int(s.field(5));
+        gga.satellites = to_int(s.field(6));
+        gga.hdop = to_double(s.field(7));
+        gga.altitude = to_double(s.field(8));
+        gga.geoid_separation = to_double(s.field(10));
+        stats.decoded++;
+        handler->on_gga(gga, s);
+        break;
+    }
+    case NMEA0183_TYPE('V', 'T', 'G'):
+    {
+        NMEA0183VTG vtg;
+        vtg.cog_true = to_double(s.field(0));
+        vtg.cog_magnetic = to_double(s.field(2));
+        vtg.sog_knots = to_double(s.field(4));
+        vtg.sog_kmh = to_double(s.field(6));
+        stats.decoded++;
+        handler->on_vtg(vtg, s);
+        break;
+    }
+    case NMEA0183_TYPE('H', 'D', 'G'):
+    {
+        NMEA0183HDG hdg;
+        hdg.heading = to_double(s.field(0));
+        hdg.deviation = signed_by(to_double(s.field(1)), s.field(2), 'W');
+        hdg.variation = signed_by(to_double(s.field(3)), s.field(4), 'W');
+        stats.decoded++;
+        handler->on_hdg(hdg, s);
+        break;
+    }
+    case NMEA0183_TYPE('M', 'W', 'V'):
+    {
+        NMEA0183MWV mwv;
+        mwv.angle = to_double(s.field(0));
+        mwv.true_wind = to_char(s.field(1)) == 'T';
+        mwv.speed = to_double(s.field(2));
+        mwv.unit = to_char(s.field(3));
+        mwv.valid = to_char(s.field(4)) == 'A';
+        stats.decoded++;
+        handler->on_mwv(mwv, s);
+        break;
+    }
+    case NMEA0183_TYPE('D', 'P', 'T'):
+    {
+        NMEA0183DPT dpt;
+        dpt.depth = to_double(s.field(0));
+        dpt.offset = to_double(s.field(1));
+        dpt.max_range = to_double(s.field(2));
+        stats.decoded++;
+        handler->on_dpt(dpt, s);
+        break;
+    }
+    case NMEA0183_TYPE('V', 'H', 'W'):
+    {
+        NMEA0183VHW vhw;
+        vhw.heading_true = to_double(s.field(0));
+        vhw.heading_magnetic = to_double(s.field(2));
+        vhw.speed_knots = to_double(s.field(4));
+        vhw.speed_kmh = to_double(s.field(6));
+        stats.decoded++;
+        handler->on_vhw(vhw, s);
+        break;
+    }
+    case NMEA0183_TYPE('X', 'D', 'R'):
+    {
+        // quadruplets of type, value, unit, name
+        NMEA0183XDR xdr;
+        xdr.n_measures = 0;
+        for (int i = 0; i + 2 < s.n_fields && xdr.n_measures < NMEA0183_MAX_XDR; i += 4)
+        {
+            NMEA0183XDRMeasure &m = xdr.measures[xdr.n_measures++];
+            m.type = to_char(s.field(i));
+            m.value = to_double(s.field(i + 1));
+            m.unit = to_char(s.field(i + 2));
+            m.name = s.field(i + 3);
+        }
+        stats.decoded++;
+        handler->on_xdr(xdr, s);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void NMEA0183Parser::dump()
+{
+    Log::tracex(NMEA0183_LOG_TAG, "Stats", "lines {%lu} sentences {%lu} decoded {%lu} checksum errors {%lu} no checksum {%lu} malformed {%lu}",
+        stats.lines, stats.sentences, stats.decoded, stats.checksum_errors, stats.no_checksum, stats.malformed);
+}
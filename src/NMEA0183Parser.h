@@ -0,0 +1,178 @@
+#ifndef _NMEA0183_PARSER_H
+#define _NMEA0183_PARSER_H
+
+#include "Ports.h"
+#include <string_view>
+
+#ifndef NMEA0183_MAX_FIELDS
+#define NMEA0183_MAX_FIELDS 40 // data fields after the address, XDR can carry many quadruplets
+#endif
+
+#ifndef NMEA0183_MAX_XDR
+#define NMEA0183_MAX_XDR 8 // measurements decoded from one XDR sentence
+#endif
+
+// A sentence split in place: all the views point into the line handed to parse(), so they are
+// valid only for the duration of the callback.
+struct NMEA0183Sentence
+{
+    char start;               // '$' or '!' (encapsulated)
+    std::string_view talker;  // "GP", "II"... or "P" for proprietary sentences
+    std::string_view type;    // "RMC", "GGA"... or the manufacturer + type for proprietary ones
+    std::string_view fields[NMEA0183_MAX_FIELDS];
+    int n_fields;
+    bool has_checksum;
+
+    // empty when the field is missing
+    std::string_view field(int i) const { return (i >= 0 && i < n_fields) ? fields[i] : std::string_view(); }
+};
+
+// Missing numeric fields are NAN (floating point) or -1 (integer).
+
+struct NMEA0183RMC
+{
+    double time;       // seconds since midnight UTC
+    bool valid;        // status 'A'
+    double latitude;   // degrees, negative south
+    double longitude;  // degrees, negative west
+    double sog;        // knots
+    double cog;        // degrees true
+    int day, month, year; // year with the century
+    double variation;  // degrees, negative west
+};
+
+struct NMEA0183GGA
+{
+    double time;
+    double latitude;
+    double longitude;
+    int quality;       // 0 invalid, 1 GPS, 2 DGPS...
+    int satellites;
+    double hdop;
+    double altitude;   // meters above MSL
+    double geoid_separation; // meters
+};
+
+struct NMEA0183VTG
+{
+    double cog_true;
+    double cog_magnetic;
+    double sog_knots;
+    double sog_kmh;
+};
+
+struct NMEA0183HDG
+{
+    double heading;    // magnetic sensor heading
+    double deviation;  // degrees, negative west
+    double variation;  // degrees, negative west
+};
+
+struct NMEA0183MWV
+{
+    double angle;      // degrees
+    bool true_wind;    // reference 'T' (otherwise relative)
+    double speed;      // in unit
+    char unit;         // 'N' knots, 'M' m/s, 'K' km/h
+    bool valid;        // status 'A'
+};
+
+struct NMEA0183DPT
+{
+    double depth;      // meters below the transducer
+    double offset;     // meters, positive to the waterline, negative to the keel
+    double max_range;
+};
+
+struct NMEA0183VHW
+{
+    double heading_true;
+    double heading_magnetic;
+    double speed_knots;
+    double speed_kmh;
+};
+
+struct NMEA0183XDRMeasure
+{
+    char type;         // 'C' temperature, 'P' pressure, 'A' angle...
+    double value;
+    char unit;
+    std::string_view name;
+};
+
+struct NMEA0183XDR
+{
+    NMEA0183XDRMeasure measures[NMEA0183_MAX_XDR];
+    int n_measures;
+};
+
+/**
+ * Sentence callbacks: override the ones of interest. on_sentence is called for every
+ * sentence that passed the checksum, before the typed callback if the type is decoded.
+ */
+class NMEA0183Handler
+{
+public:
+    virtual void on_sentence(const NMEA0183Sentence &s) {}
+    virtual void on_rmc(const NMEA0183RMC &rmc, const NMEA0183Sentence &s) {}
+    virtual void on_gga(const NMEA0183GGA &gga, const NMEA0183Sentence &s) {}
+    virtual void on_vtg(const NMEA0183VTG &vtg, const NMEA0183Sentence &s) {}
+    virtual void on_hdg(const NMEA0183HDG &hdg, const NMEA0183Sentence &s) {}
+    virtual void on_mwv(const NMEA0183MWV &mwv, const NMEA0183Sentence &s) {}
+    virtual void on_dpt(const NMEA0183DPT &dpt, const NMEA0183Sentence &s) {}
+    virtual void on_vhw(const NMEA0183VHW &vhw, const NMEA0183Sentence &s) {}
+    virtual void on_xdr(const NMEA0183XDR &xdr, const NMEA0183Sentence &s) {}
+};
+
+struct NMEA0183ParserStats
+{
+    unsigned long lines = 0;
+    unsigned long sentences = 0;       // passed to the handler
+    unsigned long decoded = 0;         // of a known type, dispatched to a typed callback
+    unsigned long checksum_errors = 0;
+    unsigned long no_checksum = 0;     // accepted without checksum (rejected in strict mode)
+    unsigned long malformed = 0;       // no start delimiter, bad address, too many fields
+};
+
+/**
+ * NMEA 0183 parser, to be set as the listener of a Port. Lines are validated and split
+ * without copying nor allocating: the fields are views into the line buffer, numbers are
+ * converted with a small locale-free parser.
+ */
+class NMEA0183Parser: public PortListener
+{
+public:
+    NMEA0183Parser(NMEA0183Handler *handler = nullptr);
+
+    void set_handler(NMEA0183Handler *h) { handler = h; }
+
+    // reject sentences without checksum (default: accept them)
+    void set_strict(bool s) { strict = s; }
+
+    virtual void on_line_read(const char *line);
+    virtual void on_line(const char *line, int len) { parse(line, len); }
+
+    // true if the line is a valid sentence (it is then dispatched to the handler)
+    bool parse(const char *line, int len);
+
+    NMEA0183ParserStats get_stats() const { return stats; }
+    void reset_stats() { stats = NMEA0183ParserStats(); }
+    void dump();
+
+    // helpers, also useful to handlers decoding other sentences
+    static bool split(const char *line, int len, NMEA0183Sentence &s, bool &checksum_ok);
+    static unsigned char checksum(const char *data, int len);
+    static double to_double(std::string_view f);  // NAN if empty or invalid
+    static int to_int(std::string_view f);        // -1 if empty or invalid
+    static double to_latlon(std::string_view value, std::string_view hemisphere); // [d]ddmm.mmm
+    static double to_time(std::string_view f);    // hhmmss[.ss] to seconds of the day
+
+private:
+    void dispatch(const NMEA0183Sentence &s);
+
+    NMEA0183Handler *handler;
+    bool strict;
+    NMEA0183ParserStats stats;
+};
+
+#endif // _NMEA0183_PARSER_H
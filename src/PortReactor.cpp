@@ -0,0 +1,227 @@
+#if defined(NATIVE) && defined(__linux__)
+#include "PortReactor.h"
+#include "N2K.h"
+#include "Log.h"
+#include "Utils.h"
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+#define PORT_REACTOR_LOG_TAG "REACTOR"
+#define PORT_REACTOR_CAN_ID 0xFFFF
+#define PORT_REACTOR_MAX_EVENTS 16
+
+PortReactor::PortReactor(): n2k(nullptr), next_tick(0), running(false)
+{
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) Log::tracex(PORT_REACTOR_LOG_TAG, "Error", "epoll {%s}", strerror(errno));
+}
+
+PortReactor::~PortReactor()
+{
+    if (epfd >= 0) ::close(epfd);
+}
+
+void PortReactor::watch(int fd, unsigned int id, bool out)
+{
+    // descriptors leave the set when closed, and a reopened port may get the same number back,
+    // so probe with MOD and add when the kernel does not know it
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    if (out) ev.events |= EPOLLOUT;
+    ev.data.u32 = id;
+    if (epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev) < 0 && errno == ENOENT)
+    {
+        epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+    }
+}
+
+bool PortReactor::add_port(LinuxPort *port)
+{
+    for (int i = 0; i < PORT_REACTOR_MAX_PORTS; i++)
+    {
+        if (ports[i].port == nullptr)
+        {
+            ports[i].port = port;
+            ports[i].was_open = false;
+            next_tick = _millis(); // open it at the next run
+            return true;
+        }
+    }
+    return false;
+}
+
+void PortReactor::remove_port(LinuxPort *port)
+{
+    for (int i = 0; i < PORT_REACTOR_MAX_PORTS; i++)
+    {
+        if (ports[i].port == port)
+        {
+            if (port->get_fd() >= 0) epoll_ctl(epfd, EPOLL_CTL_DEL, port->get_fd(), nullptr);
+            ports[i].port = nullptr;
+        }
+    }
+}
+
+void PortReactor::set_n2k(N2K *_n2k)
+{
+    n2k = _n2k;
+}
+
+int PortReactor::add_timer(unsigned long period_ms, port_reactor_timer handler, void *context)
+{
+    if (handler == nullptr || period_ms == 0) return -1;
+    for (int i = 0; i < PORT_REACTOR_MAX_TIMERS; i++)
+    {
+        timer_entry &t = timers[i];
+        if (t.handler == nullptr)
+        {
+            t.handler = handler;
+            t.context = context;
+            t.period = period_ms;
+            t.next = _millis() + period_ms;
+            return i;
+        }
+    }
+    return -1;
+}
+
+void PortReactor::remove_timer(int handle)
+{
+    if (handle >= 0 && handle < PORT_REACTOR_MAX_TIMERS) timers[handle].handler = nullptr;
+}
+
+void PortReactor::sync_port(int slot)
+{
+    port_entry &e = ports[slot];
+    int fd = e.port->get_fd();
+    if (fd >= 0)
+    {
+        if (!e.was_open)
+        {
+            e.was_open = true;
+            stats.opens++;
+        }
+        e.out = e.port->get_write_queued() > 0;
+        watch(fd, slot, e.out);
+    }
+    else
+    {
+        e.was_open = false;
+    }
+}
+
+void PortReactor::housekeeping(unsigned long now)
+{
+    for (int i = 0; i < PORT_REACTOR_MAX_PORTS; i++)
+    {
+        if (ports[i].port == nullptr) continue;
+        ports[i].port->maintain(now);
+        sync_port(i);
+    }
+    if (n2k)
+    {
+        n2k->loop(now);
+        int fd = n2k->get_can_fd();
+        if (fd >= 0) watch(fd, PORT_REACTOR_CAN_ID);
+    }
+    next_tick = now + PORT_REACTOR_TICK_MS;
+}
+
+void PortReactor::flush_writes()
+{
+    for (int i = 0; i < PORT_REACTOR_MAX_PORTS; i++)
+    {
+        port_entry &e = ports[i];
+        if (e.port == nullptr || !e.was_open) continue;
+        if (e.port->get_write_queued()) e.port->flush_write();
+        // EPOLLOUT only while something is left, or the wait would spin
+        if ((e.port->get_write_queued() > 0) != e.out) sync_port(i);
+    }
+}
+
+void PortReactor::run_timers(unsigned long now)
+{
+    for (int i = 0; i < PORT_REACTOR_MAX_TIMERS; i++)
+    {
+        timer_entry &t = timers[i];
+        if (t.handler == nullptr || (long)(now - t.next) < 0) continue;
+        // keep the cadence, without bursts after a long handler
+        t.next += t.period;
+        if ((long)(now - t.next) >= 0) t.next = now + t.period;
+        stats.timer_runs++;
+        t.handler(now, t.context);
+    }
+}
+
+int PortReactor::run_once(unsigned long max_wait_ms)
+{
+    unsigned long now = _millis();
+    if ((long)(now - next_tick) >= 0) housekeeping(now);
+    run_timers(now);
+    flush_writes();
+
+    // sleep until the next deadline
+    unsigned long wait = max_wait_ms;
+    unsigned long to_tick = next_tick - now;
+    if ((long)to_tick < 0) to_tick = 0;
+    if (to_tick < wait) wait = to_tick;
+    for (int i = 0; i < PORT_REACTOR_MAX_TIMERS; i++)
+    {
+        if (timers[i].handler == nullptr) continue;
+        long to_timer = (long)(timers[i].next - now);
+        if (to_timer < 0) to_timer = 0;
+        if ((unsigned long)to_timer < wait) wait = to_timer;
+    }
+
+    struct epoll_event events[PORT_REACTOR_MAX_EVENTS];
+    int n = epoll_wait(epfd, events, PORT_REACTOR_MAX_EVENTS, (int)wait);
+    stats.wakeups++;
+    if (n < 0)
+    {
+        if (errno != EINTR) Log::tracex(PORT_REACTOR_LOG_TAG, "Error", "epoll_wait {%s}", strerror(errno));
+        return 0;
+    }
+    for (int i = 0; i < n; i++)
+    {
+        unsigned int id = events[i].data.u32;
+        if (id == PORT_REACTOR_CAN_ID)
+        {
+            stats.can_events++;
+            if (n2k) n2k->loop(_millis());
+            continue;
+        }
+        if (id >= PORT_REACTOR_MAX_PORTS || ports[id].port == nullptr) continue;
+        stats.port_events++;
+        LinuxPort *port = ports[id].port;
+        bool ok = true;
+        if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) ok = port->read_available(PORT_REACTOR_READ_MS);
+        if (ok && (events[i].events & EPOLLOUT))
+        {
+            stats.write_events++;
+            port->flush_write();
+        }
+        if (ok && (events[i].events & (EPOLLERR | EPOLLHUP)))
+        {
+            // device gone (e.g. USB adapter unplugged), what was pending has been read:
+            // close and let housekeeping reopen it
+            Log::tracex(PORT_REACTOR_LOG_TAG, "Hangup", "fd {%d}", port->get_fd());
+            port->close();
+            stats.hangups++;
+        }
+        sync_port(id);
+    }
+    return n;
+}
+
+void PortReactor::run()
+{
+    running = true;
+    while (running)
+    {
+        run_once(PORT_REACTOR_TICK_MS);
+    }
+}
+#endif
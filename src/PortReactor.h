@@ -0,0 +1,107 @@
+#ifndef _PORT_REACTOR_H
+#define _PORT_REACTOR_H
+
+#if defined(NATIVE) && defined(__linux__)
+
+#include "LinuxPort.h"
+#include <atomic>
+
+#ifndef PORT_REACTOR_MAX_PORTS
+#define PORT_REACTOR_MAX_PORTS 16
+#endif
+
+#ifndef PORT_REACTOR_MAX_TIMERS
+#define PORT_REACTOR_MAX_TIMERS 16
+#endif
+
+// housekeeping period: port reopen attempts, speed changes and the N2K loop
+#ifndef PORT_REACTOR_TICK_MS
+#define PORT_REACTOR_TICK_MS 100
+#endif
+
+// max time spent reading one port per wakeup, so that a chatty port cannot starve the others
+#ifndef PORT_REACTOR_READ_MS
+#define PORT_REACTOR_READ_MS 10
+#endif
+
+class N2K;
+
+typedef void (*port_reactor_timer)(unsigned long now, void *context);
+
+struct PortReactorStats
+{
+    unsigned long wakeups = 0;
+    unsigned long port_events = 0;
+    unsigned long can_events = 0;
+    unsigned long timer_runs = 0;
+    unsigned long opens = 0;   // ports found open after being closed (first open included)
+    unsigned long hangups = 0; // ports closed on EPOLLERR/EPOLLHUP
+    unsigned long write_events = 0; // EPOLLOUT on a port with queued writes
+};
+
+/**
+ * Single-threaded event loop for many LinuxPorts and, optionally, the SocketCAN socket of an
+ * N2K instance: all the descriptors sit in one epoll set and run_once() sleeps until one of
+ * them is readable or a timer is due. Readable ports are drained into their line assembler;
+ * closed ports are reopened by the periodic housekeeping (Port::maintain), which also runs
+ * the N2K loop so that its timers and retries keep going when the bus is quiet.
+ * Ports with a write queue (Port::enable_write) are flushed before sleeping, and watched for
+ * EPOLLOUT while the device cannot take all the queued data.
+ */
+class PortReactor
+{
+public:
+    PortReactor();
+    ~PortReactor();
+
+    bool add_port(LinuxPort *port);
+    void remove_port(LinuxPort *port);
+
+    // N2K::loop runs on CAN traffic (SocketCAN backend) and at every housekeeping tick
+    void set_n2k(N2K *n2k);
+
+    // returns a handle for remove_timer, or -1 if PORT_REACTOR_MAX_TIMERS is reached
+    int add_timer(unsigned long period_ms, port_reactor_timer handler, void *context);
+    void remove_timer(int handle);
+
+    // waits up to max_wait_ms for events and dispatches them, returns the number of events
+    int run_once(unsigned long max_wait_ms);
+    // runs until stop(), which can be called from a handler or another thread
+    void run();
+    void stop() { running = false; }
+
+    PortReactorStats get_stats() const { return stats; }
+
+private:
+    struct port_entry
+    {
+        LinuxPort *port = nullptr;
+        bool was_open = false;
+        bool out = false; // watched for EPOLLOUT
+    };
+
+    struct timer_entry
+    {
+        port_reactor_timer handler = nullptr;
+        void *context = nullptr;
+        unsigned long period = 0;
+        unsigned long next = 0;
+    };
+
+    void housekeeping(unsigned long now);
+    void run_timers(unsigned long now);
+    void watch(int fd, unsigned int id, bool out = false);
+    void flush_writes();
+    void sync_port(int slot);
+
+    int epfd;
+    port_entry ports[PORT_REACTOR_MAX_PORTS];
+    timer_entry timers[PORT_REACTOR_MAX_TIMERS];
+    N2K *n2k;
+    unsigned long next_tick;
+    std::atomic<bool> running;
+    PortReactorStats stats;
+};
+
+#endif
+#endif // _PORT_REACTOR_H
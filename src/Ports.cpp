@@ -3,8 +3,11 @@
 #include "Utils.h"
 #include <string.h>
 
+static_assert((PORT_WRITE_BUFFER_SIZE & (PORT_WRITE_BUFFER_SIZE - 1)) == 0, "PORT_WRITE_BUFFER_SIZE must be a power of two");
+
 Port::Port(const char *name): bytes(0), listener(NULL), pos(0), last_speed(DEFAULT_PORT_SPEED), speed(DEFAULT_PORT_SPEED), last_open_try(0)
 {
+	stats_start = _millis();
 	// bounded copy to avoid overflow
 	strncpy(port_name, name, sizeof(port_name) - 1);
 	port_name[sizeof(port_name) - 1] = '\0';
@@ -12,6 +15,10 @@ Port::Port(const char *name): bytes(0), listener(NULL), pos(0), last_speed(DEFAU
 
 Port::~Port()
 {
+#ifdef NATIVE
+	stop_capture();
+#endif
+	delete[] write_ring;
 }
 
 void Port::set_handler(PortListener* l)
@@ -27,6 +34,7 @@ int Port::process_char(char c)
 		read_buffer[pos] = c;
 		pos++;
 		pos %= PORT_BUFFER_SIZE; // avoid buffer overrun
+		if (pos == 0) overruns++;
 		read_buffer[pos] = 0;
 		if (listener)
 		{
@@ -36,6 +44,7 @@ int Port::process_char(char c)
 	}
 	else if (pos != 0)
 	{
+		count_line(read_buffer, pos);
 		if (listener)
 		{
 			//Serial.printf("%s\n", read_buffer);
@@ -51,6 +60,94 @@ int Port::process_char(char c)
 	return res;
 }
 
+static int hex_digit(char c)
+{
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	return -1;
+}
+
+void Port::count_line(const char* line, int len)
+{
+	lines++;
+	if ((unsigned int)len > max_line) max_line = len;
+	if (checksum_check && len > 4 && (line[0] == '$' || line[0] == '!') && line[len - 3] == '*')
+	{
+		unsigned char c = 0;
+		for (int i = 1; i < len - 3; i++) c ^= (unsigned char)line[i];
+		int hi = hex_digit(line[len - 2]);
+		int lo = hex_digit(line[len - 1]);
+		if (hi < 0 || lo < 0 || c != ((hi << 4) | lo)) checksum_errors++;
+		else checksum_valid++;
+	}
+}
+
+void Port::deliver(char* line, int len)
+{
+	count_line(line, len);
+	if (listener)
+	{
+		listener->on_line(line, len);
+	}
+	if (trace) {
+		Log::tracex("PORT", "Read", "buffer {%s}", line);
+	}
+}
+
+void Port::process_block(char* block, int len)
+{
+	char* p = block;
+	char* end = block + len;
+	// next CR and LF, each scanned once per block
+	char* cr = (char*)memchr(p, 13, len);
+	char* lf = (char*)memchr(p, 10, len);
+	while (p < end)
+	{
+		if (cr && cr < p) cr = (char*)memchr(p, 13, end - p);
+		if (lf && lf < p) lf = (char*)memchr(p, 10, end - p);
+		char* eol = (cr && (!lf || cr < lf)) ? cr : lf;
+		int n = (eol ? eol : end) - p;
+		if (discarding)
+		{
+			if (eol) discarding = false;
+		}
+		else if (pos + n > PORT_BUFFER_SIZE - 1)
+		{
+			overruns++;
+			pos = 0;
+			discarding = (eol == nullptr);
+		}
+		else if (eol && pos == 0)
+		{
+			// the whole line is in the block: terminate it in place
+			if (n)
+			{
+				*eol = 0;
+				deliver(p, n);
+			}
+		}
+		else
+		{
+			memcpy(read_buffer + pos, p, n);
+			pos += n;
+			read_buffer[pos] = 0;
+			if (eol)
+			{
+				if (pos) deliver(read_buffer, pos);
+				pos = 0;
+				read_buffer[0] = 0;
+			}
+			else if (listener && pos && listener->want_partials())
+			{
+				listener->on_partial_x(read_buffer, pos);
+				listener->on_partial(read_buffer);
+			}
+		}
+		p = eol ? eol + 1 : end;
+	}
+}
+
 void Port::close()
 {
 	//Serial.println("Closing port");
@@ -62,13 +159,236 @@ int Port::open()
 	//Serial.println("Opening port");
 	last_speed = speed;
 	_open();
+	if (is_open()) opens++;
 	return is_open();
 }
 
 void Port::listen(uint ms)
 {
-	unsigned long t0 = _millis();
+	unsigned long t0 = _micros();
+	maintain(_millis());
+	read_available(ms);
+	if (write_in != write_out) flush_write();
+	unsigned long us = _micros() - t0;
+	listen_calls++;
+	listen_us += us;
+	if (us > listen_max_us) listen_max_us = us;
+}
+
+PortStats Port::get_stats()
+{
+	PortStats s;
+	strncpy(s.name, port_name, sizeof(s.name));
+	s.name[sizeof(s.name) - 1] = 0;
+	s.period_ms = _millis() - stats_start;
+	s.bytes = bytes;
+	s.lines = lines;
+	if (s.period_ms)
+	{
+		s.bytes_per_sec = bytes * 1000.0f / s.period_ms;
+		s.lines_per_sec = lines * 1000.0f / s.period_ms;
+	}
+	s.max_line = max_line;
+	s.overruns = overruns;
+	s.opens = opens;
+	s.listen_calls = listen_calls;
+	s.listen_us = listen_us;
+	s.listen_max_us = listen_max_us;
+	s.checksum_enabled = checksum_check;
+	s.checksum_errors = checksum_errors;
+	s.checksum_valid = checksum_valid;
+	s.write_enabled = write_ring != nullptr;
+	s.write_queued = write_in - write_out;
+	s.write_bytes = write_bytes;
+	s.write_dropped = write_dropped;
+	s.write_errors = write_errors;
+	s.write_latency_max_us = write_latency_max_us;
+	s.write_latency_avg_us = write_latency_n ? write_latency_total_us / write_latency_n : 0;
+	return s;
+}
+
+void Port::reset_stats()
+{
+	stats_start = _millis();
+	bytes = 0;
+	lines = 0;
+	max_line = 0;
+	overruns = 0;
+	opens = 0;
+	listen_calls = 0;
+	listen_us = 0;
+	listen_max_us = 0;
+	checksum_errors = 0;
+	checksum_valid = 0;
+	write_bytes = 0;
+	write_dropped = 0;
+	write_errors = 0;
+	write_latency_n = 0;
+	write_latency_total_us = 0;
+	write_latency_max_us = 0;
+}
+
+void Port::capture(const char* data, int len)
+{
+#ifdef NATIVE
+	if (capture_file)
+	{
+		uint64_t t = _micros() - capture_start;
+		uint16_t l = len;
+		fwrite(&t, sizeof(t), 1, capture_file);
+		fwrite(&l, sizeof(l), 1, capture_file);
+		fwrite(data, 1, len, capture_file);
+	}
+#endif
+}
+
+#ifdef NATIVE
+bool Port::start_capture(const char* path)
+{
+	stop_capture();
+	capture_file = fopen(path, "wb");
+	if (capture_file == nullptr)
+	{
+		Log::tracex("PORT", "Capture error", "name {%s} file {%s}", port_name, path);
+		return false;
+	}
+	fwrite(PORT_CAPTURE_MAGIC, 1, PORT_CAPTURE_MAGIC_LEN, capture_file);
+	capture_start = _micros();
+	Log::tracex("PORT", "Capture", "name {%s} file {%s}", port_name, path);
+	return true;
+}
+
+void Port::stop_capture()
+{
+	if (capture_file)
+	{
+		fclose(capture_file);
+		capture_file = nullptr;
+	}
+}
+#endif
+
+void PortStats::dump()
+{
+	Log::tracex("PORT", "Stats", "name {%s} bytes {%lu} {%.1f/s} lines {%lu} {%.1f/s} max line {%u} overruns {%lu} dropped {%lu} opens {%lu}",
+		name, bytes, bytes_per_sec, lines, lines_per_sec, max_line, overruns, dropped, opens);
+	Log::tracex("PORT", "Stats", "name {%s} listen calls {%lu} avg {%luus} max {%luus}",
+		name, listen_calls, listen_calls ? listen_us / listen_calls : 0UL, listen_max_us);
+	if (checksum_enabled) Log::tracex("PORT", "Stats", "name {%s} checksum errors {%lu} valid {%lu}", name, checksum_errors, checksum_valid);
+	if (write_enabled) Log::tracex("PORT", "Stats", "name {%s} written {%lu} queued {%lu} dropped {%lu} errors {%lu} latency avg {%luus} max {%luus}",
+		name, write_bytes, write_queued, write_dropped, write_errors, write_latency_avg_us, write_latency_max_us);
+}
+
+void Port::enable_write(PortWritePolicy policy)
+{
+	write_policy = policy;
+	if (write_ring == nullptr) write_ring = new char[PORT_WRITE_BUFFER_SIZE];
+}
+
+bool Port::write(const char* s)
+{
+	return write(s, strlen(s));
+}
+
+bool Port::write(const char* data, int len)
+{
+	if (write_ring == nullptr || len < 0) return false;
+	unsigned long room = PORT_WRITE_BUFFER_SIZE - (write_in - write_out);
+	if ((unsigned long)len > room)
+	{
+		if (write_policy == PORT_WRITE_DROP_NEW || len > PORT_WRITE_BUFFER_SIZE)
+		{
+			write_dropped += len;
+			return false;
+		}
+		drop_oldest(len - room);
+	}
+	unsigned int off = write_in & (PORT_WRITE_BUFFER_SIZE - 1);
+	unsigned int first = PORT_WRITE_BUFFER_SIZE - off;
+	if (first > (unsigned int)len) first = len;
+	memcpy(write_ring + off, data, first);
+	memcpy(write_ring, data + first, len - first);
+	write_in += len;
+	// when all the marks are taken the write is not sampled
+	if (len && marks_count < PORT_WRITE_MARKS)
+	{
+		write_mark &m = write_marks[(marks_head + marks_count) % PORT_WRITE_MARKS];
+		m.end = write_in;
+		m.time_us = _micros();
+		marks_count++;
+	}
+	return true;
+}
+
+void Port::drop_oldest(unsigned long need)
+{
+	// whole lines, so that the receiver does not get a new sentence glued to half an old one
+	// (the rest of a line already partially written is lost anyway)
+	unsigned long n = 0;
+	while (write_out + n != write_in && (n < need || write_ring[(write_out + n - 1) & (PORT_WRITE_BUFFER_SIZE - 1)] != 10))
+	{
+		n++;
+	}
+	write_out += n;
+	write_dropped += n;
+	settle_marks(false);
+}
+
+void Port::settle_marks(bool sample)
+{
+	while (marks_count && (long)(write_out - write_marks[marks_head].end) >= 0)
+	{
+		if (sample)
+		{
+			unsigned long us = _micros() - write_marks[marks_head].time_us;
+			write_latency_n++;
+			write_latency_total_us += us;
+			if (us > write_latency_max_us) write_latency_max_us = us;
+		}
+		marks_head = (marks_head + 1) % PORT_WRITE_MARKS;
+		marks_count--;
+	}
+}
 
+int Port::flush_write()
+{
+	if (write_ring == nullptr || !is_open()) return 0;
+	int total = 0;
+	while (write_out != write_in)
+	{
+		unsigned int off = write_out & (PORT_WRITE_BUFFER_SIZE - 1);
+		unsigned long n = write_in - write_out;
+		if (n > PORT_WRITE_BUFFER_SIZE - off) n = PORT_WRITE_BUFFER_SIZE - off;
+		bool error = false;
+		int w = _write(write_ring + off, n, error);
+		if (error)
+		{
+			// the queue is discarded, a dead device is closed by the read path
+			Log::tracex("PORT", "Write error", "name {%s} dropped {%lu}", port_name, write_in - write_out);
+			write_errors++;
+			write_dropped += write_in - write_out;
+			write_out = write_in;
+			settle_marks(false);
+			break;
+		}
+		if (w <= 0) break;
+		write_out += w;
+		write_bytes += w;
+		total += w;
+		settle_marks(true);
+		if ((unsigned long)w < n) break;
+	}
+	return total;
+}
+
+int Port::_write(const char* data, int len, bool &error)
+{
+	error = true;
+	return 0;
+}
+
+void Port::maintain(unsigned long t0)
+{
 	if (last_speed != speed && is_open())
 	{
 		Log::tracex("PORT", "Resetting speed", "name {%s} new speed {%d} old speed {%d}", port_name, speed, last_speed);
@@ -80,33 +400,51 @@ void Port::listen(uint ms)
 	{
 		open();
 	}
+}
+
+bool Port::read_available(uint ms)
+{
+	unsigned long t0 = _millis();
 
 	if (!is_open())
 	{
 		//Serial.println("Port is closed");
-		return;
+		return false;
 	}
 
+	char block[PORT_READ_BLOCK_SIZE];
 	while ((_millis() - t0) < ms)
 	{
 		bool error = false;
 		bool nothing_to_read = false;
-		char c = (char)_read(nothing_to_read, error);
-		if (!nothing_to_read && !error)
+		int n = _read_block(block, PORT_READ_BLOCK_SIZE, nothing_to_read, error);
+		bytes += n;
+		if (n > 0) capture(block, n);
+		if (line_framing) process_block(block, n);
+		else for (int i = 0; i < n; i++) process_char(block[i]);
+		if (error)
 		{
-			bytes++;
-			process_char(c);
+			//Log::tracex("PORT", "Err reading", "{%d} {%s}\n", errno, strerror(errno));
+			close();
+			return false;
 		}
 		else if (nothing_to_read)
 		{
 			// nothing to read
-			return;
-		}
-		else
-		{
-			//Log::tracex("PORT", "Err reading", "{%d} {%s}\n", errno, strerror(errno));
-			close();
-			return;
+			return true;
 		}
 	}
+	return true;
+}
+
+int Port::_read_block(char* buf, int len, bool &nothing_to_read, bool &error)
+{
+	int n = 0;
+	while (n < len)
+	{
+		int c = _read(nothing_to_read, error);
+		if (nothing_to_read || error) break;
+		buf[n++] = (char)c;
+	}
+	return n;
 }
@@ -9,18 +9,79 @@
 #define PORTS_H_
 
 #include <stdlib.h>
+#ifdef NATIVE
+#include <stdio.h>
+#endif
 
 #define PORT_BUFFER_SIZE 1024
 #define DEFAULT_PORT_SPEED 38400
 
+// capture file: magic, then one record per read: uint64 us since the start, uint16 length,
+// data (host byte order)
+#define PORT_CAPTURE_MAGIC "PORTCAP1"
+#define PORT_CAPTURE_MAGIC_LEN 8
+
+#ifndef PORT_READ_BLOCK_SIZE
+#define PORT_READ_BLOCK_SIZE 256 // max bytes fetched by a single _read_block
+#endif
+
+#ifndef PORT_WRITE_BUFFER_SIZE
+#define PORT_WRITE_BUFFER_SIZE 1024 // write queue ring, must be a power of two
+#endif
+
+#ifndef PORT_WRITE_MARKS
+#define PORT_WRITE_MARKS 16 // queued writes tracked for the flush latency
+#endif
+
+enum PortWritePolicy
+{
+	PORT_WRITE_DROP_NEW,   // a write that does not fit is rejected
+	PORT_WRITE_DROP_OLDEST // the oldest queued lines are dropped to make room
+};
+
 class PrivatePort;
 
+class PortStats
+{
+public:
+	char name[16];
+	unsigned long period_ms = 0;   // since the last reset
+	unsigned long bytes = 0;
+	unsigned long lines = 0;
+	float bytes_per_sec = 0;
+	float lines_per_sec = 0;
+	unsigned int max_line = 0;     // longest line delivered, without terminator
+	unsigned long overruns = 0;    // lines longer than the buffer (wrapped or dropped)
+	unsigned long dropped = 0;     // complete lines lost in a queue (LinuxPort reader thread)
+	unsigned long opens = 0;       // successful opens, the first one included
+	unsigned long listen_calls = 0;
+	unsigned long listen_us = 0;   // total time spent in listen()
+	unsigned long listen_max_us = 0;
+	bool checksum_enabled = false;
+	unsigned long checksum_errors = 0; // NMEA sentences with a wrong checksum, when enabled
+	unsigned long checksum_valid = 0;  // and with a good one
+	bool write_enabled = false;
+	unsigned long write_queued = 0;    // bytes waiting in the write queue
+	unsigned long write_bytes = 0;     // written to the device
+	unsigned long write_dropped = 0;   // bytes dropped by the policy or on a write error
+	unsigned long write_errors = 0;
+	unsigned long write_latency_max_us = 0; // from write() to the last byte handed to the device
+	unsigned long write_latency_avg_us = 0;
+	void dump();
+};
+
 class PortListener
 {
 public:
 	virtual void on_line_read(const char* line) {}
 	virtual void on_partial(const char* line) {}
 	virtual void on_partial_x(const char* line, int len) {}
+
+	// line framing only (see Port::set_line_framing): a complete line, without terminator
+	// and NUL terminated; the default forwards to on_line_read
+	virtual void on_line(const char* line, int len) { on_line_read(line); }
+	// line framing only: true to get on_partial/on_partial_x, once per read block
+	virtual bool want_partials() { return false; }
 };
 
 class Port {
@@ -29,6 +90,12 @@ public:
 	virtual ~Port();
 
 	void listen(unsigned int ms);
+
+	// the two halves of listen, for callers that wait for data on their own (see PortReactor):
+	// apply a speed change and retry opening (at most once a second)
+	virtual void maintain(unsigned long now);
+	// read and process what is available, for up to ms; false if the port is closed
+	virtual bool read_available(unsigned int ms);
 	void close();
 	int open();
 	bool is_open() { return _is_open(); }
@@ -38,6 +105,40 @@ public:
 	void debug(bool dbg=true) { trace = dbg; }
 
 	void set_speed(unsigned int requested_speed) { speed = requested_speed; }
+	unsigned int get_speed() { return speed; }
+
+	// Line framing: read blocks are scanned for CR/LF and only complete lines are delivered
+	// (on_line), partials only to the listeners asking for them. Lines longer than
+	// PORT_BUFFER_SIZE - 1 are dropped and counted as overruns.
+	// Default: the listener is called for each char, overlong lines wrap around.
+	void set_line_framing(bool enable = true) { line_framing = enable; }
+
+	unsigned long get_overruns() { return overruns; }
+
+	// counts the NMEA sentences ($ or !) whose checksum does not match; lines are delivered anyway
+	void set_checksum_check(bool enable = true) { checksum_check = enable; }
+
+	virtual PortStats get_stats();
+	virtual void reset_stats();
+
+	// Enables the write queue: write() copies into a ring of PORT_WRITE_BUFFER_SIZE bytes and
+	// returns immediately, the queue is flushed without blocking by listen() (or flush_write)
+	// as the device accepts data. Data queued while the port is closed waits for the reopen.
+	virtual void enable_write(PortWritePolicy policy = PORT_WRITE_DROP_NEW);
+	bool is_write_enabled() { return write_ring != nullptr; }
+	// false if the data was dropped (write not enabled, policy, longer than the ring)
+	bool write(const char* data, int len);
+	bool write(const char* s);
+	// writes what the device accepts now, returns the bytes written
+	int flush_write();
+	unsigned long get_write_queued() { return write_in - write_out; }
+
+#ifdef NATIVE
+	// records the raw reads of listen()/read_available (not those of a LinuxPort reader
+	// thread) with their timestamps, to be played back by ReplayPort
+	bool start_capture(const char* path);
+	void stop_capture();
+#endif
 
 protected:
 	Port(const char* name);
@@ -45,7 +146,16 @@ protected:
 	virtual void _open() = 0;
 	virtual void _close() = 0;
 	virtual int _read(bool &nothing_to_read, bool &error) = 0;
+	// Reads up to len bytes, returns how many. nothing_to_read/error tell why it stopped
+	// short, if it did. The default falls back to _read, one byte at a time.
+	virtual int _read_block(char* buf, int len, bool &nothing_to_read, bool &error);
 	virtual bool _is_open() = 0;
+	// Writes up to len bytes without blocking, returns how many (0 if the device is busy).
+	// The default is a read-only port: error.
+	virtual int _write(const char* data, int len, bool &error);
+
+	// hands a complete, NUL terminated line to the listener
+	void deliver(char* line, int len);
 
 	unsigned int speed;
 
@@ -54,12 +164,58 @@ protected:
 private:
 
 	int process_char(char c);
+	void process_block(char* block, int len);
+	void count_line(const char* line, int len);
+	void capture(const char* data, int len);
+	void drop_oldest(unsigned long need);
+	void settle_marks(bool sample);
 
 	char read_buffer[PORT_BUFFER_SIZE];
 	unsigned int pos;
 
 	bool trace = false;
 
+	bool line_framing = false;
+	bool discarding = false; // skipping the rest of an overlong line
+	unsigned long overruns = 0;
+
+	bool checksum_check = false;
+	unsigned long checksum_errors = 0;
+	unsigned long checksum_valid = 0;
+	unsigned long lines = 0;
+	unsigned int max_line = 0;
+	unsigned long opens = 0;
+	unsigned long listen_calls = 0;
+	unsigned long listen_us = 0;
+	unsigned long listen_max_us = 0;
+	unsigned long stats_start = 0;
+
+#ifdef NATIVE
+	FILE* capture_file = nullptr;
+	unsigned long capture_start = 0;
+#endif
+
+	struct write_mark
+	{
+		unsigned long end; // write_in after the write
+		unsigned long time_us;
+	};
+
+	// the ring positions are free running counters, masked on access
+	char* write_ring = nullptr;
+	PortWritePolicy write_policy = PORT_WRITE_DROP_NEW;
+	unsigned long write_in = 0;  // bytes ever queued
+	unsigned long write_out = 0; // bytes ever written or dropped
+	write_mark write_marks[PORT_WRITE_MARKS];
+	unsigned int marks_head = 0;
+	unsigned int marks_count = 0;
+	unsigned long write_bytes = 0;
+	unsigned long write_dropped = 0;
+	unsigned long write_errors = 0;
+	unsigned long write_latency_n = 0;
+	unsigned long write_latency_total_us = 0;
+	unsigned long write_latency_max_us = 0;
+
 	PortListener* listener;
 
 	unsigned long bytes;
@@ -0,0 +1,142 @@
+#ifndef REPLAY_PORT_H
+#define REPLAY_PORT_H
+
+#ifdef NATIVE
+
+#include "Ports.h"
+#include "Log.h"
+#include "Utils.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Plays back a capture made with Port::start_capture through the normal listen() and
+ * listener path, with the timing of the original reads (the reads already due are returned
+ * together, up to the block size).
+ * speed is a multiplier of the recorded timing: 1 is real time, 0 is as fast as possible.
+ * The port stays open at the end of the capture, with nothing more to read.
+ */
+class ReplayPort : public Port
+{
+public:
+    ReplayPort(const char* path, double _speed = 1.0)
+        : Port("REPLAY"),
+          file(nullptr),
+          replay_speed(_speed),
+          start_us(0),
+          record_time(0),
+          record_len(0),
+          record_pos(0),
+          has_record(false),
+          finished(false),
+          replayed(0)
+    {
+        strncpy(capture_path, path, sizeof(capture_path) - 1);
+        capture_path[sizeof(capture_path) - 1] = '\0';
+    }
+
+    virtual ~ReplayPort()
+    {
+        if (file) fclose(file);
+    }
+
+    void set_replay_speed(double s) { replay_speed = s; }
+
+    bool is_finished() const { return finished; }
+    unsigned long get_replayed_bytes() const { return replayed; }
+
+    // public for test purposes
+    virtual bool _is_open() override
+    {
+        return file != nullptr;
+    }
+
+protected:
+    virtual void _open() override
+    {
+        if (file) return;
+        file = fopen(capture_path, "rb");
+        char magic[PORT_CAPTURE_MAGIC_LEN];
+        if (file == nullptr || fread(magic, 1, PORT_CAPTURE_MAGIC_LEN, file) != PORT_CAPTURE_MAGIC_LEN ||
+            memcmp(magic, PORT_CAPTURE_MAGIC, PORT_CAPTURE_MAGIC_LEN) != 0)
+        {
+            Log::tracex("PORT", "Replay error", "file {%s}", capture_path);
+            if (file) fclose(file);
+            file = nullptr;
+            return;
+        }
+        start_us = _micros();
+        has_record = false;
+        finished = false;
+    }
+
+    virtual void _close() override
+    {
+        if (file) fclose(file);
+        file = nullptr;
+    }
+
+    virtual int _read(bool &nothing_to_read, bool &error) override
+    {
+        char c;
+        if (_read_block(&c, 1, nothing_to_read, error) != 1) return -1;
+        return (unsigned char)c;
+    }
+
+    // the recorded reads that are due, up to len bytes
+    virtual int _read_block(char* buf, int len, bool &nothing_to_read, bool &error) override
+    {
+        error = false;
+        int total = 0;
+        while (file && total < len)
+        {
+            if (!has_record && !next_record()) break;
+            if (replay_speed > 0 && (double)(_micros() - start_us) * replay_speed < (double)record_time) break;
+            int n = record_len - record_pos;
+            if (n > len - total) n = len - total;
+            memcpy(buf + total, record + record_pos, n);
+            record_pos += n;
+            total += n;
+            if (record_pos == record_len) has_record = false;
+        }
+        replayed += total;
+        nothing_to_read = total < len;
+        return total;
+    }
+
+private:
+    bool next_record()
+    {
+        uint64_t t;
+        uint16_t l;
+        // a longer record comes from a build with a larger block size: stop there
+        if (fread(&t, sizeof(t), 1, file) != 1 || fread(&l, sizeof(l), 1, file) != 1 ||
+            l > sizeof(record) || fread(record, 1, l, file) != l)
+        {
+            finished = true;
+            return false;
+        }
+        record_time = t;
+        record_len = l;
+        record_pos = 0;
+        has_record = true;
+        return true;
+    }
+
+    char capture_path[128];
+    FILE* file;
+    double replay_speed;
+    unsigned long start_us;
+    uint64_t record_time;
+    int record_len;
+    int record_pos;
+    bool has_record;
+    bool finished;
+    unsigned long replayed;
+    char record[PORT_READ_BLOCK_SIZE]; // the largest read Port::capture records
+};
+
+#endif // NATIVE
+
+#endif // REPLAY_PORT_H
@@ -0,0 +1,72 @@
+#ifndef _SPSC_QUEUE_H
+#define _SPSC_QUEUE_H
+
+#include <atomic>
+#include <stddef.h>
+
+/**
+ * Bounded single-producer/single-consumer ring over a preallocated slot pool.
+ * Slots are filled and consumed in place (acquire_write/commit_write on the producer
+ * side, front/pop on the consumer side), so the queue itself never copies or allocates.
+ * N must be a power of two.
+ */
+template <typename T, size_t N> class SPSCQueue
+{
+    static_assert(N > 0 && (N & (N - 1)) == 0, "SPSCQueue size must be a power of two");
+
+public:
+    SPSCQueue(): head(0), tail(0) {}
+
+    // producer side: returns the next free slot or nullptr if the queue is full
+    T* acquire_write()
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) >= N) return nullptr;
+        return &slots[t & (N - 1)];
+    }
+
+    // producer side: publishes the slot returned by acquire_write
+    void commit_write()
+    {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool push(const T& t)
+    {
+        T* s = acquire_write();
+        if (s == nullptr) return false;
+        *s = t;
+        commit_write();
+        return true;
+    }
+
+    // consumer side: returns the oldest slot or nullptr if the queue is empty
+    T* front()
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return nullptr;
+        return &slots[h & (N - 1)];
+    }
+
+    // consumer side: releases the slot returned by front
+    void pop()
+    {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    size_t size() const
+    {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+    bool empty() const { return size() == 0; }
+
+    size_t capacity() const { return N; }
+
+private:
+    T slots[N];
+    std::atomic<size_t> head; // next slot to read
+    std::atomic<size_t> tail; // next slot to write
+};
+
+#endif // _SPSC_QUEUE_H
@@ -82,6 +82,17 @@ ulong _millis(void)
   #endif
 }
 
+ulong _micros(void)
+{
+  #ifdef NATIVE
+  struct timespec spec;
+  clock_gettime(CLOCK_MONOTONIC, &spec);
+  return (ulong)spec.tv_sec * 1000000UL + spec.tv_nsec / 1000;
+  #else
+  return micros();
+  #endif
+}
+
 int msleep(long msec)
 {
     #ifdef NATIVE
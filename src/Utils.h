@@ -6,6 +6,7 @@
 #include <cstring>
 #include <stdint.h>
 #include <stdio.h>
+#include <atomic>
 
 class N2KSid
 {
@@ -174,7 +175,24 @@ bool array_contains(T test, T *int_set, int sz)
     return false;
 }
 
+// counters with a single writer: a relaxed load+store is enough and stays lock-free on cores without atomic RMW
+template <typename T>
+inline void relaxed_inc(std::atomic<T> &c, typename std::atomic<T>::value_type v = 1)
+{
+    c.store(c.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+}
+
+template <typename T>
+inline void relaxed_max(std::atomic<T> &c, typename std::atomic<T>::value_type v)
+{
+    if (v > c.load(std::memory_order_relaxed)) c.store(v, std::memory_order_relaxed);
+}
+
+// floor(log2(n)), e.g. the bits of a power of two table index
+constexpr int log2i(unsigned int n) { return n > 1 ? 1 + log2i(n >> 1) : 0; }
+
 ulong _millis();
+ulong _micros();
 int msleep(long msec);
 unsigned long get_free_mem();
 unsigned long check_elapsed(ulong time, ulong &last_time, ulong period);
@@ -0,0 +1,33 @@
+#ifndef _N2K_TEST_HELPERS_H
+#define _N2K_TEST_HELPERS_H
+
+// helpers shared by the N2K tests
+
+#include <N2kMsg.h>
+#include <unity.h>
+#ifdef NATIVE
+#include "N2K.h"
+#include "N2KVirtualBus.h"
+#endif
+
+// a single frame message: 8 data bytes set to fill, or to 0..7 when fill is negative
+inline tN2kMsg make_msg(unsigned long pgn, unsigned char source = 22, unsigned char priority = 2, int fill = -1)
+{
+    tN2kMsg m(source, priority, pgn);
+    for (int i = 0; i < 8; i++) m.AddByte(fill < 0 ? i : fill);
+    return m;
+}
+
+#ifdef NATIVE
+// attaches n2k to bus and opens it with a loop at time
+inline void start_on_bus(N2K &n2k, N2KVirtualBus &bus, unsigned long time)
+{
+    n2k_device_info dvc;
+    n2k.set_virtual_bus(&bus);
+    n2k.setup(dvc);
+    n2k.loop(time);
+    TEST_ASSERT_TRUE(n2k.is_bus_connected());
+}
+#endif
+
+#endif // _N2K_TEST_HELPERS_H
@@ -0,0 +1,190 @@
+#include "LinuxPort.h"
+#include "LinuxPortBaud.h"
+#include "Utils.h"
+#include <unity.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pty.h>
+#include <sys/stat.h>
+
+#define FIFO_PATH "/tmp/test_port_baud.fifo"
+
+static const char *SENTENCE = "$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6A\r\n";
+// what a wrong rate reads: noise, seldom a sentence
+static char garbage[80];
+
+static const char *noise()
+{
+    static uint32_t x = 12345;
+    for (size_t i = 0; i < sizeof(garbage) - 1; i++)
+    {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        garbage[i] = (char)(x & 0xFF) ? (char)(x & 0xFF) : 1;
+    }
+    garbage[sizeof(garbage) - 1] = 0;
+    return garbage;
+}
+
+static int master = -1;
+static char slave_name[32];
+
+static void open_pty()
+{
+    int slave;
+    TEST_ASSERT_EQUAL(0, openpty(&master, &slave, slave_name, nullptr, nullptr));
+    close(slave);
+}
+
+void setUp()
+{
+    unlink(FIFO_PATH);
+    mkfifo(FIFO_PATH, 0600);
+}
+
+void tearDown()
+{
+    unlink(FIFO_PATH);
+    if (master >= 0) close(master);
+    master = -1;
+}
+
+static void open_at(LinuxPort &port, unsigned int speed)
+{
+    port.set_speed(speed);
+    port.listen(1);
+    TEST_ASSERT_TRUE(port.is_open());
+}
+
+void test_high_standard_speed() {
+    open_pty();
+    LinuxPort port(slave_name);
+    open_at(port, 921600);
+    // the master side sees the slave settings
+    TEST_ASSERT_EQUAL(921600, linux_port_get_speed(master));
+    port.close();
+}
+
+void test_custom_speed() {
+    open_pty();
+    LinuxPort port(slave_name);
+    open_at(port, 250000);
+    TEST_ASSERT_EQUAL(250000, linux_port_get_speed(master));
+    TEST_ASSERT_EQUAL(250000, port.get_speed());
+    port.close();
+}
+
+void test_speed_change_reopens() {
+    open_pty();
+    LinuxPort port(slave_name);
+    open_at(port, 4800);
+    TEST_ASSERT_EQUAL(4800, linux_port_get_speed(master));
+    port.set_speed(460800);
+    // the port is reopened at the next open attempt
+    unsigned long t0 = _millis();
+    while (linux_port_get_speed(master) != 460800 && (_millis() - t0) < 1500)
+    {
+        port.listen(1);
+        usleep(10000);
+    }
+    TEST_ASSERT_EQUAL(460800, linux_port_get_speed(master));
+    port.close();
+}
+
+void test_auto_baud_locks_on_valid_checksums() {
+    // the "device" talks at 115200: any other rate reads garbage
+    int w = open(FIFO_PATH, O_RDWR | O_NONBLOCK);
+    TEST_ASSERT_TRUE(w > 0);
+    LinuxPort port(FIFO_PATH);
+    unsigned int rates[] = {4800, 38400, 115200, 230400};
+    port.enable_auto_baud(rates, 4);
+    TEST_ASSERT_EQUAL(4800, port.get_speed());
+    TEST_ASSERT_FALSE(port.is_baud_locked());
+
+    unsigned long t0 = _millis();
+    while (!port.is_baud_locked() && (_millis() - t0) < 4 * LINUX_PORT_AUTOBAUD_WINDOW_MS + 1000)
+    {
+        const char *s = port.get_speed() == 115200 ? SENTENCE : noise();
+        (void)!write(w, s, strlen(s));
+        port.listen(1);
+        usleep(20000);
+    }
+    TEST_ASSERT_TRUE(port.is_baud_locked());
+    TEST_ASSERT_EQUAL(115200, port.get_speed());
+
+    // stays there while the data is good
+    t0 = _millis();
+    while ((_millis() - t0) < LINUX_PORT_AUTOBAUD_WINDOW_MS + 200)
+    {
+        (void)!write(w, SENTENCE, strlen(SENTENCE));
+        port.listen(1);
+        usleep(20000);
+    }
+    TEST_ASSERT_TRUE(port.is_baud_locked());
+    TEST_ASSERT_EQUAL(115200, port.get_speed());
+
+    // a reset mid-window does not disturb the lock
+    port.reset_stats();
+    t0 = _millis();
+    while ((_millis() - t0) < LINUX_PORT_AUTOBAUD_WINDOW_MS / 2)
+    {
+        (void)!write(w, SENTENCE, strlen(SENTENCE));
+        port.listen(1);
+        usleep(20000);
+    }
+    TEST_ASSERT_TRUE(port.is_baud_locked());
+
+    // the device changed rate: data but no valid sentence for a whole window, scan again
+    t0 = _millis();
+    while (port.get_speed() == 115200 && (_millis() - t0) < 2 * LINUX_PORT_AUTOBAUD_WINDOW_MS + 500)
+    {
+        const char *g = noise();
+        (void)!write(w, g, strlen(g));
+        port.listen(1);
+        usleep(20000);
+    }
+    TEST_ASSERT_FALSE(port.is_baud_locked());
+    TEST_ASSERT_EQUAL(230400, port.get_speed());
+    port.close();
+    close(w);
+}
+
+void test_auto_baud_stats_reset_mid_window() {
+    int w = open(FIFO_PATH, O_RDWR | O_NONBLOCK);
+    TEST_ASSERT_TRUE(w > 0);
+    LinuxPort port(FIFO_PATH);
+    unsigned int rates[] = {4800, 9600};
+    port.enable_auto_baud(rates, 2);
+    // a couple of valid sentences by chance, not enough to lock, then a stats reset
+    unsigned long t0 = _millis();
+    while ((_millis() - t0) < 300)
+    {
+        if (port.get_stats().checksum_valid < 2) (void)!write(w, SENTENCE, strlen(SENTENCE));
+        port.listen(1);
+        usleep(20000);
+    }
+    TEST_ASSERT_EQUAL(2, port.get_stats().checksum_valid);
+    port.reset_stats();
+    t0 = _millis();
+    while ((_millis() - t0) < 300)
+    {
+        const char *g = noise();
+        (void)!write(w, g, strlen(g));
+        port.listen(1);
+        usleep(20000);
+    }
+    TEST_ASSERT_FALSE(port.is_baud_locked());
+    port.close();
+    close(w);
+}
+
+int main( int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_high_standard_speed);
+    RUN_TEST(test_custom_speed);
+    RUN_TEST(test_speed_change_reopens);
+    RUN_TEST(test_auto_baud_locks_on_valid_checksums);
+    RUN_TEST(test_auto_baud_stats_reset_mid_window);
+    UNITY_END();
+}
@@ -0,0 +1,221 @@
+#include "LinuxPort.h"
+#include "Utils.h"
+#include <unity.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <string>
+
+#define FIFO_PATH "/tmp/test_port_reader.fifo"
+
+static const char *SENTENCE = "!AIVDM,1,1,,A,13u?etPv2;0n:dDPwUM1U1Cb069D,0*24\r\n";
+
+class LineCounter: public PortListener
+{
+public:
+    int lines = 0;
+    bool all_good = true;
+    virtual void on_line(const char *line, int len)
+    {
+        lines++;
+        if (len != (int)strlen(SENTENCE) - 2 || strncmp(line, SENTENCE, len) != 0) all_good = false;
+    }
+};
+
+class LineCollector: public PortListener
+{
+public:
+    std::string lines[16];
+    int n = 0;
+    virtual void on_line(const char *line, int len)
+    {
+        if (n < 16) lines[n] = std::string(line, len);
+        n++;
+    }
+};
+
+static int open_writer()
+{
+    int w = open(FIFO_PATH, O_RDWR | O_NONBLOCK); // does not wait for the reader
+    TEST_ASSERT_TRUE(w > 0);
+    return w;
+}
+
+static void write_lines(int fd, int n)
+{
+    for (int i = 0; i < n; i++) TEST_ASSERT_EQUAL((int)strlen(SENTENCE), (int)write(fd, SENTENCE, strlen(SENTENCE)));
+}
+
+static bool wait_for(LinuxPort &port, LineCounter &c, int lines, unsigned long timeout_ms)
+{
+    unsigned long t0 = _millis();
+    while (c.lines < lines && (_millis() - t0) < timeout_ms)
+    {
+        port.listen(10);
+        usleep(1000);
+    }
+    return c.lines >= lines;
+}
+
+void setUp()
+{
+    unlink(FIFO_PATH);
+    mkfifo(FIFO_PATH, 0600);
+}
+
+void tearDown()
+{
+    unlink(FIFO_PATH);
+}
+
+void test_reads_while_main_loop_is_busy() {
+    int w = open_writer();
+    LinuxPort port(FIFO_PATH);
+    LineCounter c;
+    port.set_handler(&c);
+    port.enable_reader_thread();
+    usleep(50000);
+    TEST_ASSERT_TRUE(port.is_open());
+
+    // the main loop is stuck for 300ms: the reader keeps consuming
+    write_lines(w, 40);
+    usleep(300000);
+    TEST_ASSERT_EQUAL(0, c.lines);
+    port.listen(10);
+    TEST_ASSERT_EQUAL(40, c.lines);
+    TEST_ASSERT_TRUE(c.all_good);
+
+    LinuxPortReaderStats s = port.get_reader_stats();
+    TEST_ASSERT_EQUAL(40, s.lines);
+    TEST_ASSERT_EQUAL(0, s.overflows);
+    TEST_ASSERT_EQUAL(1, s.opens);
+    // queued lines waited for the main loop
+    TEST_ASSERT_TRUE(s.latency_max_us >= 200000);
+    close(w);
+}
+
+void test_overflow_counted() {
+    int w = open_writer();
+    LinuxPort port(FIFO_PATH);
+    LineCounter c;
+    port.set_handler(&c);
+    port.enable_reader_thread();
+    usleep(50000);
+    write_lines(w, LINUX_PORT_QUEUE_SLOTS + 10);
+    usleep(200000);
+    port.listen(10);
+    TEST_ASSERT_EQUAL(LINUX_PORT_QUEUE_SLOTS, c.lines);
+    TEST_ASSERT_EQUAL(10, port.get_reader_stats().overflows);
+    close(w);
+}
+
+void test_reopen_after_hangup() {
+    int w = open(FIFO_PATH, O_RDWR | O_NONBLOCK);
+    LinuxPort port(FIFO_PATH);
+    LineCounter c;
+    port.set_handler(&c);
+    port.enable_reader_thread();
+    usleep(50000);
+    // a plain writer, so that closing it (and the first one) hangs up the reader
+    int w2 = open(FIFO_PATH, O_WRONLY | O_NONBLOCK);
+    close(w);
+    write_lines(w2, 3);
+    TEST_ASSERT_TRUE(wait_for(port, c, 3, 1000));
+    close(w2);
+    // closed on end of file, reopened a second later
+    unsigned long t0 = _millis();
+    while (port.get_reader_stats().opens < 2 && (_millis() - t0) < 2000) usleep(10000);
+    TEST_ASSERT_EQUAL(2, port.get_reader_stats().opens);
+    w = open_writer();
+    write_lines(w, 2);
+    TEST_ASSERT_TRUE(wait_for(port, c, 5, 1000));
+    TEST_ASSERT_TRUE(c.all_good);
+    close(w);
+}
+
+void test_speed_change_reopens() {
+    int w = open_writer();
+    LinuxPort port(FIFO_PATH);
+    LineCounter c;
+    port.set_handler(&c);
+    port.enable_reader_thread();
+    usleep(50000);
+    port.set_speed(4800);
+    port.listen(10);
+    unsigned long t0 = _millis();
+    while (port.get_reader_stats().opens < 2 && (_millis() - t0) < 1000) usleep(10000);
+    TEST_ASSERT_EQUAL(2, port.get_reader_stats().opens);
+    write_lines(w, 1);
+    TEST_ASSERT_TRUE(wait_for(port, c, 1, 1000));
+    close(w);
+}
+
+void test_open_belongs_to_reader() {
+    unlink(FIFO_PATH);
+    LinuxPort port(FIFO_PATH);
+    LineCounter c;
+    port.set_handler(&c);
+    port.enable_reader_thread();
+    usleep(50000);
+    TEST_ASSERT_FALSE(port.is_open());
+    mkfifo(FIFO_PATH, 0600);
+    int w = open_writer();
+    // not opened on the caller thread: the reader retries on its own schedule
+    port.open();
+    TEST_ASSERT_FALSE(port.is_open());
+    unsigned long t0 = _millis();
+    while (!port.is_open() && (_millis() - t0) < 2000) usleep(10000);
+    TEST_ASSERT_TRUE(port.is_open());
+    TEST_ASSERT_EQUAL(1, port.get_reader_stats().opens);
+    write_lines(w, 2);
+    TEST_ASSERT_TRUE(wait_for(port, c, 2, 1000));
+    TEST_ASSERT_TRUE(c.all_good);
+    close(w);
+}
+
+void test_reader_framing() {
+    int w = open_writer();
+    LinuxPort port(FIFO_PATH);
+    LineCollector c;
+    port.set_handler(&c);
+    port.enable_reader_thread();
+    usleep(50000);
+    // mixed terminators, empty lines and a line split across reads
+    const char *chunks[] = {"$A*00\r\n\n$B*0", "0\r", "\r\n$C*00\n$D"};
+    for (auto s : chunks)
+    {
+        TEST_ASSERT_EQUAL((int)strlen(s), (int)write(w, s, strlen(s)));
+        usleep(20000);
+    }
+    // an overlong line is dropped up to its terminator
+    char big[PORT_BUFFER_SIZE + 100];
+    memset(big, 'x', sizeof(big));
+    TEST_ASSERT_EQUAL((int)sizeof(big), (int)write(w, big, sizeof(big)));
+    usleep(20000);
+    const char *tail = "x\r\n$E*00\r\n";
+    TEST_ASSERT_EQUAL((int)strlen(tail), (int)write(w, tail, strlen(tail)));
+    unsigned long t0 = _millis();
+    while (c.n < 4 && (_millis() - t0) < 1000)
+    {
+        port.listen(10);
+        usleep(1000);
+    }
+    TEST_ASSERT_EQUAL(4, c.n);
+    TEST_ASSERT_EQUAL_STRING("$A*00", c.lines[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("$B*00", c.lines[1].c_str());
+    TEST_ASSERT_EQUAL_STRING("$C*00", c.lines[2].c_str());
+    TEST_ASSERT_EQUAL_STRING("$E*00", c.lines[3].c_str());
+    TEST_ASSERT_EQUAL(1, port.get_reader_stats().overruns);
+    close(w);
+}
+
+int main( int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_reads_while_main_loop_is_busy);
+    RUN_TEST(test_overflow_counted);
+    RUN_TEST(test_reopen_after_hangup);
+    RUN_TEST(test_speed_change_reopens);
+    RUN_TEST(test_open_belongs_to_reader);
+    RUN_TEST(test_reader_framing);
+    UNITY_END();
+}
@@ -0,0 +1,174 @@
+#include "N2K.h"
+#include "N2KBridge.h"
+#include "N2KVirtualBus.h"
+#include "Utils.h"
+#include <N2kMessages.h>
+#include <unity.h>
+
+static int received = 0;
+static int received_depth = 0;
+static unsigned char last_source = 0;
+
+static void on_msg(const tN2kMsg &N2kMsg)
+{
+    if (N2kMsg.PGN == 127250)
+    {
+        received++;
+        last_source = N2kMsg.Source;
+    }
+    if (N2kMsg.PGN == 128267) received_depth++;
+}
+
+static void setup_node(tNMEA2000 *node, unsigned char source, unsigned long unique_number)
+{
+    node->SetProductInformation("00000001", 100, "Virtual node", "1.0.0", "1.0.0");
+    node->SetDeviceInformation(unique_number, 130, 25, 2046);
+    node->SetMode(tNMEA2000::N2km_ListenAndNode, source);
+}
+
+struct gateway
+{
+    N2KVirtualBus bus_a;
+    N2KVirtualBus bus_b;
+    N2K a;
+    N2K b;
+    tNMEA2000_virtual *sender = nullptr;
+    tNMEA2000_virtual *receiver = nullptr;
+
+    void run(unsigned long ms)
+    {
+        unsigned long t0 = _millis();
+        while ((_millis() - t0) < ms)
+        {
+            a.loop(_millis());
+            b.loop(_millis());
+            sender->ParseMessages();
+            receiver->ParseMessages();
+            msleep(1);
+        }
+    }
+
+    bool start()
+    {
+        n2k_device_info dvc;
+        a.set_virtual_bus(&bus_a);
+        b.set_virtual_bus(&bus_b);
+        a.setup(dvc);
+        b.setup(dvc);
+        sender = bus_a.create_node();
+        receiver = bus_b.create_node();
+        setup_node(sender, 30, 10);
+        setup_node(receiver, 31, 11);
+        receiver->SetMsgHandler(on_msg);
+        for (int i = 0; i < 100; i++)
+        {
+            if (sender->Open() && receiver->Open())
+            {
+                run(500);
+                return a.is_bus_connected() && b.is_bus_connected();
+            }
+            run(10);
+        }
+        return false;
+    }
+
+    ~gateway()
+    {
+        delete sender;
+        delete receiver;
+    }
+};
+
+void setUp()
+{
+    received = 0;
+    received_depth = 0;
+}
+
+void tearDown() {}
+
+void test_forward_allowed_pgns_only() {
+    gateway g;
+    TEST_ASSERT_TRUE(g.start());
+    N2KBridge bridge(&g.a, &g.b);
+    TEST_ASSERT_TRUE(bridge.allow(N2K_BRIDGE_A_TO_B, 127250));
+
+    tN2kMsg m;
+    SetN2kPGN127250(m, 1, DegToRad(90.0), N2kDoubleNA, N2kDoubleNA, N2khr_magnetic);
+    TEST_ASSERT_TRUE(g.sender->SendMsg(m));
+    SetN2kPGN128267(m, 1, 5.0, 0.5);
+    TEST_ASSERT_TRUE(g.sender->SendMsg(m));
+    g.run(50);
+
+    TEST_ASSERT_EQUAL(1, received);
+    TEST_ASSERT_EQUAL(0, received_depth);
+    TEST_ASSERT_EQUAL(g.b.get_source(), last_source);
+    N2KBridgeStats s = bridge.get_stats(N2K_BRIDGE_A_TO_B);
+    TEST_ASSERT_EQUAL(1, s.forwarded);
+    TEST_ASSERT_EQUAL(0, s.dropped);
+}
+
+void test_no_echo_loop() {
+    gateway g;
+    TEST_ASSERT_TRUE(g.start());
+    N2KBridge bridge(&g.a, &g.b);
+    TEST_ASSERT_TRUE(bridge.allow(N2K_BRIDGE_A_TO_B, 127250));
+    TEST_ASSERT_TRUE(bridge.allow(N2K_BRIDGE_B_TO_A, 127250));
+
+    tN2kMsg m;
+    SetN2kPGN127250(m, 1, DegToRad(90.0), N2kDoubleNA, N2kDoubleNA, N2khr_magnetic);
+    TEST_ASSERT_TRUE(g.sender->SendMsg(m));
+    g.run(50);
+
+    TEST_ASSERT_EQUAL(1, received);
+    TEST_ASSERT_EQUAL(1, bridge.get_stats(N2K_BRIDGE_A_TO_B).forwarded);
+    TEST_ASSERT_EQUAL(0, bridge.get_stats(N2K_BRIDGE_B_TO_A).forwarded);
+}
+
+void test_disallow() {
+    gateway g;
+    TEST_ASSERT_TRUE(g.start());
+    N2KBridge bridge(&g.a, &g.b);
+    TEST_ASSERT_TRUE(bridge.allow(N2K_BRIDGE_A_TO_B, 127250));
+    bridge.disallow(N2K_BRIDGE_A_TO_B, 127250);
+
+    tN2kMsg m;
+    SetN2kPGN127250(m, 1, DegToRad(90.0), N2kDoubleNA, N2kDoubleNA, N2khr_magnetic);
+    TEST_ASSERT_TRUE(g.sender->SendMsg(m));
+    g.run(50);
+
+    TEST_ASSERT_EQUAL(0, received);
+    TEST_ASSERT_EQUAL(0, bridge.get_stats(N2K_BRIDGE_A_TO_B).forwarded);
+}
+
+void test_refuse_threaded_source() {
+    N2K a;
+    N2K b;
+    a.enable_rx_queue(true);
+    N2KBridge bridge(&a, &b);
+    TEST_ASSERT_FALSE(bridge.allow(N2K_BRIDGE_A_TO_B, 127250));
+    TEST_ASSERT_TRUE(bridge.allow(N2K_BRIDGE_B_TO_A, 127250));
+}
+
+void test_instances_release_their_node() {
+    N2KVirtualBus bus;
+    n2k_device_info dvc;
+    // more instances than bus slots over time: each one frees its node
+    for (int i = 0; i < 2 * N2K_VIRTUAL_BUS_MAX_NODES; i++)
+    {
+        N2K n;
+        n.set_virtual_bus(&bus);
+        n.setup(dvc);
+        TEST_ASSERT_TRUE(n.get_state() != N2K_STATE_IDLE);
+    }
+}
+
+int main( int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_forward_allowed_pgns_only);
+    RUN_TEST(test_no_echo_loop);
+    RUN_TEST(test_disallow);
+    RUN_TEST(test_refuse_threaded_source);
+    RUN_TEST(test_instances_release_their_node);
+    UNITY_END();
+}
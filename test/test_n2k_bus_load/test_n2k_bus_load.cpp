@@ -0,0 +1,92 @@
+#include "N2KBusLoad.h"
+#include "N2K.h"
+#include "N2KVirtualBus.h"
+#include "Utils.h"
+#include <unity.h>
+#include "../n2k_test_helpers.h"
+
+void test_frame_bits_stuffing() {
+    // 54 bits from SOF to CRC, plus stuff bits, plus 13 trailing bits
+    TEST_ASSERT_EQUAL(74, N2KBusLoad::frame_bits(0, 0, nullptr));
+    unsigned char zeros[8] = {0};
+    TEST_ASSERT_EQUAL(146, N2KBusLoad::frame_bits(0x09F11216, 8, zeros));
+
+    unsigned char data[8] = {0xAA, 0x55, 0xAA, 0x55, 0xAA, 0x55, 0xAA, 0x55};
+    unsigned long bits = N2KBusLoad::frame_bits(0x09F11222, 8, data);
+    TEST_ASSERT_EQUAL(132, bits);
+    TEST_ASSERT_GREATER_OR_EQUAL(54 + 64 + 13, bits);
+    TEST_ASSERT_LESS_OR_EQUAL(54 + 64 + (54 + 64 - 1) / 4 + 13, bits);
+}
+
+void test_can_id() {
+    tN2kMsg m(22, 2, 127250);
+    TEST_ASSERT_EQUAL_HEX32(0x09F11216, N2KBusLoad::can_id(m));
+    tN2kMsg r(22, 6, 59904);
+    r.Destination = 0x30;
+    TEST_ASSERT_EQUAL_HEX32(0x18EA3016, N2KBusLoad::can_id(r));
+}
+
+void test_fast_packet_frames() {
+    tN2kMsg m(22, 3, 129029);
+    m.DataLen = 8;
+    int frames = 0;
+    N2KBusLoad::message_bits(m, &frames);
+    TEST_ASSERT_EQUAL(1, frames);
+    m.DataLen = 20; // 6 + 7 + 7
+    N2KBusLoad::message_bits(m, &frames);
+    TEST_ASSERT_EQUAL(3, frames);
+    m.DataLen = 223;
+    N2KBusLoad::message_bits(m, &frames);
+    TEST_ASSERT_EQUAL(32, frames);
+}
+
+void test_rolling_load() {
+    N2KBusLoad load(250000);
+    unsigned char data[8] = {0};
+    unsigned long bits = N2KBusLoad::frame_bits(0x09F11216, 8, data);
+    // ~50% of the bus during second 5, nothing after
+    unsigned long n = 125000 / bits;
+    for (unsigned long i = 0; i < n; i++) load.record_frame(0x09F11216, 8, data, 5000 + i % 1000);
+    float expected = n * bits * 100.0f / 250000;
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 0, load.get_load(1, 5500)); // the current second is not counted
+    TEST_ASSERT_FLOAT_WITHIN(0.01, expected, load.get_load(1, 6000));
+    TEST_ASSERT_FLOAT_WITHIN(0.01, expected / 10, load.get_load(10, 6000));
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 0, load.get_load(1, 7000));
+    TEST_ASSERT_FLOAT_WITHIN(0.01, expected / 60, load.get_load(60, 64000));
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 0, load.get_load(60, 66000));
+    TEST_ASSERT_EQUAL(n * bits, load.get_total_bits());
+}
+
+void test_n2k_loop_time() {
+    N2KVirtualBus bus(0);
+    N2K n2k;
+    // a loop clock unrelated to _millis(): the load windows follow it
+    unsigned long t = 5000000;
+    start_on_bus(n2k, bus, t);
+    N2KBusLoad *load = n2k.enable_bus_load();
+    unsigned char data[8] = {1, 0, 0, 0xFF, 0x7F, 0xFF, 0x7F, 0xFD};
+    for (int i = 0; i < 100; i++) TEST_ASSERT_TRUE(bus.inject(0x09F11202, 8, data));
+    n2k.loop(t + 100);
+    tN2kMsg m(22, 2, 127250);
+    for (int i = 0; i < 8; i++) m.AddByte(data[i]);
+    TEST_ASSERT_TRUE(n2k.send_msg(m, false));
+    // SendMsg stamped our source on m
+    unsigned long bits = 100 * N2KBusLoad::frame_bits(0x09F11202, 8, data) + N2KBusLoad::message_bits(m);
+    TEST_ASSERT_EQUAL(bits, load->get_total_bits());
+
+    // the second is complete for the loop clock
+    n2k.loop(t + 1000);
+    N2KStats s = n2k.getStats();
+    TEST_ASSERT_FLOAT_WITHIN(0.01, bits * 100.0 / N2K_BUS_BITRATE, s.bus_load_1s);
+    TEST_ASSERT_TRUE(s.bus_load_60s > 0);
+}
+
+int main( int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_frame_bits_stuffing);
+    RUN_TEST(test_can_id);
+    RUN_TEST(test_fast_packet_frames);
+    RUN_TEST(test_rolling_load);
+    RUN_TEST(test_n2k_loop_time);
+    UNITY_END();
+}
@@ -0,0 +1,92 @@
+#include "N2KChangeFilter.h"
+#include <unity.h>
+#include "../n2k_test_helpers.h"
+
+// sends through the filter like N2K::send_on_change, returns true if transmitted
+static bool send(N2KChangeFilter &f, const tN2kMsg &m, unsigned char instance, double value, unsigned long now)
+{
+    if (!f.check(m, instance, value, now)) return false;
+    f.sent(m, instance, value, now);
+    return true;
+}
+
+void test_no_policy_always_sent() {
+    N2KChangeFilter f;
+    tN2kMsg m = make_msg(127505, 22, 6);
+    TEST_ASSERT_TRUE(send(f, m, 0, 0.5, 0));
+    TEST_ASSERT_TRUE(send(f, m, 0, 0.5, 1));
+    TEST_ASSERT_EQUAL(0, f.get_suppressed());
+}
+
+void test_dead_band() {
+    N2KChangeFilter f;
+    TEST_ASSERT_TRUE(f.set_policy(127505, 0.02, 0));
+    tN2kMsg m = make_msg(127505, 22, 6);
+    TEST_ASSERT_TRUE(send(f, m, 0, 0.50, 0));   // first value
+    TEST_ASSERT_FALSE(send(f, m, 0, 0.51, 100));
+    TEST_ASSERT_FALSE(send(f, m, 0, 0.49, 200));
+    TEST_ASSERT_TRUE(send(f, m, 0, 0.53, 300));  // beyond the dead-band from the last sent value
+    TEST_ASSERT_TRUE(send(f, m, 1, 0.53, 300));  // other instance, own reference
+    TEST_ASSERT_FALSE(send(f, m, 1, 0.54, 400));
+    TEST_ASSERT_TRUE(send(f, m, 1, N2kDoubleNA, 500));
+    TEST_ASSERT_FALSE(send(f, m, 1, N2kDoubleNA, 600));
+    TEST_ASSERT_EQUAL(4, f.get_suppressed());
+    TEST_ASSERT_GREATER_THAN(4 * 64, f.get_bits_saved());
+}
+
+void test_heartbeat() {
+    N2KChangeFilter f;
+    f.set_policy(130312, 0.5, 1000);
+    tN2kMsg m = make_msg(130312, 22, 6);
+    TEST_ASSERT_TRUE(send(f, m, 0, 290.0, 0));
+    TEST_ASSERT_FALSE(send(f, m, 0, 290.0, 999));
+    TEST_ASSERT_TRUE(send(f, m, 0, 290.0, 1000));
+    TEST_ASSERT_FALSE(send(f, m, 0, 290.1, 1500));
+    // a failed transmission is not a new reference
+    TEST_ASSERT_TRUE(f.check(m, 0, 291.0, 1600));
+    TEST_ASSERT_TRUE(f.check(m, 0, 291.0, 1700));
+
+    N2KChangeStats s;
+    TEST_ASSERT_EQUAL(1, f.snapshot(&s, 1));
+    TEST_ASSERT_EQUAL(130312, s.pgn);
+    TEST_ASSERT_EQUAL(2, s.sent);
+    TEST_ASSERT_EQUAL(1, s.heartbeats);
+    TEST_ASSERT_EQUAL(2, s.suppressed);
+    f.reset_stats();
+    TEST_ASSERT_EQUAL(0, f.get_suppressed());
+}
+
+void test_full_table() {
+    N2KChangeFilter f;
+    // few PGNs with the same instances: every (PGN, instance) pair keeps its own reference
+    const unsigned long pgns[] = {127505, 130312, 130314, 130316};
+    const int instances = N2K_CHANGE_MAX_KEYS / 4;
+    for (int p = 0; p < 4; p++)
+    {
+        TEST_ASSERT_TRUE(f.set_policy(pgns[p], 0.5, 0));
+        tN2kMsg m = make_msg(pgns[p], 22, 6);
+        for (int i = 0; i < instances; i++) TEST_ASSERT_TRUE(send(f, m, i, p * 100 + i, 0));
+    }
+    for (int p = 0; p < 4; p++)
+    {
+        tN2kMsg m = make_msg(pgns[p], 22, 6);
+        for (int i = 0; i < instances; i++)
+        {
+            TEST_ASSERT_FALSE(send(f, m, i, p * 100 + i + 0.1, 10));
+            TEST_ASSERT_TRUE(send(f, m, i, p * 100 + i + 1.0, 20));
+        }
+    }
+    // no room for another pair: sent unfiltered
+    tN2kMsg m = make_msg(pgns[0], 22, 6);
+    TEST_ASSERT_TRUE(send(f, m, instances, 1.0, 30));
+    TEST_ASSERT_TRUE(send(f, m, instances, 1.0, 40));
+}
+
+int main( int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_no_policy_always_sent);
+    RUN_TEST(test_dead_band);
+    RUN_TEST(test_heartbeat);
+    RUN_TEST(test_full_table);
+    UNITY_END();
+}
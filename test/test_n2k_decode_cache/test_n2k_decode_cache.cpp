@@ -0,0 +1,94 @@
+#include "N2KDecodeCache.h"
+#include <unity.h>
+
+void test_last_values() {
+    N2KDecodeCache cache;
+    N2KHeading h;
+    TEST_ASSERT_FALSE(cache.get_heading(h));
+
+    tN2kMsg m;
+    SetN2kPGN127250(m, 7, DegToRad(90.0), N2kDoubleNA, DegToRad(2.0), N2khr_magnetic);
+    TEST_ASSERT_TRUE(cache.update(m, 1000));
+    unsigned long t = 0;
+    TEST_ASSERT_TRUE(cache.get_heading(h, &t));
+    TEST_ASSERT_EQUAL(7, h.sid);
+    TEST_ASSERT_DOUBLE_WITHIN(0.001, DegToRad(90.0), h.heading);
+    TEST_ASSERT_TRUE(N2kIsNA(h.deviation));
+    TEST_ASSERT_EQUAL(N2khr_magnetic, h.reference);
+    TEST_ASSERT_EQUAL(1000, t);
+
+    SetN2kPGN129025(m, 43.5, 10.25);
+    TEST_ASSERT_TRUE(cache.update(m, 1100));
+    N2KPosition p;
+    TEST_ASSERT_TRUE(cache.get_position(p));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-6, 43.5, p.latitude);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-6, 10.25, p.longitude);
+
+    SetN2kPGN128267(m, 1, 5.0, 0.5);
+    TEST_ASSERT_FALSE(cache.update(m, 1200));
+    TEST_ASSERT_EQUAL(2, cache.get_decoded());
+}
+
+void test_window_stats() {
+    N2KDecodeCache cache;
+    tN2kMsg m;
+    // 10 Hz wind, speed 1..20 over 2 seconds
+    for (int i = 0; i < 20; i++)
+    {
+        SetN2kPGN130306(m, i, i + 1, DegToRad(45.0), N2kWind_Apparent);
+        cache.update(m, 1000 + i * 100);
+    }
+    N2KFieldStats s;
+    TEST_ASSERT_TRUE(cache.get_stats(130306, N2K_DECODE_WIND_SPEED, 1000, 2900, s));
+    TEST_ASSERT_EQUAL(11, s.samples); // 1900..2900
+    TEST_ASSERT_DOUBLE_WITHIN(1e-6, 10.0, s.min);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-6, 20.0, s.max);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-6, 15.0, s.mean);
+    TEST_ASSERT_FALSE(cache.get_stats(130306, N2K_DECODE_WIND_SPEED, 1000, 10000, s));
+    TEST_ASSERT_FALSE(cache.get_stats(130306, 5, 1000, 2900, s));
+}
+
+void test_circular_mean() {
+    N2KDecodeCache cache;
+    tN2kMsg m;
+    // headings around north: the linear mean would be 180
+    double deg[4] = {350, 355, 5, 10};
+    for (int i = 0; i < 4; i++)
+    {
+        SetN2kPGN127250(m, i, DegToRad(deg[i]), N2kDoubleNA, N2kDoubleNA, N2khr_true);
+        cache.update(m, 1000 + i * 100);
+    }
+    N2KFieldStats s;
+    TEST_ASSERT_TRUE(cache.get_stats(127250, N2K_DECODE_HEADING, 1000, 1300, s));
+    TEST_ASSERT_EQUAL(4, s.samples);
+    TEST_ASSERT_DOUBLE_WITHIN(0.001, 0.0, s.mean);
+    TEST_ASSERT_DOUBLE_WITHIN(0.001, DegToRad(-10.0), s.min);
+    TEST_ASSERT_DOUBLE_WITHIN(0.001, DegToRad(10.0), s.max);
+    // deviation is NA in all the samples
+    TEST_ASSERT_FALSE(cache.get_stats(127250, N2K_DECODE_DEVIATION, 1000, 1300, s));
+}
+
+void test_history_wraps() {
+    N2KDecodeCache cache;
+    tN2kMsg m;
+    for (int i = 0; i < N2K_DECODE_HISTORY + 10; i++)
+    {
+        SetN2kPGN127257(m, i, 0, 0, i);
+        cache.update(m, i * 10);
+    }
+    N2KFieldStats s;
+    unsigned long now = (N2K_DECODE_HISTORY + 9) * 10;
+    TEST_ASSERT_TRUE(cache.get_stats(127257, N2K_DECODE_ROLL, 100000, now, s));
+    TEST_ASSERT_EQUAL(N2K_DECODE_HISTORY, s.samples);
+    TEST_ASSERT_TRUE(cache.get_stats(127257, N2K_DECODE_ROLL, 50, now, s));
+    TEST_ASSERT_EQUAL(6, s.samples);
+}
+
+int main( int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_last_values);
+    RUN_TEST(test_window_stats);
+    RUN_TEST(test_circular_mean);
+    RUN_TEST(test_history_wraps);
+    UNITY_END();
+}
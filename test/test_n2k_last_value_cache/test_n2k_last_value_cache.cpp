@@ -0,0 +1,131 @@
+#include "N2KLastValueCache.h"
+#include <unity.h>
+#include "../n2k_test_helpers.h"
+#include <thread>
+#include <atomic>
+
+void test_get() {
+    N2KLastValueCache cache;
+    tN2kMsg m;
+    TEST_ASSERT_FALSE(cache.get(127250, 1, m, 0));
+    cache.update(make_msg(127250, 1, 2, 10), 1000);
+    cache.update(make_msg(127250, 1, 2, 11), 1100);
+    cache.update(make_msg(127250, 2, 2, 20), 1050);
+
+    unsigned long t = 0;
+    TEST_ASSERT_TRUE(cache.get(127250, 1, m, 1200, 0, &t));
+    TEST_ASSERT_EQUAL(11, m.Data[0]);
+    TEST_ASSERT_EQUAL(1, m.Source);
+    TEST_ASSERT_EQUAL(1100, t);
+    TEST_ASSERT_TRUE(cache.get(127250, 2, m, 1200));
+    TEST_ASSERT_EQUAL(20, m.Data[0]);
+    TEST_ASSERT_FALSE(cache.get(127250, 3, m, 1200));
+    TEST_ASSERT_FALSE(cache.get(127251, 1, m, 1200));
+}
+
+void test_max_age() {
+    N2KLastValueCache cache;
+    tN2kMsg m;
+    cache.update(make_msg(130306, 5, 2, 1), 1000);
+    TEST_ASSERT_TRUE(cache.get(130306, 5, m, 1500, 500));
+    TEST_ASSERT_FALSE(cache.get(130306, 5, m, 1501, 500));
+    TEST_ASSERT_TRUE(cache.get(130306, 5, m, 100000, 0));
+    // a stale message is still copied, with its time
+    unsigned long t = 0;
+    TEST_ASSERT_FALSE(cache.get(130306, 5, m, 2000, 500, &t));
+    TEST_ASSERT_EQUAL(1000, t);
+}
+
+void test_get_any() {
+    N2KLastValueCache cache;
+    tN2kMsg m;
+    TEST_ASSERT_FALSE(cache.get_any(129025, m, 0));
+    cache.update(make_msg(129025, 1, 2, 1), 1000);
+    cache.update(make_msg(129025, 2, 2, 2), 1300);
+    cache.update(make_msg(129025, 3, 2, 3), 1200);
+    cache.update(make_msg(129026, 4, 2, 4), 1400);
+
+    unsigned long t = 0;
+    TEST_ASSERT_TRUE(cache.get_any(129025, m, 1400, 0, &t));
+    TEST_ASSERT_EQUAL(2, m.Source);
+    TEST_ASSERT_EQUAL(1300, t);
+    TEST_ASSERT_FALSE(cache.get_any(129025, m, 1400, 50));
+    cache.update(make_msg(129025, 1, 2, 5), 1450);
+    TEST_ASSERT_TRUE(cache.get_any(129025, m, 1460, 50));
+    TEST_ASSERT_EQUAL(1, m.Source);
+    TEST_ASSERT_EQUAL(5, m.Data[7]);
+}
+
+void test_overflow() {
+    N2KLastValueCache cache;
+    for (int s = 0; s < N2K_LVC_SIZE; s++) cache.update(make_msg(127250, s, 2, s), s);
+    TEST_ASSERT_EQUAL(0, cache.get_overflow());
+    cache.update(make_msg(127251, 0, 2, 0), 0);
+    TEST_ASSERT_EQUAL(1, cache.get_overflow());
+    tN2kMsg m;
+    TEST_ASSERT_TRUE(cache.get(127250, N2K_LVC_SIZE - 1, m, 0));
+}
+
+void test_full_table_same_source() {
+    N2KLastValueCache cache;
+    // contiguous PGNs from one source, the worst case for a hash on the low bits
+    for (int i = 0; i < N2K_LVC_SIZE; i++) cache.update(make_msg(130000 + i, 7, 2, i), i);
+    TEST_ASSERT_EQUAL(0, cache.get_overflow());
+    cache.update(make_msg(131000, 7, 2, 0), 0);
+    TEST_ASSERT_EQUAL(1, cache.get_overflow());
+    tN2kMsg m;
+    for (int i = 0; i < N2K_LVC_SIZE; i++)
+    {
+        TEST_ASSERT_TRUE(cache.get(130000 + i, 7, m, 0));
+        TEST_ASSERT_EQUAL(i, m.Data[0]);
+    }
+    TEST_ASSERT_FALSE(cache.get(131000, 7, m, 0));
+    // cached pairs keep updating
+    cache.update(make_msg(130000, 7, 2, 99), 100);
+    TEST_ASSERT_TRUE(cache.get(130000, 7, m, 100));
+    TEST_ASSERT_EQUAL(99, m.Data[0]);
+    TEST_ASSERT_EQUAL(1, cache.get_overflow());
+}
+
+void test_concurrent_writer() {
+    N2KLastValueCache cache;
+    std::atomic<bool> stop(false);
+    cache.update(make_msg(127250, 1, 2, 0), 0);
+    cache.update(make_msg(127250, 2, 2, 0), 0);
+    // every message carries its time in each data byte, so a torn read shows
+    std::thread writer([&]() {
+        for (unsigned long i = 1; !stop.load(); i++)
+        {
+            cache.update(make_msg(127250, 1 + (i & 1), 2, (unsigned char)i), i);
+        }
+    });
+    int ok = 0, failed = 0;
+    for (int n = 0; n < 200000; n++)
+    {
+        tN2kMsg m;
+        unsigned long t = 0;
+        bool res = (n & 1) ? cache.get_any(127250, m, 0, 0, &t) : cache.get(127250, 1, m, 0, 0, &t);
+        if (!res)
+        {
+            failed++;
+            continue;
+        }
+        ok++;
+        for (int i = 0; i < 8; i++) TEST_ASSERT_EQUAL((unsigned char)t, m.Data[i]);
+        TEST_ASSERT_EQUAL(127250, m.PGN);
+    }
+    stop = true;
+    writer.join();
+    TEST_ASSERT_GREATER_THAN(failed, ok);
+}
+
+int main( int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_get);
+    RUN_TEST(test_max_age);
+    RUN_TEST(test_get_any);
+    RUN_TEST(test_overflow);
+    RUN_TEST(test_full_table_same_source);
+    RUN_TEST(test_concurrent_writer);
+    UNITY_END();
+}
@@ -0,0 +1,134 @@
+#include "N2KLinuxCAN.h"
+#include <unity.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+// frames come in as can_frame datagrams over UDP loopback, which carries the same
+// software receive timestamps as a CAN socket
+class TestCAN: public tNMEA2000_linux
+{
+public:
+    TestCAN(): tNMEA2000_linux("udp") {}
+    using tNMEA2000_linux::CANGetFrame;
+};
+
+static int tx = -1;
+
+static int udp_pair()
+{
+    int rx = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    TEST_ASSERT_EQUAL(0, bind(rx, (struct sockaddr *)&addr, sizeof(addr)));
+    socklen_t len = sizeof(addr);
+    getsockname(rx, (struct sockaddr *)&addr, &len);
+    tx = socket(AF_INET, SOCK_DGRAM, 0);
+    TEST_ASSERT_EQUAL(0, connect(tx, (struct sockaddr *)&addr, sizeof(addr)));
+    return rx;
+}
+
+static void send_frame(unsigned long id, unsigned char b)
+{
+    struct can_frame f;
+    memset(&f, 0, sizeof(f));
+    f.can_id = id | CAN_EFF_FLAG;
+    f.can_dlc = 8;
+    memset(f.data, b, 8);
+    TEST_ASSERT_EQUAL((int)sizeof(f), (int)send(tx, &f, sizeof(f), 0));
+}
+
+void tearDown()
+{
+    if (tx >= 0) close(tx);
+    tx = -1;
+}
+
+void test_batch_receive() {
+    TestCAN can;
+    can.attach_socket(udp_pair());
+    int n = N2K_CAN_RX_BATCH + 8;
+    for (int i = 0; i < n; i++) send_frame(0x09F80100 + i, i);
+    // a standard frame, skipped
+    struct can_frame f;
+    memset(&f, 0, sizeof(f));
+    f.can_id = 0x123;
+    send(tx, &f, sizeof(f), 0);
+
+    unsigned long id;
+    unsigned char len;
+    unsigned char buf[8];
+    for (int i = 0; i < n; i++)
+    {
+        TEST_ASSERT_TRUE(can.CANGetFrame(id, len, buf));
+        TEST_ASSERT_EQUAL(0x09F80100 + i, id);
+        TEST_ASSERT_EQUAL(8, len);
+        TEST_ASSERT_EQUAL(i, buf[7]);
+    }
+    TEST_ASSERT_FALSE(can.CANGetFrame(id, len, buf));
+    TEST_ASSERT_EQUAL(n + 1, can.get_rx_frames());
+    // two full reads, then the short one and the empty one
+    TEST_ASSERT_EQUAL(3, can.get_rx_syscalls());
+}
+
+void test_timestamps_are_realtime() {
+    TestCAN can;
+    can.attach_socket(udp_pair());
+    unsigned long long before = tNMEA2000_linux::realtime_us();
+    send_frame(0x09F80100, 1);
+    usleep(20000);
+    unsigned long long after = tNMEA2000_linux::realtime_us();
+
+    unsigned long id;
+    unsigned char len;
+    unsigned char buf[8];
+    TEST_ASSERT_TRUE(can.CANGetFrame(id, len, buf));
+    // stamped by the kernel on arrival, not when read
+    unsigned long long t = can.get_last_rx_timestamp_us();
+    TEST_ASSERT_TRUE(t >= before);
+    TEST_ASSERT_TRUE(t + 15000 < after);
+}
+
+static bool matches(const struct can_filter &f, unsigned long id)
+{
+    return ((id | CAN_EFF_FLAG) & f.can_mask) == (f.can_id & f.can_mask);
+}
+
+void test_filter_pdu1() {
+    struct can_filter f;
+    // 59904 ISO request: PF 0xEA, addressed
+    tNMEA2000_linux::make_filter(59904, f);
+    TEST_ASSERT_EQUAL_HEX32(0x00EA0000 | CAN_EFF_FLAG, f.can_id);
+    TEST_ASSERT_EQUAL_HEX32(0x03FF0000 | CAN_EFF_FLAG, f.can_mask);
+    TEST_ASSERT_TRUE(matches(f, 0x18EAFF01));  // broadcast, priority 6, source 1
+    TEST_ASSERT_TRUE(matches(f, 0x0CEA2322));  // to 0x23, priority 3
+    TEST_ASSERT_FALSE(matches(f, 0x18EB2322)); // 60160
+    TEST_ASSERT_FALSE(matches(f, 0x19EAFF01)); // data page 1
+}
+
+void test_filter_pdu2() {
+    struct can_filter f;
+    // 127250 heading: PF 0xF1, PS is part of the PGN
+    tNMEA2000_linux::make_filter(127250, f);
+    TEST_ASSERT_EQUAL_HEX32(0x01F11200 | CAN_EFF_FLAG, f.can_id);
+    TEST_ASSERT_EQUAL_HEX32(0x03FFFF00 | CAN_EFF_FLAG, f.can_mask);
+    TEST_ASSERT_TRUE(matches(f, 0x09F11202));
+    TEST_ASSERT_TRUE(matches(f, 0x1DF112FE));
+    TEST_ASSERT_FALSE(matches(f, 0x09F11302)); // 127251
+    TEST_ASSERT_FALSE(matches(f, 0x08F11202)); // data page 0
+    // 130306 wind, data page 1
+    tNMEA2000_linux::make_filter(130306, f);
+    TEST_ASSERT_TRUE(matches(f, 0x09FD0205));
+    TEST_ASSERT_FALSE(matches(f, 0x09FD0305));
+}
+
+int main( int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_batch_receive);
+    RUN_TEST(test_timestamps_are_realtime);
+    RUN_TEST(test_filter_pdu1);
+    RUN_TEST(test_filter_pdu2);
+    UNITY_END();
+}
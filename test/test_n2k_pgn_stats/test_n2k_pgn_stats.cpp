@@ -0,0 +1,123 @@
+#include "N2KPgnStats.h"
+#include <unity.h>
+#include "../n2k_test_helpers.h"
+
+static N2KPgnCounters *find(N2KPgnCounters *c, int n, unsigned long pgn)
+{
+    for (int i = 0; i < n; i++) if (c[i].pgn == pgn) return &c[i];
+    return nullptr;
+}
+
+void test_counting() {
+    N2KPgnStats stats;
+    for (int i = 0; i < 10; i++) stats.record_recv(make_msg(127250, 1), i * 100);
+    for (int i = 0; i < 5; i++) stats.record_recv(make_msg(129025, 2), i * 100);
+    stats.record_sent(127250, true);
+    stats.record_sent(127250, false);
+    stats.record_bits(127250, 1, 130);
+
+    N2KPgnCounters c[N2K_STATS_MAX_PGNS];
+    TEST_ASSERT_EQUAL(2, stats.snapshot(c, N2K_STATS_MAX_PGNS));
+    N2KPgnCounters *hdg = find(c, 2, 127250);
+    TEST_ASSERT_NOT_NULL(hdg);
+    TEST_ASSERT_EQUAL(10, hdg->recv);
+    TEST_ASSERT_EQUAL(1, hdg->sent);
+    TEST_ASSERT_EQUAL(1, hdg->fail);
+    TEST_ASSERT_EQUAL(130, hdg->bits);
+    TEST_ASSERT_EQUAL(5, find(c, 2, 129025)->recv);
+
+    unsigned long src[N2K_STATS_SOURCES];
+    stats.snapshot_sources(src);
+    TEST_ASSERT_EQUAL(10, src[1]);
+    TEST_ASSERT_EQUAL(5, src[2]);
+    stats.snapshot_source_bits(src);
+    TEST_ASSERT_EQUAL(130, src[1]);
+
+    // reset moves the baseline only
+    stats.reset();
+    stats.record_recv(make_msg(127250, 1), 1000);
+    TEST_ASSERT_EQUAL(2, stats.snapshot(c, N2K_STATS_MAX_PGNS));
+    hdg = find(c, 2, 127250);
+    TEST_ASSERT_EQUAL(1, hdg->recv);
+    TEST_ASSERT_EQUAL(0, hdg->sent);
+    TEST_ASSERT_EQUAL(0, find(c, 2, 129025)->recv);
+    stats.snapshot_sources(src);
+    TEST_ASSERT_EQUAL(1, src[1]);
+    TEST_ASSERT_EQUAL(0, src[2]);
+}
+
+void test_rates() {
+    N2KPgnStats stats;
+    // 10Hz: 99ms apart falls in [64,128)
+    for (int i = 0; i < 11; i++) stats.record_recv(make_msg(127250, 1), 1000 + i * 99);
+    N2KPgnCounters c;
+    TEST_ASSERT_EQUAL(1, stats.snapshot(&c, 1));
+    TEST_ASSERT_EQUAL(11, c.recv);
+    int b = N2KPgnStats::get_bucket(99);
+    TEST_ASSERT_EQUAL(7, b);
+    for (int j = 0; j < N2K_HISTOGRAM_BUCKETS; j++) TEST_ASSERT_EQUAL(j == b ? 10 : 0, c.interarrival[j]);
+
+    TEST_ASSERT_EQUAL(0, N2KPgnStats::get_bucket(0));
+    TEST_ASSERT_EQUAL(1, N2KPgnStats::get_bucket(1));
+    TEST_ASSERT_EQUAL(N2K_HISTOGRAM_BUCKETS - 1, N2KPgnStats::get_bucket(1000000));
+}
+
+void test_handler_time() {
+    N2KPgnStats stats;
+    stats.record_recv(make_msg(127250, 1), 0);
+    stats.record_handler(127250, 0);
+    stats.record_handler(127250, 10);
+    stats.record_handler(127250, 5000);
+    stats.record_handler(130306, 7); // not received, only the global histogram
+
+    TEST_ASSERT_EQUAL(5017, stats.get_handler_total_us());
+    N2KPgnCounters c;
+    TEST_ASSERT_EQUAL(1, stats.snapshot(&c, 1));
+    TEST_ASSERT_EQUAL(5010, c.handler_us);
+
+    unsigned long h[N2K_HISTOGRAM_BUCKETS];
+    stats.snapshot_handler_time(h);
+    TEST_ASSERT_EQUAL(1, h[0]);
+    TEST_ASSERT_EQUAL(1, h[N2KPgnStats::get_bucket(10)]);
+    TEST_ASSERT_EQUAL(1, h[N2KPgnStats::get_bucket(7)]);
+    TEST_ASSERT_EQUAL(1, h[N2K_HISTOGRAM_BUCKETS - 1]);
+
+    stats.reset();
+    TEST_ASSERT_EQUAL(0, stats.get_handler_total_us());
+    stats.snapshot_handler_time(h);
+    for (int j = 0; j < N2K_HISTOGRAM_BUCKETS; j++) TEST_ASSERT_EQUAL(0, h[j]);
+}
+
+void test_full_table() {
+    N2KPgnStats stats;
+    // contiguous PGNs, the worst case for a hash on the low bits
+    for (unsigned long pgn = 130000; pgn < 130000 + N2K_STATS_MAX_PGNS; pgn++) stats.record_recv(make_msg(pgn, 1), 0);
+    TEST_ASSERT_EQUAL(0, stats.get_untracked());
+    stats.record_recv(make_msg(131000, 1), 0);
+    stats.record_sent(131001, true);
+    TEST_ASSERT_EQUAL(2, stats.get_untracked());
+
+    N2KPgnCounters c[N2K_STATS_MAX_PGNS];
+    TEST_ASSERT_EQUAL(N2K_STATS_MAX_PGNS, stats.snapshot(c, N2K_STATS_MAX_PGNS));
+    for (unsigned long pgn = 130000; pgn < 130000 + N2K_STATS_MAX_PGNS; pgn++)
+    {
+        N2KPgnCounters *e = find(c, N2K_STATS_MAX_PGNS, pgn);
+        TEST_ASSERT_NOT_NULL(e);
+        TEST_ASSERT_EQUAL(1, e->recv);
+    }
+    // tracked PGNs keep counting
+    stats.record_recv(make_msg(130000, 1), 100);
+    stats.snapshot(c, N2K_STATS_MAX_PGNS);
+    TEST_ASSERT_EQUAL(2, find(c, N2K_STATS_MAX_PGNS, 130000)->recv);
+    TEST_ASSERT_EQUAL(2, stats.get_untracked());
+    stats.dump();
+}
+
+int main( int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_counting);
+    RUN_TEST(test_rates);
+    RUN_TEST(test_handler_time);
+    RUN_TEST(test_full_table);
+    UNITY_END();
+}
@@ -0,0 +1,139 @@
+#include "N2KReplay.h"
+#include "N2KVirtualBus.h"
+#include "N2K.h"
+#include <unity.h>
+#include "../n2k_test_helpers.h"
+#include <stdio.h>
+#include <unistd.h>
+
+#define LOG_PATH "/tmp/test_n2k_replay.log"
+#define LOG_FRAMES 200
+
+static int heading_msgs = 0;
+
+static void on_heading(const tN2kMsg &N2kMsg, void *context)
+{
+    heading_msgs++;
+}
+
+// single frame 127250 from source 0x02, 10ms apart, plus a comment
+static void write_log()
+{
+    FILE *f = fopen(LOG_PATH, "w");
+    TEST_ASSERT_NOT_NULL(f);
+    fprintf(f, "# heading\n");
+    for (int i = 0; i < LOG_FRAMES; i++)
+    {
+        fprintf(f, "(1436509053.%06d) can0 09F11202#01%02X00FF7FFF7FFD\n", i * 1000, i & 0xFF);
+    }
+    fclose(f);
+}
+
+static void start(N2K &n2k, N2KVirtualBus &bus)
+{
+    start_on_bus(n2k, bus, _millis());
+    n2k.subscribe(127250, on_heading, nullptr);
+}
+
+void setUp()
+{
+    heading_msgs = 0;
+    write_log();
+}
+
+void tearDown()
+{
+    unlink(LOG_PATH);
+}
+
+void test_parse_candump_log() {
+    N2KReplayFrame f;
+    TEST_ASSERT_TRUE(N2KReplay::parse_line("(1436509053.650713) can0 09F80102#A0C2F9FE70C12F07\n", f));
+    TEST_ASSERT_EQUAL(0x09F80102, f.id);
+    TEST_ASSERT_EQUAL(8, f.len);
+    TEST_ASSERT_EQUAL(0xA0, f.data[0]);
+    TEST_ASSERT_EQUAL(0x07, f.data[7]);
+    TEST_ASSERT_TRUE(f.time_us == 1436509053650713ULL);
+}
+
+void test_parse_candump_log_short_frame() {
+    N2KReplayFrame f;
+    TEST_ASSERT_TRUE(N2KReplay::parse_line("(1436509053.5) vcan0 1CEAFF16#00EE00", f));
+    TEST_ASSERT_EQUAL(0x1CEAFF16, f.id);
+    TEST_ASSERT_EQUAL(3, f.len);
+    TEST_ASSERT_TRUE(f.time_us == 1436509053500000ULL);
+}
+
+void test_parse_candump() {
+    N2KReplayFrame f;
+    TEST_ASSERT_TRUE(N2KReplay::parse_line("  can0  09F80102   [8]  A0 C2 F9 FE 70 C1 2F 07", f));
+    TEST_ASSERT_EQUAL(0x09F80102, f.id);
+    TEST_ASSERT_EQUAL(8, f.len);
+    TEST_ASSERT_EQUAL(0xC2, f.data[1]);
+    TEST_ASSERT_FALSE(N2KReplay::parse_line("  can0  09F80102   [4]  A0 C2 F9", f));
+}
+
+void test_parse_raw() {
+    N2KReplayFrame f;
+    TEST_ASSERT_TRUE(N2KReplay::parse_line("17:33:21.107 R 19F51323 01 2F 30 70 00 2F 30 70\r\n", f));
+    TEST_ASSERT_EQUAL(0x19F51323, f.id);
+    TEST_ASSERT_EQUAL(8, f.len);
+    TEST_ASSERT_EQUAL(0x70, f.data[7]);
+    TEST_ASSERT_TRUE(f.time_us == (17ULL * 3600 + 33 * 60 + 21) * 1000000ULL + 107000ULL);
+}
+
+void test_parse_invalid() {
+    N2KReplayFrame f;
+    TEST_ASSERT_FALSE(N2KReplay::parse_line("", f));
+    TEST_ASSERT_FALSE(N2KReplay::parse_line("# comment", f));
+    TEST_ASSERT_FALSE(N2KReplay::parse_line("(1436509053.650713) can0 09F80102#A0C2F9FE70C12F0701", f));
+    TEST_ASSERT_FALSE(N2KReplay::parse_line("17:33:21.107 X 19F51323 01", f));
+}
+
+void test_run_end_to_end() {
+    N2KVirtualBus bus(0);
+    N2K n2k;
+    start(n2k, bus);
+    N2KReplay replay(&n2k, &bus);
+    TEST_ASSERT_TRUE(replay.open(LOG_PATH));
+    N2KReplayReport r = replay.run();
+    r.dump();
+    TEST_ASSERT_EQUAL(LOG_FRAMES, r.frames);
+    TEST_ASSERT_EQUAL(0, r.dropped);
+    TEST_ASSERT_EQUAL(1, r.skipped);
+    TEST_ASSERT_EQUAL(LOG_FRAMES, r.messages);
+    TEST_ASSERT_EQUAL(LOG_FRAMES, heading_msgs);
+    // the pgn stats are not enabled behind the caller's back
+    TEST_ASSERT_NULL(n2k.getStats().pgn_stats);
+    TEST_ASSERT_EQUAL(0, r.handler_us);
+}
+
+void test_run_counts_bus_drops() {
+    // as fast as possible on a 250k bus: the bus refuses what exceeds the backlog
+    N2KVirtualBus bus(250000);
+    N2K n2k;
+    start(n2k, bus);
+    n2k.enable_pgn_stats();
+    N2KReplay replay(&n2k, &bus);
+    TEST_ASSERT_TRUE(replay.open(LOG_PATH));
+    N2KReplayReport r = replay.run();
+    r.dump();
+    TEST_ASSERT_TRUE(r.dropped > 0);
+    TEST_ASSERT_EQUAL(LOG_FRAMES, r.frames + r.dropped);
+    TEST_ASSERT_TRUE(r.messages <= r.frames);
+    TEST_ASSERT_EQUAL(bus.get_stats().rejected, r.dropped);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_parse_candump_log);
+    RUN_TEST(test_parse_candump_log_short_frame);
+    RUN_TEST(test_parse_candump);
+    RUN_TEST(test_parse_raw);
+    RUN_TEST(test_parse_invalid);
+    RUN_TEST(test_run_end_to_end);
+    RUN_TEST(test_run_counts_bus_drops);
+    UNITY_END();
+    return 0;
+}
@@ -0,0 +1,77 @@
+#include "N2K.h"
+#include "N2KVirtualBus.h"
+#include "Utils.h"
+#include <unity.h>
+#include "../n2k_test_helpers.h"
+#include <atomic>
+
+static std::atomic<int> dispatched(0);
+
+static void on_heading(const tN2kMsg &N2kMsg, void *context)
+{
+    dispatched++;
+}
+
+static void start(N2K &n2k, N2KVirtualBus &bus)
+{
+    start_on_bus(n2k, bus, _millis());
+    n2k.subscribe(127250, on_heading, nullptr);
+}
+
+static void inject_heading(N2KVirtualBus &bus, int i)
+{
+    unsigned char data[8] = {1, (unsigned char)i, 0, 0xFF, 0x7F, 0xFF, 0x7F, 0xFD};
+    TEST_ASSERT_TRUE(bus.inject(0x09F11202, 8, data));
+}
+
+void setUp()
+{
+    dispatched = 0;
+}
+
+void test_inline_queue() {
+    N2KVirtualBus bus(0);
+    N2K n2k;
+    start(n2k, bus);
+    n2k.enable_rx_queue();
+    for (int i = 0; i < 10; i++) inject_heading(bus, i);
+    n2k.loop(_millis());
+    TEST_ASSERT_EQUAL(10, dispatched.load());
+    N2KStats s = n2k.getStats();
+    TEST_ASSERT_EQUAL(10, s.recv);
+    TEST_ASSERT_EQUAL(0, s.rx_queue_overflow);
+    TEST_ASSERT_TRUE(s.rx_queue_hwm >= 1);
+}
+
+void test_threaded_dispatch_stats() {
+    N2KVirtualBus bus(0);
+    N2K n2k;
+    start(n2k, bus);
+    n2k.enable_rx_queue(true);
+    TEST_ASSERT_TRUE(n2k.has_rx_thread());
+    // stats are taken while the consumer thread dispatches and updates its own
+    int n = 0;
+    unsigned long t0 = _millis();
+    while ((_millis() - t0) < 300)
+    {
+        for (int i = 0; i < 8; i++) inject_heading(bus, n++);
+        n2k.loop(_millis());
+        N2KStats s = n2k.getStats();
+        TEST_ASSERT_TRUE(s.rx_latency_max_us < 60000000ULL);
+        msleep(1);
+    }
+    t0 = _millis();
+    while (dispatched.load() < n && (_millis() - t0) < 1000) msleep(1);
+    N2KStats s = n2k.getStats();
+    TEST_ASSERT_EQUAL(n, dispatched.load());
+    TEST_ASSERT_EQUAL(n, s.recv + s.rx_queue_overflow);
+    TEST_ASSERT_EQUAL(0, s.rx_queue_overflow);
+    TEST_ASSERT_TRUE(s.rx_latency_max_us > 0);
+}
+
+int main( int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_inline_queue);
+    RUN_TEST(test_threaded_dispatch_stats);
+    UNITY_END();
+}
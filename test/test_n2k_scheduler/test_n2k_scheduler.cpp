@@ -0,0 +1,124 @@
+#include "N2KScheduler.h"
+#include <unity.h>
+
+struct FakeBus {
+    int sent = 0;
+    unsigned long send_time[64];
+    unsigned long pgn[64];
+    unsigned char priority[64];
+    unsigned long now = 0;
+};
+
+static bool fake_tx(const tN2kMsg &N2kMsg, void *context)
+{
+    FakeBus *bus = (FakeBus *)context;
+    if (bus->sent < 64)
+    {
+        bus->send_time[bus->sent] = bus->now;
+        bus->pgn[bus->sent] = N2kMsg.PGN;
+        bus->priority[bus->sent] = N2kMsg.Priority;
+    }
+    bus->sent++;
+    return true;
+}
+
+struct Producer {
+    unsigned long pgn;
+    int calls = 0;
+    unsigned char last_sid = 0;
+    bool skip = false;
+};
+
+static bool produce(tN2kMsg &N2kMsg, unsigned char sid, void *context)
+{
+    Producer *p = (Producer *)context;
+    p->calls++;
+    p->last_sid = sid;
+    if (p->skip) return false;
+    N2kMsg.SetPGN(p->pgn);
+    N2kMsg.AddByte(sid);
+    return true;
+}
+
+static void run(N2KScheduler &s, FakeBus &bus, unsigned long from, unsigned long to)
+{
+    for (unsigned long t = from; t < to; t++)
+    {
+        bus.now = t;
+        s.loop(t);
+    }
+}
+
+void test_phase_spreading() {
+    FakeBus bus;
+    N2KScheduler s(fake_tx, &bus);
+    Producer p[4] = {{130306}, {130310}, {130312}, {130313}};
+    for (int i = 0; i < 4; i++) TEST_ASSERT_EQUAL(i, s.add(1000, 5, produce, &p[i]));
+    run(s, bus, 10000, 11000);
+    TEST_ASSERT_EQUAL(4, bus.sent);
+    // one every 250ms, not all in the same ms
+    TEST_ASSERT_EQUAL(10000, bus.send_time[0]);
+    TEST_ASSERT_EQUAL(10250, bus.send_time[1]);
+    TEST_ASSERT_EQUAL(10500, bus.send_time[2]);
+    TEST_ASSERT_EQUAL(10750, bus.send_time[3]);
+    TEST_ASSERT_EQUAL(5, bus.priority[0]);
+    for (int i = 0; i < 4; i++) TEST_ASSERT_EQUAL(0, s.get_stats(i).jitter_max_ms);
+}
+
+void test_sid_and_skip() {
+    FakeBus bus;
+    N2KScheduler s(fake_tx, &bus);
+    Producer p = {127250};
+    int h = s.add(100, 2, produce, &p);
+    run(s, bus, 0, 300);
+    TEST_ASSERT_EQUAL(3, bus.sent);
+    TEST_ASSERT_EQUAL(3, p.last_sid);
+    p.skip = true;
+    run(s, bus, 300, 500);
+    TEST_ASSERT_EQUAL(3, bus.sent);
+    TEST_ASSERT_EQUAL(2, s.get_stats(h).skipped);
+    TEST_ASSERT_EQUAL(127250, s.get_stats(h).pgn);
+}
+
+void test_missed_deadlines() {
+    FakeBus bus;
+    N2KScheduler s(fake_tx, &bus);
+    Producer p = {127250};
+    int h = s.add(100, 2, produce, &p);
+    bus.now = 0;
+    s.loop(0);
+    // loop stalls for 350ms: one late transmission, no burst
+    bus.now = 350;
+    s.loop(350);
+    TEST_ASSERT_EQUAL(2, bus.sent);
+    N2KScheduleStats st = s.get_stats(h);
+    TEST_ASSERT_EQUAL(2, st.missed);
+    TEST_ASSERT_EQUAL(50, st.jitter_max_ms);
+    // back on the original phase
+    run(s, bus, 351, 401);
+    TEST_ASSERT_EQUAL(3, bus.sent);
+    TEST_ASSERT_EQUAL(400, bus.send_time[2]);
+}
+
+void test_remove() {
+    FakeBus bus;
+    N2KScheduler s(fake_tx, &bus);
+    Producer a = {130306};
+    Producer b = {130310};
+    int ha = s.add(1000, 5, produce, &a);
+    s.add(1000, 5, produce, &b);
+    s.remove(ha);
+    run(s, bus, 0, 1000);
+    TEST_ASSERT_EQUAL(1, bus.sent);
+    TEST_ASSERT_EQUAL(130310, bus.pgn[0]);
+    TEST_ASSERT_EQUAL(0, bus.send_time[0]);
+}
+
+int main( int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_phase_spreading);
+    RUN_TEST(test_sid_and_skip);
+    RUN_TEST(test_missed_deadlines);
+    RUN_TEST(test_remove);
+    UNITY_END();
+}
@@ -0,0 +1,92 @@
+#include "N2K.h"
+#include "N2KVirtualBus.h"
+#include <unity.h>
+
+static int ready = 0;
+static N2K *ready_instance = nullptr;
+
+static void on_ready(N2K *n2k)
+{
+    ready++;
+    ready_instance = n2k;
+}
+
+void setUp()
+{
+    ready = 0;
+    ready_instance = nullptr;
+}
+
+void test_setup_does_not_open() {
+    N2KVirtualBus bus;
+    N2K n2k;
+    n2k_device_info dvc;
+    n2k.set_virtual_bus(&bus);
+    n2k.set_ready_callback(on_ready);
+    n2k.setup(dvc);
+    TEST_ASSERT_EQUAL(N2K_STATE_OPENING, n2k.get_state());
+    TEST_ASSERT_EQUAL(0, n2k.getStats().open_attempts);
+    TEST_ASSERT_EQUAL(0, ready);
+
+    n2k.loop(5000);
+    TEST_ASSERT_EQUAL(N2K_STATE_READY, n2k.get_state());
+    TEST_ASSERT_TRUE(n2k.is_initialized());
+    TEST_ASSERT_EQUAL(1, n2k.getStats().open_attempts);
+    TEST_ASSERT_EQUAL(0, n2k.getStats().startup_open_ms);
+    TEST_ASSERT_EQUAL(1, ready);
+    TEST_ASSERT_TRUE(ready_instance == &n2k);
+}
+
+void test_open_backoff() {
+    N2KVirtualBus bus;
+    bus.set_open_failures(3);
+    N2K n2k;
+    n2k_device_info dvc;
+    n2k.set_virtual_bus(&bus);
+    n2k.set_ready_callback(on_ready);
+    n2k.setup(dvc);
+
+    // the times are the loop ones only: 1s, 2s, 4s between attempts
+    unsigned long t0 = 100000;
+    const unsigned long steps[][2] = {
+        {0, 1}, {999, 1}, {1000, 2}, {2999, 2}, {3000, 3}, {6999, 3}, {7000, 4}, {20000, 4}};
+    for (auto &s : steps)
+    {
+        n2k.loop(t0 + s[0]);
+        TEST_ASSERT_EQUAL(s[1], n2k.getStats().open_attempts);
+        TEST_ASSERT_EQUAL(s[1] == 4 ? 1 : 0, ready);
+    }
+    TEST_ASSERT_EQUAL(N2K_STATE_READY, n2k.get_state());
+    TEST_ASSERT_EQUAL(7000, n2k.getStats().startup_open_ms);
+}
+
+void test_open_backoff_max() {
+    N2KVirtualBus bus;
+    bus.set_open_failures(1000);
+    N2K n2k;
+    n2k_device_info dvc;
+    n2k.set_virtual_bus(&bus);
+    n2k.set_ready_callback(on_ready);
+    n2k.setup(dvc);
+
+    // one loop per second for 5 minutes
+    for (unsigned long t = 0; t <= 300000; t += 1000) n2k.loop(t);
+    // 0, 1, 3, 7, 15, 31 then every 30s: 61 ... 271
+    TEST_ASSERT_EQUAL(6 + 8, n2k.getStats().open_attempts);
+    TEST_ASSERT_EQUAL(N2K_STATE_OPENING, n2k.get_state());
+    TEST_ASSERT_EQUAL(0, ready);
+
+    bus.set_open_failures(0);
+    n2k.loop(300000 + N2K_OPEN_RETRY_MAX_MS);
+    TEST_ASSERT_EQUAL(N2K_STATE_READY, n2k.get_state());
+    n2k.loop(400000);
+    TEST_ASSERT_EQUAL(1, ready);
+}
+
+int main( int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_setup_does_not_open);
+    RUN_TEST(test_open_backoff);
+    RUN_TEST(test_open_backoff_max);
+    UNITY_END();
+}
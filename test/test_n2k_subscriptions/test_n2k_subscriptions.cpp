@@ -0,0 +1,95 @@
+#include "N2KSubscriptions.h"
+#include "N2K.h"
+#include <unity.h>
+#include "../n2k_test_helpers.h"
+
+struct Counter {
+    int calls = 0;
+    unsigned long last_pgn = 0;
+};
+
+static void count_handler(const tN2kMsg &N2kMsg, void *context)
+{
+    Counter *c = (Counter *)context;
+    c->calls++;
+    c->last_pgn = N2kMsg.PGN;
+}
+
+void test_dispatch_by_pgn() {
+    N2KSubscriptions subs;
+    Counter heading, wind;
+    subs.subscribe(127250, count_handler, &heading);
+    subs.subscribe(130306, count_handler, &wind);
+
+    TEST_ASSERT_EQUAL(1, subs.dispatch(make_msg(127250, 10)));
+    TEST_ASSERT_EQUAL(1, subs.dispatch(make_msg(130306, 10)));
+    TEST_ASSERT_EQUAL(0, subs.dispatch(make_msg(129025, 10)));
+    TEST_ASSERT_EQUAL(1, heading.calls);
+    TEST_ASSERT_EQUAL(1, wind.calls);
+    TEST_ASSERT_EQUAL(130306, wind.last_pgn);
+}
+
+void test_dispatch_by_source() {
+    N2KSubscriptions subs;
+    Counter any, only_src_5;
+    subs.subscribe(127250, count_handler, &any);
+    subs.subscribe(127250, count_handler, &only_src_5, 5);
+
+    TEST_ASSERT_EQUAL(2, subs.dispatch(make_msg(127250, 5)));
+    TEST_ASSERT_EQUAL(1, subs.dispatch(make_msg(127250, 6)));
+    TEST_ASSERT_EQUAL(2, any.calls);
+    TEST_ASSERT_EQUAL(1, only_src_5.calls);
+}
+
+void test_unsubscribe() {
+    N2KSubscriptions subs;
+    Counter c;
+    int h = subs.subscribe(127250, count_handler, &c);
+    unsigned long v = subs.get_version();
+    TEST_ASSERT_TRUE(subs.is_subscribed(127250));
+    TEST_ASSERT_TRUE(subs.unsubscribe(h));
+    TEST_ASSERT_FALSE(subs.unsubscribe(h));
+    TEST_ASSERT_FALSE(subs.is_subscribed(127250));
+    TEST_ASSERT_TRUE(subs.empty());
+    TEST_ASSERT_TRUE(subs.get_version() != v);
+    TEST_ASSERT_EQUAL(0, subs.dispatch(make_msg(127250, 5)));
+}
+
+void test_registry_full() {
+    N2KSubscriptions subs;
+    Counter c;
+    for (int i = 0; i < N2K_MAX_SUBSCRIPTIONS; i++)
+    {
+        TEST_ASSERT_EQUAL(i, subs.subscribe(126000 + i, count_handler, &c));
+    }
+    TEST_ASSERT_EQUAL(-1, subs.subscribe(127250, count_handler, &c));
+    for (int i = 0; i < N2K_MAX_SUBSCRIPTIONS; i++)
+    {
+        TEST_ASSERT_EQUAL(1, subs.dispatch(make_msg(126000 + i, 1)));
+    }
+    TEST_ASSERT_EQUAL(N2K_MAX_SUBSCRIPTIONS, c.calls);
+}
+
+void test_frozen_with_rx_thread() {
+    N2K n2k;
+    Counter c;
+    int h = n2k.subscribe(127250, count_handler, &c);
+    TEST_ASSERT_TRUE(h >= 0);
+    n2k.enable_rx_queue(true);
+    // the consumer thread dispatches from now on, the registry cannot change
+    TEST_ASSERT_EQUAL(-1, n2k.subscribe(130306, count_handler, &c));
+    TEST_ASSERT_NULL(n2k.enable_decode(127250));
+    n2k.unsubscribe(h);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_dispatch_by_pgn);
+    RUN_TEST(test_dispatch_by_source);
+    RUN_TEST(test_unsubscribe);
+    RUN_TEST(test_registry_full);
+    RUN_TEST(test_frozen_with_rx_thread);
+    UNITY_END();
+    return 0;
+}
@@ -0,0 +1,183 @@
+#include "N2KTxQueue.h"
+#include "N2K.h"
+#include "N2KVirtualBus.h"
+#include <unity.h>
+#include "../n2k_test_helpers.h"
+
+struct FakeBus {
+    bool accept = true;
+    int sent = 0;
+    int ok = 0;
+    int failed = 0;
+    unsigned long last_pgn = 0;
+};
+
+static bool fake_tx(const tN2kMsg &N2kMsg, void *context)
+{
+    FakeBus *bus = (FakeBus *)context;
+    if (!bus->accept) return false;
+    bus->sent++;
+    bus->last_pgn = N2kMsg.PGN;
+    return true;
+}
+
+static void fake_result(const tN2kMsg &N2kMsg, bool success, void *context)
+{
+    FakeBus *bus = (FakeBus *)context;
+    if (success) bus->ok++; else bus->failed++;
+}
+
+void test_priority_classes() {
+    TEST_ASSERT_EQUAL(N2K_TX_HIGH, N2KTxQueue::get_class(2));
+    TEST_ASSERT_EQUAL(N2K_TX_NORMAL, N2KTxQueue::get_class(3));
+    TEST_ASSERT_EQUAL(N2K_TX_NORMAL, N2KTxQueue::get_class(5));
+    TEST_ASSERT_EQUAL(N2K_TX_LOW, N2KTxQueue::get_class(6));
+}
+
+void test_direct_send() {
+    FakeBus bus;
+    N2KTxQueue q(fake_tx, fake_result, &bus);
+    TEST_ASSERT_TRUE(q.send(make_msg(127250, 22, 2), 0));
+    TEST_ASSERT_EQUAL(1, bus.sent);
+    TEST_ASSERT_EQUAL(1, bus.ok);
+    TEST_ASSERT_FALSE(q.has_pending(N2K_TX_LOW));
+}
+
+void test_retry_high_priority_first() {
+    FakeBus bus;
+    N2KTxQueue q(fake_tx, fake_result, &bus);
+    bus.accept = false;
+    q.send(make_msg(130312, 22, 6), 0);
+    q.send(make_msg(127250, 22, 2), 0);
+    TEST_ASSERT_EQUAL(1, q.get_stats(N2K_TX_HIGH).depth);
+    TEST_ASSERT_EQUAL(1, q.get_stats(N2K_TX_LOW).depth);
+
+    bus.accept = true;
+    // a low priority message cannot overtake what is waiting
+    q.send(make_msg(130313, 22, 7), 10);
+    TEST_ASSERT_EQUAL(0, bus.sent);
+
+    q.flush(20);
+    TEST_ASSERT_EQUAL(3, bus.sent);
+    TEST_ASSERT_EQUAL(130313, bus.last_pgn);
+    TEST_ASSERT_FALSE(q.has_pending(N2K_TX_LOW));
+}
+
+void test_stale_low_priority_dropped() {
+    FakeBus bus;
+    N2KTxQueue q(fake_tx, fake_result, &bus);
+    bus.accept = false;
+    q.send(make_msg(130312, 22, 6), 0);
+    q.send(make_msg(127250, 22, 2), 0);
+    bus.accept = true;
+    q.flush(N2K_TX_LOW_MAX_AGE + 1);
+    TEST_ASSERT_EQUAL(1, bus.sent);
+    TEST_ASSERT_EQUAL(127250, bus.last_pgn);
+    TEST_ASSERT_EQUAL(1, q.get_stats(N2K_TX_LOW).stale);
+    TEST_ASSERT_EQUAL(1, bus.failed);
+}
+
+void test_overflow_drops_oldest() {
+    FakeBus bus;
+    N2KTxQueue q(fake_tx, fake_result, &bus);
+    bus.accept = false;
+    for (int i = 0; i < N2K_TX_QUEUE_SIZE + 2; i++)
+    {
+        q.send(make_msg(127250, 22, 2), 0);
+    }
+    TEST_ASSERT_EQUAL(N2K_TX_QUEUE_SIZE, q.get_stats(N2K_TX_HIGH).depth);
+    TEST_ASSERT_EQUAL(N2K_TX_QUEUE_SIZE, q.get_stats(N2K_TX_HIGH).hwm);
+    TEST_ASSERT_EQUAL(2, q.get_stats(N2K_TX_HIGH).dropped);
+}
+
+void test_held_class() {
+    FakeBus bus;
+    N2KTxQueue q(fake_tx, fake_result, &bus);
+    q.set_hold(N2K_TX_LOW, true);
+    q.send(make_msg(130312, 22, 6), 0);
+    q.send(make_msg(127250, 22, 2), 0);
+    TEST_ASSERT_EQUAL(1, bus.sent);
+    TEST_ASSERT_EQUAL(1, q.get_stats(N2K_TX_LOW).depth);
+    q.flush(10);
+    TEST_ASSERT_EQUAL(1, bus.sent);
+
+    q.set_hold(N2K_TX_LOW, false);
+    q.flush(20);
+    TEST_ASSERT_EQUAL(2, bus.sent);
+    TEST_ASSERT_EQUAL(130312, bus.last_pgn);
+    TEST_ASSERT_FALSE(q.has_pending(N2K_TX_LOW));
+}
+
+void test_n2k_reset_stats() {
+    // 1 bps: the bus takes the first frames and stays busy, the others queue up
+    N2KVirtualBus bus(1);
+    N2K n2k;
+    start_on_bus(n2k, bus, 0);
+    n2k.enable_tx_queue();
+    N2KPgnStats *pgn_stats = n2k.enable_pgn_stats();
+    tN2kMsg m = make_msg(130312, 22, 6);
+    int n = N2K_VIRTUAL_NODE_TX_BACKLOG + N2K_TX_QUEUE_SIZE + 5;
+    for (int i = 0; i < n; i++) TEST_ASSERT_TRUE(n2k.send_msg(m, false));
+
+    N2KStats s = n2k.getStats();
+    unsigned long sent = s.sent;
+    TEST_ASSERT_TRUE(sent > 0);
+    TEST_ASSERT_EQUAL(N2K_TX_QUEUE_SIZE, s.tx[N2K_TX_LOW].depth);
+    TEST_ASSERT_EQUAL(N2K_TX_QUEUE_SIZE, s.tx[N2K_TX_LOW].hwm);
+    TEST_ASSERT_EQUAL(n - sent - N2K_TX_QUEUE_SIZE, s.tx[N2K_TX_LOW].dropped);
+    TEST_ASSERT_TRUE(s.tx[N2K_TX_LOW].dropped > 0);
+
+    // resetting a snapshot does not touch the instance
+    s.reset();
+    TEST_ASSERT_EQUAL(n - sent - N2K_TX_QUEUE_SIZE, n2k.getStats().tx[N2K_TX_LOW].dropped);
+    TEST_ASSERT_EQUAL(sent, n2k.getStats().sent);
+
+    n2k.reset_stats();
+    s = n2k.getStats();
+    TEST_ASSERT_EQUAL(0, s.sent);
+    TEST_ASSERT_EQUAL(0, s.fail);
+    TEST_ASSERT_EQUAL(0, s.tx[N2K_TX_LOW].dropped);
+    TEST_ASSERT_EQUAL(N2K_TX_QUEUE_SIZE, s.tx[N2K_TX_LOW].depth);
+    TEST_ASSERT_EQUAL(N2K_TX_QUEUE_SIZE, s.tx[N2K_TX_LOW].hwm);
+    N2KPgnCounters c;
+    TEST_ASSERT_EQUAL(1, pgn_stats->snapshot(&c, 1));
+    TEST_ASSERT_EQUAL(0, c.sent);
+    TEST_ASSERT_EQUAL(0, c.fail);
+}
+
+void test_n2k_queue_loop_clock() {
+    // 10 kbps: a frame takes some ms, so a burst fills the node backlog and queues up
+    N2KVirtualBus bus(10000);
+    N2K n2k;
+    // a loop clock unrelated to _millis()
+    unsigned long t = 1000;
+    start_on_bus(n2k, bus, t);
+    n2k.enable_tx_queue();
+    tN2kMsg m = make_msg(130312, 22, 6);
+    for (int i = 0; i < N2K_VIRTUAL_NODE_TX_BACKLOG + 4; i++) TEST_ASSERT_TRUE(n2k.send_msg(m, false));
+    int queued = n2k.getStats().tx[N2K_TX_LOW].depth;
+    TEST_ASSERT_TRUE(queued > 0);
+
+    // let the bus drain, the queued messages are not stale on the loop clock
+    msleep(200);
+    n2k.loop(t + 10);
+    N2KStats s = n2k.getStats();
+    TEST_ASSERT_EQUAL(0, s.tx[N2K_TX_LOW].stale);
+    TEST_ASSERT_EQUAL(0, s.tx[N2K_TX_LOW].depth);
+    TEST_ASSERT_EQUAL(N2K_VIRTUAL_NODE_TX_BACKLOG + 4, s.sent);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_priority_classes);
+    RUN_TEST(test_direct_send);
+    RUN_TEST(test_retry_high_priority_first);
+    RUN_TEST(test_stale_low_priority_dropped);
+    RUN_TEST(test_overflow_drops_oldest);
+    RUN_TEST(test_held_class);
+    RUN_TEST(test_n2k_reset_stats);
+    RUN_TEST(test_n2k_queue_loop_clock);
+    UNITY_END();
+    return 0;
+}
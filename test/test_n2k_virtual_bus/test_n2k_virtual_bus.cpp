@@ -0,0 +1,166 @@
+#include "N2KVirtualBus.h"
+#include "Utils.h"
+#include <N2kMessages.h>
+#include <unity.h>
+
+static int received = 0;
+static tN2kMsg last_msg;
+
+static void on_msg(const tN2kMsg &N2kMsg)
+{
+    if (N2kMsg.PGN == 127250 || N2kMsg.PGN == 129029)
+    {
+        received++;
+        last_msg = N2kMsg;
+    }
+}
+
+static void setup_node(tNMEA2000 *node, unsigned char source, unsigned long unique_number)
+{
+    node->SetProductInformation("00000001", 100, "Virtual node", "1.0.0", "1.0.0");
+    node->SetDeviceInformation(unique_number, 130, 25, 2046);
+    node->SetMode(tNMEA2000::N2km_ListenAndNode, source);
+}
+
+static void run(tNMEA2000 *a, tNMEA2000 *b, unsigned long ms)
+{
+    unsigned long t0 = _millis();
+    while ((_millis() - t0) < ms)
+    {
+        a->ParseMessages();
+        b->ParseMessages();
+        msleep(1);
+    }
+}
+
+static bool start(tNMEA2000 *a, tNMEA2000 *b)
+{
+    setup_node(a, 22, 1);
+    setup_node(b, 23, 2);
+    b->SetMsgHandler(on_msg);
+    for (int i = 0; i < 100; i++)
+    {
+        bool open_a = a->Open();
+        bool open_b = b->Open();
+        if (open_a && open_b)
+        {
+            // let the address claim settle
+            run(a, b, 500);
+            return true;
+        }
+        msleep(10);
+    }
+    return false;
+}
+
+void setUp()
+{
+    received = 0;
+}
+
+void tearDown() {}
+
+void test_single_frame_delivery() {
+    N2KVirtualBus bus;
+    tNMEA2000_virtual *a = bus.create_node();
+    tNMEA2000_virtual *b = bus.create_node();
+    TEST_ASSERT_TRUE(start(a, b));
+
+    tN2kMsg m;
+    SetN2kPGN127250(m, 1, DegToRad(90.0), N2kDoubleNA, N2kDoubleNA, N2khr_magnetic);
+    TEST_ASSERT_TRUE(a->SendMsg(m));
+    run(a, b, 50);
+    TEST_ASSERT_EQUAL(1, received);
+    TEST_ASSERT_EQUAL(127250, last_msg.PGN);
+    TEST_ASSERT_EQUAL(22, last_msg.Source);
+    TEST_ASSERT_GREATER_THAN(0, bus.get_stats().bits);
+    delete a;
+    delete b;
+}
+
+void test_fast_packet_delivery() {
+    N2KVirtualBus bus;
+    tNMEA2000_virtual *a = bus.create_node();
+    tNMEA2000_virtual *b = bus.create_node();
+    TEST_ASSERT_TRUE(start(a, b));
+
+    tN2kMsg m;
+    SetN2kPGN129029(m, 1, 19000, 3600.0, 44.0, 9.0, 10.0, N2kGNSSt_GPS, N2kGNSSm_GNSSfix, 8, 1.0);
+    unsigned long frames = bus.get_stats().frames;
+    TEST_ASSERT_TRUE(a->SendMsg(m));
+    run(a, b, 50);
+    TEST_ASSERT_EQUAL(1, received);
+    TEST_ASSERT_EQUAL(129029, last_msg.PGN);
+    TEST_ASSERT_EQUAL(m.DataLen, last_msg.DataLen);
+    TEST_ASSERT_GREATER_THAN(1, bus.get_stats().frames - frames);
+    delete a;
+    delete b;
+}
+
+void test_drop_injection() {
+    N2KVirtualBus bus;
+    tNMEA2000_virtual *a = bus.create_node();
+    tNMEA2000_virtual *b = bus.create_node();
+    TEST_ASSERT_TRUE(start(a, b));
+
+    bus.set_drop_rate(1.0);
+    tN2kMsg m;
+    SetN2kPGN127250(m, 1, DegToRad(90.0), N2kDoubleNA, N2kDoubleNA, N2khr_magnetic);
+    a->SendMsg(m);
+    run(a, b, 50);
+    TEST_ASSERT_EQUAL(0, received);
+    TEST_ASSERT_GREATER_THAN(0, bus.get_stats().dropped);
+    delete a;
+    delete b;
+}
+
+void test_bus_full() {
+    N2KVirtualBus bus;
+    tNMEA2000_virtual *nodes[N2K_VIRTUAL_BUS_MAX_NODES];
+    for (int i = 0; i < N2K_VIRTUAL_BUS_MAX_NODES; i++)
+    {
+        nodes[i] = bus.create_node();
+        TEST_ASSERT_NOT_NULL(nodes[i]);
+    }
+    TEST_ASSERT_NULL(bus.create_node());
+    for (int i = 0; i < N2K_VIRTUAL_BUS_MAX_NODES; i++) delete nodes[i];
+}
+
+void test_backlog_per_node() {
+    // 1 bps: nothing leaves the bus during the test
+    N2KVirtualBus bus(1);
+    tNMEA2000_virtual *a = bus.create_node();
+    tNMEA2000_virtual *b = bus.create_node();
+    setup_node(a, 22, 1);
+    setup_node(b, 23, 2);
+    TEST_ASSERT_TRUE(a->Open());
+    TEST_ASSERT_TRUE(b->Open());
+
+    // single frame messages
+    tN2kMsg m(22, 2, 127250);
+    unsigned char data[8] = {1, 0, 0, 0xFF, 0x7F, 0xFF, 0x7F, 0xFD};
+    for (int i = 0; i < 8; i++) m.AddByte(data[i]);
+    // the frame on the wire plus the backlog, for each sender
+    for (int i = 0; i <= N2K_VIRTUAL_NODE_TX_BACKLOG; i++) TEST_ASSERT_TRUE(a->SendMsg(m));
+    TEST_ASSERT_FALSE(a->SendMsg(m));
+    for (int i = 0; i <= N2K_VIRTUAL_NODE_TX_BACKLOG; i++) TEST_ASSERT_TRUE(b->SendMsg(m));
+    TEST_ASSERT_FALSE(b->SendMsg(m));
+    for (int i = 0; i <= N2K_VIRTUAL_NODE_TX_BACKLOG; i++) TEST_ASSERT_TRUE(bus.inject(0x09F11202, 8, data));
+    TEST_ASSERT_FALSE(bus.inject(0x09F11202, 8, data));
+    TEST_ASSERT_EQUAL(3 * (N2K_VIRTUAL_NODE_TX_BACKLOG + 1), bus.get_stats().frames);
+    TEST_ASSERT_GREATER_THAN(0, bus.get_stats().rejected);
+    bus.destroy_node(a);
+    bus.destroy_node(b);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_single_frame_delivery);
+    RUN_TEST(test_fast_packet_delivery);
+    RUN_TEST(test_drop_injection);
+    RUN_TEST(test_bus_full);
+    RUN_TEST(test_backlog_per_node);
+    UNITY_END();
+    return 0;
+}
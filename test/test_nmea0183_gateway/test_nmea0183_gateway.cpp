@@ -0,0 +1,239 @@
+#include "NMEA0183Gateway.h"
+#include <N2kMessages.h>
+#include <unity.h>
+#include <string>
+
+#define MAX_SENT 32
+
+static tN2kMsg sent[MAX_SENT];
+static int n_sent = 0;
+
+static bool fake_tx(const tN2kMsg &N2kMsg, void *context)
+{
+    if (n_sent < MAX_SENT) sent[n_sent++] = N2kMsg;
+    return true;
+}
+
+static void feed(NMEA0183Parser &p, const char *line)
+{
+    TEST_ASSERT_TRUE(p.parse(line, strlen(line)));
+}
+
+static int find(unsigned long pgn, int from = 0)
+{
+    for (int i = from; i < n_sent; i++) if (sent[i].PGN == pgn) return i;
+    return -1;
+}
+
+void setUp()
+{
+    n_sent = 0;
+}
+
+void tearDown() {}
+
+void test_fix_cycle_merged() {
+    NMEA0183Gateway gw(fake_tx, nullptr);
+    NMEA0183Parser p(&gw);
+    feed(p, "$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6A");
+    feed(p, "$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47");
+    feed(p, "$GPVTG,054.7,T,034.4,M,005.5,N,010.2,K*48");
+    // the first cycle does not know which sentences to expect: flushed by the timeout,
+    // on the loop clock only
+    TEST_ASSERT_EQUAL(0, n_sent);
+    gw.loop(1000);
+    gw.loop(1000 + NMEA0183_GATEWAY_CYCLE_MS - 1);
+    TEST_ASSERT_EQUAL(0, n_sent);
+    gw.loop(1000 + NMEA0183_GATEWAY_CYCLE_MS);
+    TEST_ASSERT_EQUAL(5, n_sent);
+    TEST_ASSERT_EQUAL(1, gw.get_stats().cycles);
+    TEST_ASSERT_EQUAL(1, gw.get_stats().batches);
+
+    int i = find(129025);
+    TEST_ASSERT_TRUE(i >= 0);
+    double lat, lon;
+    TEST_ASSERT_TRUE(ParseN2kPGN129025(sent[i], lat, lon));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-9, 48 + 7.038 / 60, lat);
+
+    // COG/SOG: VTG, the last sentence of the cycle, wins
+    unsigned char sid_cog, sid_time, sid_gnss;
+    tN2kHeadingReference ref;
+    double cog, sog;
+    TEST_ASSERT_TRUE(ParseN2kPGN129026(sent[find(129026)], sid_cog, ref, cog, sog));
+    TEST_ASSERT_EQUAL(N2khr_true, ref);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-6, DegToRad(54.7), cog);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-6, 5.5 * 1852.0 / 3600.0, sog);
+
+    uint16_t days;
+    double seconds;
+    tN2kTimeSource ts;
+    TEST_ASSERT_TRUE(ParseN2kPGN126992(sent[find(126992)], sid_time, days, seconds, ts));
+    TEST_ASSERT_EQUAL(getDaysSince1970(1994, 3, 23), days);
+    TEST_ASSERT_EQUAL_DOUBLE(12 * 3600 + 35 * 60 + 19, seconds);
+
+    uint16_t gdays, ref_id;
+    double gsec, glat, glon, alt, hdop, pdop, geoid, age;
+    tN2kGNSStype type, ref_type;
+    tN2kGNSSmethod method;
+    unsigned char sats, n_ref;
+    TEST_ASSERT_TRUE(ParseN2kPGN129029(sent[find(129029)], sid_gnss, gdays, gsec, glat, glon, alt, type, method, sats, hdop, pdop, geoid, n_ref, ref_type, ref_id, age));
+    TEST_ASSERT_EQUAL(days, gdays);
+    TEST_ASSERT_EQUAL(N2kGNSSm_GNSSfix, method);
+    TEST_ASSERT_EQUAL(8, sats);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-6, 545.4, alt);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-6, 46.9, geoid);
+
+    unsigned char sid_var;
+    tN2kMagneticVariation var_src;
+    uint16_t var_days;
+    double variation;
+    TEST_ASSERT_TRUE(ParseN2kPGN127258(sent[find(127258)], sid_var, var_src, var_days, variation));
+    TEST_ASSERT_EQUAL(days, var_days);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-6, DegToRad(-3.1), variation);
+
+    // one SID for the whole fix
+    TEST_ASSERT_EQUAL(sid_cog, sid_time);
+    TEST_ASSERT_EQUAL(sid_cog, sid_gnss);
+    TEST_ASSERT_EQUAL(sid_cog, sid_var);
+
+    // next fix: the cycle closes as soon as RMC, GGA and VTG arrived, with a new SID
+    n_sent = 0;
+    feed(p, "$GPRMC,123520,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*60");
+    feed(p, "$GPGGA,123520,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*4D");
+    TEST_ASSERT_EQUAL(0, n_sent);
+    feed(p, "$GPVTG,054.7,T,034.4,M,005.5,N,010.2,K*48");
+    TEST_ASSERT_EQUAL(5, n_sent);
+    unsigned char sid2;
+    TEST_ASSERT_TRUE(ParseN2kPGN129026(sent[find(129026)], sid2, ref, cog, sog));
+    TEST_ASSERT_TRUE(sid2 != sid_cog);
+}
+
+void test_new_time_closes_cycle() {
+    NMEA0183Gateway gw(fake_tx, nullptr);
+    NMEA0183Parser p(&gw);
+    // a receiver sending RMC only
+    feed(p, "$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6A");
+    TEST_ASSERT_EQUAL(0, n_sent);
+    feed(p, "$GPRMC,123520,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*60");
+    // the new time closes the first cycle; RMC has no GNSS details: position, COG/SOG,
+    // variation and time
+    TEST_ASSERT_EQUAL(0, find(129025));
+    TEST_ASSERT_EQUAL(-1, find(129029));
+    // and from now on RMC alone completes the cycle, so the second one is flushed right away
+    TEST_ASSERT_EQUAL(8, n_sent);
+    feed(p, "$GPRMC,123521,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*61");
+    TEST_ASSERT_EQUAL(12, n_sent);
+    TEST_ASSERT_EQUAL(3, gw.get_stats().cycles);
+}
+
+void test_no_fix() {
+    NMEA0183Gateway gw(fake_tx, nullptr);
+    NMEA0183Parser p(&gw);
+    feed(p, "$GPRMC,,V,,,,,,,,,,N");
+    gw.loop(0);
+    gw.loop(NMEA0183_GATEWAY_CYCLE_MS);
+    TEST_ASSERT_EQUAL(0, n_sent);
+    TEST_ASSERT_EQUAL(1, gw.get_stats().ignored);
+}
+
+void test_instruments() {
+    NMEA0183Gateway gw(fake_tx, nullptr);
+    NMEA0183Parser p(&gw);
+    unsigned char sid;
+    double a, b, c;
+
+    feed(p, "$SDDPT,12.3,-0.5,100*52");
+    TEST_ASSERT_EQUAL(1, n_sent);
+    TEST_ASSERT_TRUE(ParseN2kPGN128267(sent[0], sid, a, b, c));
+    TEST_ASSERT_EQUAL_DOUBLE(12.3, a);
+    TEST_ASSERT_EQUAL_DOUBLE(-0.5, b);
+
+    n_sent = 0;
+    feed(p, "$IIHDG,238.5,,,2.1,E*2D");
+    tN2kHeadingReference ref;
+    TEST_ASSERT_TRUE(ParseN2kPGN127250(sent[0], sid, a, b, c, ref));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-6, DegToRad(238.5), a);
+    TEST_ASSERT_TRUE(N2kIsNA(b));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-6, DegToRad(2.1), c);
+    TEST_ASSERT_EQUAL(N2khr_magnetic, ref);
+
+    n_sent = 0;
+    feed(p, "$IIMWV,045.0,R,12.4,N,A*0B");
+    tN2kWindReference wref;
+    TEST_ASSERT_TRUE(ParseN2kPGN130306(sent[0], sid, a, b, wref));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-6, 12.4 * 1852.0 / 3600.0, a);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-6, DegToRad(45.0), b);
+    TEST_ASSERT_EQUAL(N2kWind_Apparent, wref);
+
+    // speed and heading from one VHW share the SID
+    n_sent = 0;
+    feed(p, "$VWVHW,,T,210.0,M,6.10,N,11.30,K*4D");
+    TEST_ASSERT_EQUAL(2, n_sent);
+    unsigned char sid_h;
+    tN2kSpeedWaterReferenceType swrt;
+    TEST_ASSERT_TRUE(ParseN2kPGN128259(sent[find(128259)], sid, a, b, swrt));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-6, 6.1 * 1852.0 / 3600.0, a);
+    TEST_ASSERT_TRUE(ParseN2kPGN127250(sent[find(127250)], sid_h, a, b, c, ref));
+    TEST_ASSERT_EQUAL(sid, sid_h);
+    TEST_ASSERT_EQUAL(N2khr_magnetic, ref);
+
+    n_sent = 0;
+    feed(p, "$IIXDR,C,19.5,C,AIRTEMP,P,1.0132,B,BARO*18");
+    TEST_ASSERT_EQUAL(2, n_sent);
+    unsigned char instance;
+    tN2kTempSource tsrc;
+    tN2kPressureSource psrc;
+    TEST_ASSERT_TRUE(ParseN2kPGN130316(sent[find(130316)], sid, instance, tsrc, a, b));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-6, 19.5 + 273.15, a);
+    TEST_ASSERT_EQUAL(N2kts_OutsideTemperature, tsrc);
+    TEST_ASSERT_TRUE(ParseN2kPGN130314(sent[find(130314)], sid_h, instance, psrc, a));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-3, 101320.0, a);
+    TEST_ASSERT_EQUAL(1, instance);
+    TEST_ASSERT_EQUAL(sid, sid_h);
+}
+
+void test_instruments_during_cycle() {
+    NMEA0183Gateway gw(fake_tx, nullptr);
+    NMEA0183Parser p(&gw);
+    feed(p, "$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6A");
+    feed(p, "$SDDPT,12.3,-0.5,100*52");
+    // depth is not held back by the open fix cycle
+    TEST_ASSERT_EQUAL(1, n_sent);
+    TEST_ASSERT_EQUAL(128267, sent[0].PGN);
+    gw.flush();
+    TEST_ASSERT_EQUAL(5, n_sent);
+}
+
+void test_xdr_full_batch() {
+    NMEA0183Gateway gw(fake_tx, nullptr);
+    NMEA0183Parser p(&gw);
+    // as many measures as the parser decodes, every one converted
+    std::string xdr = "$IIXDR";
+    for (int i = 0; i < NMEA0183_MAX_XDR; i++) xdr += ",C," + std::to_string(10 + i) + ",C,TEMP" + std::to_string(i);
+    feed(p, xdr.c_str());
+    TEST_ASSERT_EQUAL(NMEA0183_MAX_XDR, n_sent);
+    unsigned char sid0 = 0;
+    for (int i = 0; i < NMEA0183_MAX_XDR; i++)
+    {
+        unsigned char sid, instance;
+        tN2kTempSource tsrc;
+        double t, set;
+        TEST_ASSERT_TRUE(ParseN2kPGN130316(sent[i], sid, instance, tsrc, t, set));
+        if (i == 0) sid0 = sid;
+        TEST_ASSERT_EQUAL(i, instance);
+        TEST_ASSERT_EQUAL(sid0, sid);
+        TEST_ASSERT_DOUBLE_WITHIN(1e-6, 10 + i + 273.15, t);
+    }
+    TEST_ASSERT_EQUAL((NMEA0183_MAX_XDR + NMEA0183_GATEWAY_MAX_BATCH - 1) / NMEA0183_GATEWAY_MAX_BATCH, gw.get_stats().batches);
+}
+
+int main( int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_fix_cycle_merged);
+    RUN_TEST(test_new_time_closes_cycle);
+    RUN_TEST(test_no_fix);
+    RUN_TEST(test_instruments);
+    RUN_TEST(test_instruments_during_cycle);
+    RUN_TEST(test_xdr_full_batch);
+    UNITY_END();
+}
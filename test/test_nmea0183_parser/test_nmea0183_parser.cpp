@@ -0,0 +1,249 @@
+#include "NMEA0183Parser.h"
+#include "MockPort.hpp"
+#include "Utils.h"
+#include <unity.h>
+#include <math.h>
+#include <new>
+#include <stdio.h>
+
+#define BENCH_ROUNDS 20000
+
+// counts the heap allocations, to check that parsing does not touch the heap
+static unsigned long allocations = 0;
+
+void *operator new(size_t size)
+{
+    allocations++;
+    void *p = malloc(size);
+    if (p == nullptr) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+// a replayed GPS/instruments log
+static const char *LOG[] = {
+    "$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6A",
+    "$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47",
+    "$GPVTG,054.7,T,034.4,M,005.5,N,010.2,K*48",
+    "$IIHDG,238.5,,,2.1,E*2D",
+    "$IIMWV,045.0,R,12.4,N,A*0B",
+    "$SDDPT,12.3,-0.5,100*52",
+    "$VWVHW,,T,210.0,M,6.10,N,11.30,K*4D",
+    "$IIXDR,C,19.5,C,AIRTEMP,P,1.0132,B,BARO*18",
+    "$PGRME,15.0,M,45.0,M,25.0,M*1C",
+};
+#define LOG_LINES (int)(sizeof(LOG) / sizeof(LOG[0]))
+
+class Collector: public NMEA0183Handler
+{
+public:
+    int sentences = 0;
+    int typed = 0;
+    NMEA0183RMC rmc;
+    NMEA0183GGA gga;
+    NMEA0183VTG vtg;
+    NMEA0183HDG hdg;
+    NMEA0183MWV mwv;
+    NMEA0183DPT dpt;
+    NMEA0183VHW vhw;
+    int xdr_n = 0;
+    char xdr_type[NMEA0183_MAX_XDR];
+    double xdr_value[NMEA0183_MAX_XDR];
+    char xdr_name[NMEA0183_MAX_XDR][16];
+    char last_talker[8];
+    char last_type[16];
+
+    virtual void on_sentence(const NMEA0183Sentence &s)
+    {
+        sentences++;
+        snprintf(last_talker, sizeof(last_talker), "%.*s", (int)s.talker.size(), s.talker.data());
+        snprintf(last_type, sizeof(last_type), "%.*s", (int)s.type.size(), s.type.data());
+    }
+    virtual void on_rmc(const NMEA0183RMC &v, const NMEA0183Sentence &s) { rmc = v; typed++; }
+    virtual void on_gga(const NMEA0183GGA &v, const NMEA0183Sentence &s) { gga = v; typed++; }
+    virtual void on_vtg(const NMEA0183VTG &v, const NMEA0183Sentence &s) { vtg = v; typed++; }
+    virtual void on_hdg(const NMEA0183HDG &v, const NMEA0183Sentence &s) { hdg = v; typed++; }
+    virtual void on_mwv(const NMEA0183MWV &v, const NMEA0183Sentence &s) { mwv = v; typed++; }
+    virtual void on_dpt(const NMEA0183DPT &v, const NMEA0183Sentence &s) { dpt = v; typed++; }
+    virtual void on_vhw(const NMEA0183VHW &v, const NMEA0183Sentence &s) { vhw = v; typed++; }
+    virtual void on_xdr(const NMEA0183XDR &v, const NMEA0183Sentence &s)
+    {
+        typed++;
+        xdr_n = v.n_measures;
+        for (int i = 0; i < v.n_measures; i++)
+        {
+            xdr_type[i] = v.measures[i].type;
+            xdr_value[i] = v.measures[i].value;
+            snprintf(xdr_name[i], sizeof(xdr_name[i]), "%.*s", (int)v.measures[i].name.size(), v.measures[i].name.data());
+        }
+    }
+};
+
+static bool parse(NMEA0183Parser &p, const char *line)
+{
+    return p.parse(line, strlen(line));
+}
+
+void test_to_double() {
+    TEST_ASSERT_EQUAL_DOUBLE(22.4, NMEA0183Parser::to_double("022.4"));
+    TEST_ASSERT_EQUAL_DOUBLE(-0.5, NMEA0183Parser::to_double("-0.5"));
+    TEST_ASSERT_EQUAL_DOUBLE(100.0, NMEA0183Parser::to_double("100"));
+    TEST_ASSERT_EQUAL_DOUBLE(0.25, NMEA0183Parser::to_double(".25"));
+    TEST_ASSERT_EQUAL_DOUBLE(12.0, NMEA0183Parser::to_double("12."));
+    TEST_ASSERT_EQUAL_DOUBLE(4807.038, NMEA0183Parser::to_double("4807.038"));
+    TEST_ASSERT_EQUAL_DOUBLE(0.000123, NMEA0183Parser::to_double("0.000123"));
+    TEST_ASSERT_TRUE(isnan(NMEA0183Parser::to_double("")));
+    TEST_ASSERT_TRUE(isnan(NMEA0183Parser::to_double("-")));
+    TEST_ASSERT_TRUE(isnan(NMEA0183Parser::to_double("1.2.3")));
+    TEST_ASSERT_TRUE(isnan(NMEA0183Parser::to_double("12a")));
+    TEST_ASSERT_EQUAL(8, NMEA0183Parser::to_int("08"));
+    TEST_ASSERT_EQUAL(-1, NMEA0183Parser::to_int(""));
+    TEST_ASSERT_EQUAL(-1, NMEA0183Parser::to_int("1.0"));
+}
+
+void test_sentences() {
+    Collector c;
+    NMEA0183Parser p(&c);
+    for (int i = 0; i < LOG_LINES; i++) TEST_ASSERT_TRUE(parse(p, LOG[i]));
+    TEST_ASSERT_EQUAL(LOG_LINES, c.sentences);
+    TEST_ASSERT_EQUAL(LOG_LINES - 1, c.typed); // not the proprietary one
+    TEST_ASSERT_EQUAL_STRING("P", c.last_talker);
+    TEST_ASSERT_EQUAL_STRING("GRME", c.last_type);
+
+    TEST_ASSERT_TRUE(c.rmc.valid);
+    TEST_ASSERT_EQUAL_DOUBLE(12 * 3600 + 35 * 60 + 19, c.rmc.time);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-9, 48 + 7.038 / 60, c.rmc.latitude);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-9, 11 + 31.0 / 60, c.rmc.longitude);
+    TEST_ASSERT_EQUAL_DOUBLE(22.4, c.rmc.sog);
+    TEST_ASSERT_EQUAL_DOUBLE(84.4, c.rmc.cog);
+    TEST_ASSERT_EQUAL(23, c.rmc.day);
+    TEST_ASSERT_EQUAL(3, c.rmc.month);
+    TEST_ASSERT_EQUAL(1994, c.rmc.year);
+    TEST_ASSERT_EQUAL_DOUBLE(-3.1, c.rmc.variation);
+
+    TEST_ASSERT_EQUAL(1, c.gga.quality);
+    TEST_ASSERT_EQUAL(8, c.gga.satellites);
+    TEST_ASSERT_EQUAL_DOUBLE(0.9, c.gga.hdop);
+    TEST_ASSERT_EQUAL_DOUBLE(545.4, c.gga.altitude);
+    TEST_ASSERT_EQUAL_DOUBLE(46.9, c.gga.geoid_separation);
+
+    TEST_ASSERT_EQUAL_DOUBLE(54.7, c.vtg.cog_true);
+    TEST_ASSERT_EQUAL_DOUBLE(34.4, c.vtg.cog_magnetic);
+    TEST_ASSERT_EQUAL_DOUBLE(5.5, c.vtg.sog_knots);
+    TEST_ASSERT_EQUAL_DOUBLE(10.2, c.vtg.sog_kmh);
+
+    TEST_ASSERT_EQUAL_DOUBLE(238.5, c.hdg.heading);
+    TEST_ASSERT_TRUE(isnan(c.hdg.deviation));
+    TEST_ASSERT_EQUAL_DOUBLE(2.1, c.hdg.variation);
+
+    TEST_ASSERT_EQUAL_DOUBLE(45.0, c.mwv.angle);
+    TEST_ASSERT_FALSE(c.mwv.true_wind);
+    TEST_ASSERT_EQUAL_DOUBLE(12.4, c.mwv.speed);
+    TEST_ASSERT_EQUAL('N', c.mwv.unit);
+    TEST_ASSERT_TRUE(c.mwv.valid);
+
+    TEST_ASSERT_EQUAL_DOUBLE(12.3, c.dpt.depth);
+    TEST_ASSERT_EQUAL_DOUBLE(-0.5, c.dpt.offset);
+    TEST_ASSERT_EQUAL_DOUBLE(100.0, c.dpt.max_range);
+
+    TEST_ASSERT_TRUE(isnan(c.vhw.heading_true));
+    TEST_ASSERT_EQUAL_DOUBLE(210.0, c.vhw.heading_magnetic);
+    TEST_ASSERT_EQUAL_DOUBLE(6.1, c.vhw.speed_knots);
+    TEST_ASSERT_EQUAL_DOUBLE(11.3, c.vhw.speed_kmh);
+
+    TEST_ASSERT_EQUAL(2, c.xdr_n);
+    TEST_ASSERT_EQUAL('C', c.xdr_type[0]);
+    TEST_ASSERT_EQUAL_DOUBLE(19.5, c.xdr_value[0]);
+    TEST_ASSERT_EQUAL_STRING("AIRTEMP", c.xdr_name[0]);
+    TEST_ASSERT_EQUAL('P', c.xdr_type[1]);
+    TEST_ASSERT_EQUAL_DOUBLE(1.0132, c.xdr_value[1]);
+    TEST_ASSERT_EQUAL_STRING("BARO", c.xdr_name[1]);
+}
+
+void test_invalid_lines() {
+    Collector c;
+    NMEA0183Parser p(&c);
+    TEST_ASSERT_FALSE(parse(p, "$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6B"));
+    TEST_ASSERT_FALSE(parse(p, "$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6G"));
+    TEST_ASSERT_FALSE(parse(p, "garbage"));
+    TEST_ASSERT_FALSE(parse(p, "$G,1,2"));
+    TEST_ASSERT_EQUAL(0, c.sentences);
+    NMEA0183ParserStats stats = p.get_stats();
+    TEST_ASSERT_EQUAL(4, stats.lines);
+    TEST_ASSERT_EQUAL(1, stats.checksum_errors);
+    TEST_ASSERT_EQUAL(3, stats.malformed);
+
+    // noise before the delimiter and trailing CR/LF are tolerated
+    TEST_ASSERT_TRUE(parse(p, "\x01\x7f$IIHDG,238.5,,,2.1,E*2D\r\n"));
+    TEST_ASSERT_EQUAL_DOUBLE(238.5, c.hdg.heading);
+
+    // no checksum: accepted unless strict
+    TEST_ASSERT_TRUE(parse(p, "$IIHDG,100.0,,,2.1,E"));
+    TEST_ASSERT_EQUAL_DOUBLE(100.0, c.hdg.heading);
+    p.set_strict(true);
+    TEST_ASSERT_FALSE(parse(p, "$IIHDG,101.0,,,2.1,E"));
+    TEST_ASSERT_EQUAL_DOUBLE(100.0, c.hdg.heading);
+    TEST_ASSERT_EQUAL(2, p.get_stats().no_checksum);
+}
+
+void test_missing_fields() {
+    Collector c;
+    NMEA0183Parser p(&c);
+    // a receiver without fix
+    TEST_ASSERT_TRUE(parse(p, "$GPRMC,,V,,,,,,,,,,N"));
+    TEST_ASSERT_FALSE(c.rmc.valid);
+    TEST_ASSERT_TRUE(isnan(c.rmc.time));
+    TEST_ASSERT_TRUE(isnan(c.rmc.latitude));
+    TEST_ASSERT_TRUE(isnan(c.rmc.sog));
+    TEST_ASSERT_EQUAL(-1, c.rmc.year);
+    // truncated sentence: the missing trailing fields are missing values
+    TEST_ASSERT_TRUE(parse(p, "$SDDPT,4.5"));
+    TEST_ASSERT_EQUAL_DOUBLE(4.5, c.dpt.depth);
+    TEST_ASSERT_TRUE(isnan(c.dpt.offset));
+}
+
+void test_port_listener() {
+    MockPort port;
+    Collector c;
+    NMEA0183Parser p(&c);
+    port.set_handler(&p);
+    port.open();
+    for (int i = 0; i < LOG_LINES; i++) port.simulate_line(LOG[i]);
+    port.listen(100);
+    TEST_ASSERT_EQUAL(LOG_LINES, c.sentences);
+    TEST_ASSERT_EQUAL(LOG_LINES, p.get_stats().lines);
+}
+
+void test_benchmark_no_allocations() {
+    Collector c;
+    NMEA0183Parser p(&c);
+    int lens[LOG_LINES];
+    for (int i = 0; i < LOG_LINES; i++) lens[i] = strlen(LOG[i]);
+
+    unsigned long a0 = allocations;
+    unsigned long long t0 = _micros();
+    for (int r = 0; r < BENCH_ROUNDS; r++)
+    {
+        for (int i = 0; i < LOG_LINES; i++) p.parse(LOG[i], lens[i]);
+    }
+    unsigned long long us = _micros() - t0;
+    TEST_ASSERT_EQUAL(a0, allocations);
+    TEST_ASSERT_EQUAL(BENCH_ROUNDS * LOG_LINES, c.sentences);
+
+    char msg[96];
+    snprintf(msg, sizeof(msg), "%.0f sentences/s", (double)BENCH_ROUNDS * LOG_LINES * 1000000.0 / (us ? us : 1));
+    TEST_MESSAGE(msg);
+}
+
+int main( int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_to_double);
+    RUN_TEST(test_sentences);
+    RUN_TEST(test_invalid_lines);
+    RUN_TEST(test_missing_fields);
+    RUN_TEST(test_port_listener);
+    RUN_TEST(test_benchmark_no_allocations);
+    UNITY_END();
+}
@@ -0,0 +1,158 @@
+#include "MockPort.hpp"
+#include <unity.h>
+#include <string>
+#include <vector>
+
+static const char *SENTENCE = "$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6A";
+
+class Recorder: public PortListener
+{
+public:
+    Recorder(bool _partials = false): partials(_partials) {}
+    std::vector<std::string> lines;
+    int calls = 0;
+    int partial_calls = 0;
+    bool lengths_ok = true;
+    bool partials;
+
+    virtual void on_line(const char *line, int len)
+    {
+        calls++;
+        if ((int)strlen(line) != len) lengths_ok = false;
+        lines.push_back(std::string(line, len));
+    }
+    virtual void on_line_read(const char *line)
+    {
+        calls++;
+        lines.push_back(line);
+    }
+    virtual void on_partial(const char *line) { partial_calls++; calls++; }
+    virtual void on_partial_x(const char *line, int len) { partial_calls++; calls++; }
+    virtual bool want_partials() { return partials; }
+};
+
+void test_complete_lines_only() {
+    MockPort port;
+    Recorder r;
+    port.set_handler(&r);
+    port.set_line_framing();
+    port.open();
+    for (int i = 0; i < 10; i++) port.simulate_line(SENTENCE);
+    port.simulate_data("\n\r\n"); // empty lines are skipped
+    port.simulate_data("$IIHDG,238.5,,,2.1,E*2D\n$SDDPT,12.3,-0.5,100*52\r");
+    port.simulate_data("$IIMWV,045.0,R,12."); // incomplete
+    port.listen(100);
+    TEST_ASSERT_EQUAL(12, r.lines.size());
+    TEST_ASSERT_EQUAL(12, r.calls); // no partials
+    TEST_ASSERT_TRUE(r.lengths_ok);
+    for (int i = 0; i < 10; i++) TEST_ASSERT_EQUAL_STRING(SENTENCE, r.lines[i].c_str());
+    TEST_ASSERT_EQUAL_STRING("$IIHDG,238.5,,,2.1,E*2D", r.lines[10].c_str());
+    TEST_ASSERT_EQUAL_STRING("$SDDPT,12.3,-0.5,100*52", r.lines[11].c_str());
+
+    // the rest of the line arrives in the next block
+    port.simulate_data("4,N,A*0B\r\n");
+    port.listen(100);
+    TEST_ASSERT_EQUAL(13, r.lines.size());
+    TEST_ASSERT_EQUAL_STRING("$IIMWV,045.0,R,12.4,N,A*0B", r.lines[12].c_str());
+    TEST_ASSERT_EQUAL(0, port.get_overruns());
+}
+
+void test_lines_across_blocks() {
+    // a long run of lines, split at arbitrary points by the PORT_READ_BLOCK_SIZE blocks
+    MockPort port;
+    Recorder r;
+    port.set_handler(&r);
+    port.set_line_framing();
+    port.open();
+    std::string all;
+    for (int i = 0; i < 100; i++)
+    {
+        std::string line = std::string(SENTENCE).substr(0, 10 + i % 50);
+        all += line + "\r\n";
+    }
+    port.simulate_data(all.c_str());
+    port.listen(1000);
+    TEST_ASSERT_EQUAL(100, r.lines.size());
+    for (int i = 0; i < 100; i++) TEST_ASSERT_EQUAL(10 + i % 50, r.lines[i].size());
+    TEST_ASSERT_TRUE(r.lengths_ok);
+}
+
+void test_overrun_drops_the_line() {
+    MockPort port;
+    Recorder r;
+    port.set_handler(&r);
+    port.set_line_framing();
+    port.open();
+    std::string garbage(PORT_BUFFER_SIZE * 2 + 10, 'x');
+    port.simulate_line(garbage.c_str());
+    port.simulate_line(SENTENCE);
+    port.listen(1000);
+    TEST_ASSERT_EQUAL(1, port.get_overruns());
+    TEST_ASSERT_EQUAL(1, r.lines.size());
+    TEST_ASSERT_EQUAL_STRING(SENTENCE, r.lines[0].c_str());
+
+    // the longest line that fits
+    std::string max_line(PORT_BUFFER_SIZE - 1, 'y');
+    port.simulate_line(max_line.c_str());
+    port.listen(1000);
+    TEST_ASSERT_EQUAL(1, port.get_overruns());
+    TEST_ASSERT_EQUAL(2, r.lines.size());
+    TEST_ASSERT_EQUAL(PORT_BUFFER_SIZE - 1, r.lines[1].size());
+}
+
+void test_partials_opt_in() {
+    MockPort port;
+    Recorder r(true);
+    port.set_handler(&r);
+    port.set_line_framing();
+    port.open();
+    port.simulate_data("$IIMWV,045.0,R,12.");
+    port.listen(100);
+    TEST_ASSERT_EQUAL(0, r.lines.size());
+    TEST_ASSERT_EQUAL(2, r.partial_calls); // on_partial_x and on_partial, once per block
+    port.simulate_data("4,N,A*0B\r\n");
+    port.listen(100);
+    TEST_ASSERT_EQUAL(1, r.lines.size());
+    TEST_ASSERT_EQUAL(2, r.partial_calls);
+}
+
+void test_callbacks_per_line() {
+    // char mode calls the listener twice per char
+    MockPort port;
+    Recorder r;
+    port.set_handler(&r);
+    port.open();
+    port.simulate_line(SENTENCE);
+    port.listen(100);
+    TEST_ASSERT_EQUAL(1, r.lines.size());
+    TEST_ASSERT_EQUAL(1 + 2 * strlen(SENTENCE), r.calls);
+
+    Recorder r2;
+    port.set_handler(&r2);
+    port.set_line_framing();
+    port.simulate_line(SENTENCE);
+    port.listen(100);
+    TEST_ASSERT_EQUAL(1, r2.calls);
+}
+
+void test_char_mode_counts_overruns() {
+    MockPort port;
+    Recorder r;
+    port.set_handler(&r);
+    port.open();
+    std::string garbage(PORT_BUFFER_SIZE + 10, 'x');
+    port.simulate_line(garbage.c_str());
+    port.listen(1000);
+    TEST_ASSERT_EQUAL(1, port.get_overruns());
+}
+
+int main( int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_complete_lines_only);
+    RUN_TEST(test_lines_across_blocks);
+    RUN_TEST(test_overrun_drops_the_line);
+    RUN_TEST(test_partials_opt_in);
+    RUN_TEST(test_callbacks_per_line);
+    RUN_TEST(test_char_mode_counts_overruns);
+    UNITY_END();
+}
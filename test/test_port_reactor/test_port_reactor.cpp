@@ -0,0 +1,194 @@
+#include "PortReactor.h"
+#include "Utils.h"
+#include <unity.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <pty.h>
+#include <string>
+#include <thread>
+
+static const char *SENTENCE = "$IIHDG,238.5,,,2.1,E*2C\r\n";
+
+class LineCounter: public PortListener
+{
+public:
+    int lines = 0;
+    virtual void on_line_read(const char *line) { lines++; }
+};
+
+static void make_fifo(const char *path)
+{
+    unlink(path);
+    TEST_ASSERT_EQUAL(0, mkfifo(path, 0600));
+}
+
+static void write_lines(int fd, int n)
+{
+    for (int i = 0; i < n; i++) TEST_ASSERT_EQUAL((int)strlen(SENTENCE), (int)write(fd, SENTENCE, strlen(SENTENCE)));
+}
+
+static void run_until(PortReactor &r, int &value, int expected, unsigned long timeout_ms)
+{
+    unsigned long t0 = _millis();
+    while (value < expected && (_millis() - t0) < timeout_ms) r.run_once(100);
+}
+
+static void on_timer(unsigned long now, void *context)
+{
+    (*(int *)context)++;
+}
+
+void test_many_ports() {
+    const char *paths[3] = {"/tmp/test_reactor_0.fifo", "/tmp/test_reactor_1.fifo", "/tmp/test_reactor_2.fifo"};
+    LinuxPort *ports[3];
+    LineCounter counters[3];
+    int writers[3];
+    PortReactor r;
+    for (int i = 0; i < 3; i++)
+    {
+        make_fifo(paths[i]);
+        ports[i] = new LinuxPort(paths[i]);
+        ports[i]->set_handler(&counters[i]);
+        TEST_ASSERT_TRUE(r.add_port(ports[i]));
+    }
+    r.run_once(0); // opens the ports
+    TEST_ASSERT_EQUAL(3, r.get_stats().opens);
+    for (int i = 0; i < 3; i++)
+    {
+        writers[i] = open(paths[i], O_WRONLY | O_NONBLOCK);
+        TEST_ASSERT_TRUE(writers[i] > 0);
+        write_lines(writers[i], 10 * (i + 1));
+    }
+    int total = 0;
+    unsigned long t0 = _millis();
+    while (total < 60 && (_millis() - t0) < 2000)
+    {
+        r.run_once(100);
+        total = counters[0].lines + counters[1].lines + counters[2].lines;
+    }
+    TEST_ASSERT_EQUAL(10, counters[0].lines);
+    TEST_ASSERT_EQUAL(20, counters[1].lines);
+    TEST_ASSERT_EQUAL(30, counters[2].lines);
+
+    // idle: sleeps in epoll instead of polling
+    unsigned long wakeups = r.get_stats().wakeups;
+    t0 = _millis();
+    while ((_millis() - t0) < 500) r.run_once(1000);
+    TEST_ASSERT_LESS_OR_EQUAL(wakeups + 7, r.get_stats().wakeups);
+
+    for (int i = 0; i < 3; i++)
+    {
+        close(writers[i]);
+        r.remove_port(ports[i]);
+        delete ports[i];
+        unlink(paths[i]);
+    }
+}
+
+void test_timers() {
+    PortReactor r;
+    int fired = 0;
+    int h = r.add_timer(50, on_timer, &fired);
+    TEST_ASSERT_TRUE(h >= 0);
+    unsigned long t0 = _millis();
+    while ((_millis() - t0) < 520) r.run_once(1000);
+    TEST_ASSERT_TRUE(fired >= 9 && fired <= 11);
+    r.remove_timer(h);
+    fired = 0;
+    t0 = _millis();
+    while ((_millis() - t0) < 200) r.run_once(1000);
+    TEST_ASSERT_EQUAL(0, fired);
+}
+
+void test_hangup_and_reopen() {
+    const char *path = "/tmp/test_reactor_hup.fifo";
+    make_fifo(path);
+    LinuxPort port(path);
+    LineCounter counter;
+    port.set_handler(&counter);
+    PortReactor r;
+    r.add_port(&port);
+    r.run_once(0);
+    int w = open(path, O_WRONLY | O_NONBLOCK);
+    write_lines(w, 5);
+    close(w); // the device goes away after the data
+    run_until(r, counter.lines, 5, 1000);
+    TEST_ASSERT_EQUAL(5, counter.lines);
+    int hangups = 0;
+    unsigned long t0 = _millis();
+    while (hangups == 0 && (_millis() - t0) < 1000)
+    {
+        r.run_once(100);
+        hangups = r.get_stats().hangups;
+    }
+    TEST_ASSERT_EQUAL(1, hangups);
+    TEST_ASSERT_FALSE(port.is_open());
+
+    // reopened by housekeeping (one attempt per second)
+    t0 = _millis();
+    while (!port.is_open() && (_millis() - t0) < 2000) r.run_once(100);
+    TEST_ASSERT_TRUE(port.is_open());
+    TEST_ASSERT_EQUAL(2, r.get_stats().opens);
+    w = open(path, O_WRONLY | O_NONBLOCK);
+    TEST_ASSERT_TRUE(w > 0);
+    write_lines(w, 3);
+    run_until(r, counter.lines, 8, 1000);
+    TEST_ASSERT_EQUAL(8, counter.lines);
+    close(w);
+    r.remove_port(&port);
+    unlink(path);
+}
+
+void test_write_on_epollout() {
+    int master, slave;
+    char name[32];
+    TEST_ASSERT_EQUAL(0, openpty(&master, &slave, name, nullptr, nullptr));
+    close(slave);
+    fcntl(master, F_SETFL, O_NONBLOCK);
+    LinuxPort port(name);
+    port.enable_write();
+    PortReactor r;
+    r.add_port(&port);
+    r.run_once(0);
+    TEST_ASSERT_TRUE(port.is_open());
+
+    // fill the pty and the queue: the reactor waits for EPOLLOUT
+    std::string expected;
+    while (port.write(SENTENCE))
+    {
+        expected += SENTENCE;
+        r.run_once(0);
+    }
+    TEST_ASSERT_TRUE(port.get_write_queued() > 0);
+
+    // the other side reads slowly while the reactor sleeps: the rest goes out on EPOLLOUT
+    std::string got;
+    std::thread other([&]() {
+        unsigned long t0 = _millis();
+        while (got.size() < expected.size() && (_millis() - t0) < 3000)
+        {
+            char buf[256];
+            int n = read(master, buf, sizeof(buf));
+            if (n > 0) got.append(buf, n);
+            usleep(1000);
+        }
+    });
+    unsigned long t0 = _millis();
+    while (port.get_write_queued() && (_millis() - t0) < 3000) r.run_once(100);
+    other.join();
+    TEST_ASSERT_TRUE(expected == got);
+    TEST_ASSERT_EQUAL(0, port.get_write_queued());
+    TEST_ASSERT_TRUE(r.get_stats().write_events > 0);
+    r.remove_port(&port);
+    close(master);
+}
+
+int main( int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_many_ports);
+    RUN_TEST(test_timers);
+    RUN_TEST(test_hangup_and_reopen);
+    RUN_TEST(test_write_on_epollout);
+    UNITY_END();
+}
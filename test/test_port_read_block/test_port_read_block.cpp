@@ -0,0 +1,130 @@
+#include "LinuxPort.h"
+#include "MockPort.hpp"
+#include "Utils.h"
+#include <unity.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#define FIFO_PATH "/tmp/test_port_read_block.fifo"
+#define BENCH_LINES 20000
+
+static const char *SENTENCE = "$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6A\r\n";
+
+class LineCounter: public PortListener
+{
+public:
+    int lines = 0;
+    bool all_good = true;
+    virtual void on_line_read(const char *line)
+    {
+        lines++;
+        if (strncmp(line, SENTENCE, strlen(SENTENCE) - 2) != 0) all_good = false;
+    }
+};
+
+// counts the read syscalls; byte_wise forces the Port fallback (one read per byte)
+class CountingPort: public LinuxPort
+{
+public:
+    CountingPort(const char *path, bool _byte_wise): LinuxPort(path), byte_wise(_byte_wise) {}
+    unsigned long syscalls = 0;
+
+protected:
+    virtual int _read(bool &nothing_to_read, bool &error)
+    {
+        syscalls++;
+        return LinuxPort::_read(nothing_to_read, error);
+    }
+    virtual int _read_block(char *buf, int len, bool &nothing_to_read, bool &error)
+    {
+        if (byte_wise) return Port::_read_block(buf, len, nothing_to_read, error);
+        syscalls++;
+        return LinuxPort::_read_block(buf, len, nothing_to_read, error);
+    }
+
+private:
+    bool byte_wise;
+};
+
+static void bench(bool byte_wise, unsigned long &syscalls, double &bytes_per_sec)
+{
+    unlink(FIFO_PATH);
+    TEST_ASSERT_EQUAL(0, mkfifo(FIFO_PATH, 0600));
+    CountingPort port(FIFO_PATH, byte_wise);
+    LineCounter counter;
+    port.set_handler(&counter);
+    TEST_ASSERT_TRUE(port.open());
+    int w = open(FIFO_PATH, O_WRONLY | O_NONBLOCK);
+    TEST_ASSERT_TRUE(w > 0);
+
+    size_t len = strlen(SENTENCE);
+    size_t total = len * BENCH_LINES;
+    size_t written = 0;
+    unsigned long long t0 = _micros();
+    while (counter.lines < BENCH_LINES)
+    {
+        while (written < total)
+        {
+            ssize_t n = write(w, SENTENCE + (written % len), len - (written % len));
+            if (n <= 0) break;
+            written += n;
+        }
+        port.listen(10);
+    }
+    unsigned long long us = _micros() - t0;
+    close(w);
+    port.close();
+    unlink(FIFO_PATH);
+
+    TEST_ASSERT_EQUAL(BENCH_LINES, counter.lines);
+    TEST_ASSERT_TRUE(counter.all_good);
+    syscalls = port.syscalls;
+    bytes_per_sec = total * 1000000.0 / (us ? us : 1);
+    char msg[128];
+    snprintf(msg, sizeof(msg), "%s: %.0f bytes/s, %.2f reads per line",
+        byte_wise ? "byte-wise" : "block", bytes_per_sec, (double)syscalls / BENCH_LINES);
+    TEST_MESSAGE(msg);
+}
+
+void test_block_read_benchmark() {
+    unsigned long byte_syscalls, block_syscalls;
+    double byte_rate, block_rate;
+    bench(true, byte_syscalls, byte_rate);
+    bench(false, block_syscalls, block_rate);
+    // one read per byte (plus the empty ones) against one per block
+    TEST_ASSERT_GREATER_OR_EQUAL((unsigned long)BENCH_LINES * strlen(SENTENCE), byte_syscalls);
+    TEST_ASSERT_LESS_THAN((unsigned long)BENCH_LINES, block_syscalls);
+}
+
+void test_fallback_for_byte_ports() {
+    // subclasses implementing only _read keep working through the default _read_block
+    MockPort port;
+    LineCounter counter;
+    port.set_handler(&counter);
+    port.open();
+    for (int i = 0; i < 10; i++) port.simulate_data(SENTENCE);
+    port.listen(100);
+    TEST_ASSERT_EQUAL(10, counter.lines);
+    TEST_ASSERT_TRUE(counter.all_good);
+    TEST_ASSERT_TRUE(port.is_input_queue_empty());
+}
+
+void test_fallback_read_error_closes() {
+    MockPort port;
+    LineCounter counter;
+    port.set_handler(&counter);
+    port.open();
+    port.set_error_on_read(true);
+    port.listen(100);
+    TEST_ASSERT_FALSE(port.is_open());
+}
+
+int main( int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_block_read_benchmark);
+    RUN_TEST(test_fallback_for_byte_ports);
+    RUN_TEST(test_fallback_read_error_closes);
+    UNITY_END();
+}
@@ -0,0 +1,124 @@
+#include "MockPort.hpp"
+#include "LinuxPort.h"
+#include "Utils.h"
+#include <unity.h>
+#include <string>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#define FIFO_PATH "/tmp/test_port_stats.fifo"
+
+static const char *GOOD = "$IIHDG,238.5,,,2.1,E*2D";
+static const char *BAD = "$IIHDG,238.5,,,2.1,E*2C";
+
+static void feed(MockPort &port)
+{
+    port.simulate_line(GOOD);
+    port.simulate_line(BAD);
+    port.simulate_line("no checksum here");
+    port.simulate_line(std::string(PORT_BUFFER_SIZE + 10, 'x').c_str());
+}
+
+static void check(Port &port)
+{
+    PortStats s = port.get_stats();
+    TEST_ASSERT_EQUAL_STRING("MOCK_PORT", s.name);
+    // the overlong line is an overrun; in char mode its tail still comes out as a line
+    TEST_ASSERT_EQUAL(1, s.overruns);
+    TEST_ASSERT_EQUAL(1, s.checksum_errors);
+    TEST_ASSERT_EQUAL(1, s.opens);
+    TEST_ASSERT_EQUAL(2 * strlen(GOOD) + 16 + PORT_BUFFER_SIZE + 10 + 8, s.bytes);
+    TEST_ASSERT_EQUAL(1, s.listen_calls);
+    TEST_ASSERT_TRUE(s.listen_max_us <= s.listen_us);
+    TEST_ASSERT_TRUE(s.checksum_enabled);
+}
+
+void test_char_mode() {
+    MockPort port;
+    port.set_checksum_check();
+    port.open();
+    feed(port);
+    port.listen(1000);
+    check(port);
+    PortStats s = port.get_stats();
+    TEST_ASSERT_EQUAL(4, s.lines);
+    TEST_ASSERT_EQUAL(strlen(GOOD), s.max_line);
+    s.dump();
+}
+
+void test_line_mode() {
+    MockPort port;
+    port.set_line_framing();
+    port.set_checksum_check();
+    port.open();
+    feed(port);
+    port.listen(1000);
+    check(port);
+    PortStats s = port.get_stats();
+    TEST_ASSERT_EQUAL(3, s.lines); // the overlong one is dropped
+    TEST_ASSERT_EQUAL(strlen(GOOD), s.max_line);
+}
+
+void test_rates_and_reset() {
+    MockPort port;
+    port.open();
+    port.simulate_line(GOOD);
+    port.listen(100);
+    usleep(100000);
+    PortStats s = port.get_stats();
+    TEST_ASSERT_FALSE(s.checksum_enabled);
+    TEST_ASSERT_EQUAL(0, s.checksum_errors);
+    TEST_ASSERT_TRUE(s.period_ms >= 100);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, s.lines * 1000.0f / s.period_ms, s.lines_per_sec);
+    TEST_ASSERT_TRUE(s.lines_per_sec > 0 && s.lines_per_sec <= 10);
+    TEST_ASSERT_TRUE(s.bytes_per_sec > 0);
+
+    port.reset_stats();
+    s = port.get_stats();
+    TEST_ASSERT_EQUAL(0, s.lines);
+    TEST_ASSERT_EQUAL(0, s.bytes);
+    TEST_ASSERT_EQUAL(0, s.max_line);
+    TEST_ASSERT_EQUAL(0, s.listen_calls);
+
+    // reopens
+    port.close();
+    port.open();
+    TEST_ASSERT_EQUAL(1, port.get_stats().opens);
+}
+
+void test_reader_thread() {
+    unlink(FIFO_PATH);
+    TEST_ASSERT_EQUAL(0, mkfifo(FIFO_PATH, 0600));
+    int w = open(FIFO_PATH, O_RDWR | O_NONBLOCK);
+    LinuxPort port(FIFO_PATH);
+    port.enable_reader_thread();
+    port.set_checksum_check();
+    usleep(50000);
+    std::string data = std::string(GOOD) + "\r\n" + BAD + "\r\n";
+    TEST_ASSERT_EQUAL((int)data.size(), (int)write(w, data.c_str(), data.size()));
+    usleep(100000);
+    port.listen(10);
+    PortStats s = port.get_stats();
+    TEST_ASSERT_EQUAL(2, s.lines);
+    TEST_ASSERT_EQUAL(data.size(), s.bytes);
+    TEST_ASSERT_EQUAL(1, s.checksum_errors);
+    TEST_ASSERT_EQUAL(1, s.opens);
+    TEST_ASSERT_EQUAL(0, s.dropped);
+
+    port.reset_stats();
+    s = port.get_stats();
+    TEST_ASSERT_EQUAL(0, s.bytes);
+    TEST_ASSERT_EQUAL(0, s.opens);
+    close(w);
+    unlink(FIFO_PATH);
+}
+
+int main( int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_char_mode);
+    RUN_TEST(test_line_mode);
+    RUN_TEST(test_rates_and_reset);
+    RUN_TEST(test_reader_thread);
+    UNITY_END();
+}
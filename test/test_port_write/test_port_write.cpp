@@ -0,0 +1,174 @@
+#include "MockPort.hpp"
+#include "LinuxPort.h"
+#include "Utils.h"
+#include <unity.h>
+#include <string>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pty.h>
+
+static const char *SENTENCE = "$IIHDG,238.5,,,2.1,E*2C\r\n";
+
+static std::string sentence(int i)
+{
+    char buf[64];
+    snprintf(buf, sizeof(buf), "$IIXDR,C,%05d,C,AIR*00\r\n", i);
+    return buf;
+}
+
+void test_write_not_enabled() {
+    MockPort port;
+    port.open();
+    TEST_ASSERT_FALSE(port.write(SENTENCE));
+    TEST_ASSERT_FALSE(port.get_stats().write_enabled);
+    port.listen(1);
+    TEST_ASSERT_EQUAL(0, port.get_written().size());
+}
+
+void test_queue_and_flush() {
+    MockPort port;
+    port.enable_write();
+    // closed: the data waits for the open
+    TEST_ASSERT_TRUE(port.write(SENTENCE));
+    TEST_ASSERT_EQUAL(0, port.flush_write());
+    TEST_ASSERT_EQUAL(strlen(SENTENCE), port.get_write_queued());
+    port.open();
+    port.listen(1);
+    TEST_ASSERT_EQUAL_STRING(SENTENCE, port.get_written().c_str());
+    TEST_ASSERT_EQUAL(0, port.get_write_queued());
+    PortStats s = port.get_stats();
+    TEST_ASSERT_TRUE(s.write_enabled);
+    TEST_ASSERT_EQUAL(strlen(SENTENCE), s.write_bytes);
+    TEST_ASSERT_EQUAL(0, s.write_dropped);
+    TEST_ASSERT_TRUE(s.write_latency_max_us > 0);
+    s.dump();
+}
+
+void test_slow_device_wraps_the_ring() {
+    MockPort port;
+    port.enable_write();
+    port.open();
+    std::string expected;
+    int i = 0;
+    // the device takes 7 bytes per flush: the ring wraps many times, nothing is lost
+    while (expected.size() < 10 * PORT_WRITE_BUFFER_SIZE)
+    {
+        std::string s = sentence(i++);
+        while (port.get_write_queued() + s.size() > PORT_WRITE_BUFFER_SIZE)
+        {
+            port.set_write_room(7);
+            port.flush_write();
+        }
+        TEST_ASSERT_TRUE(port.write(s.c_str()));
+        expected += s;
+    }
+    port.set_write_room(-1);
+    port.flush_write();
+    TEST_ASSERT_TRUE(expected == port.get_written());
+    TEST_ASSERT_EQUAL(0, port.get_stats().write_dropped);
+}
+
+void test_drop_new() {
+    MockPort port;
+    port.enable_write(PORT_WRITE_DROP_NEW);
+    port.open();
+    port.set_write_room(0);
+    int accepted = 0;
+    for (int i = 0; i < 1000; i++) accepted += port.write(sentence(i).c_str());
+    unsigned long len = sentence(0).size();
+    TEST_ASSERT_EQUAL(PORT_WRITE_BUFFER_SIZE / len, accepted);
+    TEST_ASSERT_EQUAL(accepted * len, port.get_write_queued());
+    TEST_ASSERT_EQUAL((1000 - accepted) * len, port.get_stats().write_dropped);
+    // the oldest data is kept
+    port.set_write_room(-1);
+    port.flush_write();
+    TEST_ASSERT_EQUAL(0, port.get_written().find(sentence(0)));
+}
+
+void test_drop_oldest_whole_lines() {
+    MockPort port;
+    port.enable_write(PORT_WRITE_DROP_OLDEST);
+    port.open();
+    port.set_write_room(0);
+    for (int i = 0; i < 1000; i++) TEST_ASSERT_TRUE(port.write(sentence(i).c_str()));
+    port.set_write_room(-1);
+    port.flush_write();
+    // the newest lines made it, whole
+    const std::string &w = port.get_written();
+    std::string last = sentence(999);
+    TEST_ASSERT_EQUAL(w.size() - last.size(), w.rfind(last));
+    TEST_ASSERT_EQUAL('$', w[0]);
+    TEST_ASSERT_EQUAL(0, w.size() % last.size());
+    TEST_ASSERT_EQUAL(1000 * last.size(), w.size() + port.get_stats().write_dropped);
+    // longer than the ring: rejected anyway
+    TEST_ASSERT_FALSE(port.write(std::string(PORT_WRITE_BUFFER_SIZE + 1, 'x').c_str()));
+}
+
+void test_write_error_drops_the_queue() {
+    MockPort port;
+    port.enable_write();
+    port.open();
+    port.set_error_on_write(true);
+    TEST_ASSERT_TRUE(port.write(SENTENCE));
+    port.listen(1);
+    PortStats s = port.get_stats();
+    TEST_ASSERT_EQUAL(1, s.write_errors);
+    TEST_ASSERT_EQUAL(strlen(SENTENCE), s.write_dropped);
+    TEST_ASSERT_EQUAL(0, s.write_queued);
+    TEST_ASSERT_TRUE(port.is_open());
+    port.set_error_on_write(false);
+    TEST_ASSERT_TRUE(port.write(SENTENCE));
+    port.listen(1);
+    TEST_ASSERT_EQUAL_STRING(SENTENCE, port.get_written().c_str());
+}
+
+void test_linux_port_does_not_block() {
+    int master, slave;
+    char name[32];
+    TEST_ASSERT_EQUAL(0, openpty(&master, &slave, name, nullptr, nullptr));
+    close(slave);
+    fcntl(master, F_SETFL, O_NONBLOCK);
+    LinuxPort port(name);
+    port.enable_write(PORT_WRITE_DROP_NEW);
+    port.listen(1);
+    TEST_ASSERT_TRUE(port.is_open());
+
+    // nobody reads the master: the pty buffer fills up, then the queue, and writes get dropped
+    std::string expected;
+    unsigned long t0 = _millis();
+    for (int i = 0; port.get_stats().write_dropped == 0; i++)
+    {
+        std::string s = sentence(i);
+        if (port.write(s.c_str())) expected += s;
+        port.listen(0);
+        TEST_ASSERT_TRUE((_millis() - t0) < 5000);
+    }
+    TEST_ASSERT_TRUE(port.get_write_queued() > 0);
+
+    // the other side catches up: the queue drains
+    std::string got;
+    char buf[4096];
+    t0 = _millis();
+    while (got.size() < expected.size() && (_millis() - t0) < 2000)
+    {
+        int n = read(master, buf, sizeof(buf));
+        if (n > 0) got.append(buf, n);
+        port.listen(0);
+    }
+    TEST_ASSERT_EQUAL(0, port.get_write_queued());
+    TEST_ASSERT_TRUE(expected == got);
+    port.close();
+    close(master);
+}
+
+int main( int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_write_not_enabled);
+    RUN_TEST(test_queue_and_flush);
+    RUN_TEST(test_slow_device_wraps_the_ring);
+    RUN_TEST(test_drop_new);
+    RUN_TEST(test_drop_oldest_whole_lines);
+    RUN_TEST(test_write_error_drops_the_queue);
+    RUN_TEST(test_linux_port_does_not_block);
+    UNITY_END();
+}
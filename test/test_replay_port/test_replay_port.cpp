@@ -0,0 +1,132 @@
+#include "ReplayPort.hpp"
+#include "MockPort.hpp"
+#include "NMEA0183Parser.h"
+#include "Utils.h"
+#include <unity.h>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#define CAPTURE_PATH "/tmp/test_replay_port.cap"
+#define BENCH_CAPTURE_PATH "/tmp/test_replay_port_bench.cap"
+#define BENCH_LINES 50000
+
+static const char *LOG[] = {
+    "$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6A",
+    "$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47",
+    "$GPVTG,054.7,T,034.4,M,005.5,N,010.2,K*48",
+    "$IIHDG,238.5,,,2.1,E*2D",
+    "$IIMWV,045.0,R,12.4,N,A*0B",
+};
+#define LOG_LINES (int)(sizeof(LOG) / sizeof(LOG[0]))
+
+class Recorder: public PortListener
+{
+public:
+    std::vector<std::string> lines;
+    std::vector<unsigned long> times;
+    virtual void on_line_read(const char *line)
+    {
+        lines.push_back(line);
+        times.push_back(_millis());
+    }
+};
+
+// two bursts of sentences, 200ms apart
+static void make_capture()
+{
+    MockPort port;
+    port.open();
+    TEST_ASSERT_TRUE(port.start_capture(CAPTURE_PATH));
+    for (int i = 0; i < LOG_LINES; i++) port.simulate_line(LOG[i]);
+    port.listen(100);
+    usleep(200000);
+    for (int i = 0; i < LOG_LINES; i++) port.simulate_line(LOG[i]);
+    port.listen(100);
+    port.stop_capture();
+}
+
+static unsigned long replay(double speed, Recorder &r)
+{
+    ReplayPort port(CAPTURE_PATH, speed);
+    port.set_handler(&r);
+    unsigned long t0 = _millis();
+    while (!port.is_finished() && (_millis() - t0) < 2000)
+    {
+        port.listen(10);
+        usleep(1000);
+    }
+    return r.times.size() ? r.times.back() - t0 : 0;
+}
+
+void test_capture_and_replay() {
+    make_capture();
+    Recorder r;
+    replay(0, r);
+    TEST_ASSERT_EQUAL(2 * LOG_LINES, r.lines.size());
+    for (int i = 0; i < 2 * LOG_LINES; i++) TEST_ASSERT_EQUAL_STRING(LOG[i % LOG_LINES], r.lines[i].c_str());
+}
+
+void test_replay_timing() {
+    make_capture();
+    Recorder real_time;
+    unsigned long ms = replay(1.0, real_time);
+    TEST_ASSERT_EQUAL(2 * LOG_LINES, real_time.lines.size());
+    TEST_ASSERT_UINT_WITHIN(60, 200, ms);
+    // the second burst comes 200ms after the first one
+    TEST_ASSERT_UINT_WITHIN(60, 200, real_time.times[LOG_LINES] - real_time.times[0]);
+
+    Recorder fast;
+    ms = replay(10.0, fast);
+    TEST_ASSERT_EQUAL(2 * LOG_LINES, fast.lines.size());
+    TEST_ASSERT_UINT_WITHIN(15, 20, ms);
+}
+
+void test_bad_file() {
+    FILE *f = fopen(CAPTURE_PATH, "wb");
+    fputs("not a capture", f);
+    fclose(f);
+    ReplayPort port(CAPTURE_PATH, 0);
+    TEST_ASSERT_FALSE(port.open());
+}
+
+void test_parser_benchmark() {
+    // a capture of BENCH_LINES sentences, read in blocks as a serial port would
+    FILE *f = fopen(BENCH_CAPTURE_PATH, "wb");
+    fwrite(PORT_CAPTURE_MAGIC, 1, PORT_CAPTURE_MAGIC_LEN, f);
+    std::string data;
+    for (int i = 0; i < BENCH_LINES; i++) data += std::string(LOG[i % LOG_LINES]) + "\r\n";
+    for (size_t off = 0; off < data.size(); off += PORT_READ_BLOCK_SIZE)
+    {
+        uint64_t t = off;
+        uint16_t l = data.size() - off < PORT_READ_BLOCK_SIZE ? data.size() - off : PORT_READ_BLOCK_SIZE;
+        fwrite(&t, sizeof(t), 1, f);
+        fwrite(&l, sizeof(l), 1, f);
+        fwrite(data.c_str() + off, 1, l, f);
+    }
+    fclose(f);
+
+    NMEA0183Parser parser;
+    ReplayPort port(BENCH_CAPTURE_PATH, 0);
+    port.set_line_framing();
+    port.set_handler(&parser);
+    unsigned long long t0 = _micros();
+    while (!port.is_finished()) port.listen(1000);
+    unsigned long long us = _micros() - t0;
+    TEST_ASSERT_EQUAL(BENCH_LINES, parser.get_stats().sentences);
+    TEST_ASSERT_EQUAL(data.size(), port.get_replayed_bytes());
+    char msg[96];
+    snprintf(msg, sizeof(msg), "replay + parse: %.0f sentences/s", BENCH_LINES * 1000000.0 / (us ? us : 1));
+    TEST_MESSAGE(msg);
+    unlink(BENCH_CAPTURE_PATH);
+}
+
+int main( int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_capture_and_replay);
+    RUN_TEST(test_replay_timing);
+    RUN_TEST(test_bad_file);
+    RUN_TEST(test_parser_benchmark);
+    UNITY_END();
+    unlink(CAPTURE_PATH);
+}
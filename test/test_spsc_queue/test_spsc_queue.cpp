@@ -0,0 +1,49 @@
+#include "SPSCQueue.h"
+#include <unity.h>
+
+void test_spsc_queue_push_pop() {
+    SPSCQueue<int, 4> q;
+    TEST_ASSERT_TRUE(q.empty());
+    TEST_ASSERT_TRUE(q.push(1));
+    TEST_ASSERT_TRUE(q.push(2));
+    TEST_ASSERT_EQUAL(2, q.size());
+    TEST_ASSERT_EQUAL(1, *q.front());
+    q.pop();
+    TEST_ASSERT_EQUAL(2, *q.front());
+    q.pop();
+    TEST_ASSERT_NULL(q.front());
+}
+
+void test_spsc_queue_full() {
+    SPSCQueue<int, 4> q;
+    for (int i = 0; i < 4; i++) TEST_ASSERT_TRUE(q.push(i));
+    TEST_ASSERT_FALSE(q.push(4));
+    TEST_ASSERT_NULL(q.acquire_write());
+    q.pop();
+    TEST_ASSERT_TRUE(q.push(4));
+    TEST_ASSERT_EQUAL(4, q.size());
+}
+
+void test_spsc_queue_wrap_around() {
+    SPSCQueue<int, 4> q;
+    for (int i = 0; i < 100; i++)
+    {
+        int* s = q.acquire_write();
+        TEST_ASSERT_NOT_NULL(s);
+        *s = i;
+        q.commit_write();
+        TEST_ASSERT_EQUAL(i, *q.front());
+        q.pop();
+    }
+    TEST_ASSERT_TRUE(q.empty());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_spsc_queue_push_pop);
+    RUN_TEST(test_spsc_queue_full);
+    RUN_TEST(test_spsc_queue_wrap_around);
+    UNITY_END();
+    return 0;
+}